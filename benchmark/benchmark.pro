@@ -0,0 +1,41 @@
+#-------------------------------------------------
+#
+# Headless benchmark of DatabaseManager on synthetic libraries
+# Build it by: qmake CONFIG+=benchmark
+#
+#-------------------------------------------------
+
+QT += core gui sql dbus concurrent svg x11extras
+qtHaveModule(opengl): QT += opengl
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+CONFIG -= app_bundle
+CONFIG += c++11 link_pkgconfig
+PKGCONFIG += x11 xext dtkwidget dtkutil dtkbase
+LIBS += -L/usr/lib/x86_64-linux-gnu -lfreeimage
+TARGET = deepin-image-viewer-benchmark
+TEMPLATE = app
+
+VIEWER_DIR = $$PWD/../viewer
+INCLUDEPATH += $$VIEWER_DIR $$VIEWER_DIR/utils
+
+# Every module of the viewer except its main()
+include ($$VIEWER_DIR/frame/frame.pri)
+include ($$VIEWER_DIR/module/modules.pri)
+include ($$VIEWER_DIR/widgets/widgets.pri)
+include ($$VIEWER_DIR/utils/utils.pri)
+include ($$VIEWER_DIR/controller/controller.pri)
+include ($$VIEWER_DIR/service/service.pri)
+
+HEADERS += \
+    $$VIEWER_DIR/application.h \
+    databasebenchmark.h
+
+SOURCES += main.cpp \
+    $$VIEWER_DIR/application.cpp \
+    databasebenchmark.cpp
+
+RESOURCES += \
+    $$VIEWER_DIR/resources.qrc
+
+DEFINES += APPSHAREDIR=\\\"/usr/share/deepin-image-viewer\\\"
@@ -0,0 +1,383 @@
+#include "databasebenchmark.h"
+#include "application.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QtAlgorithms>
+
+namespace {
+
+const int IMAGES_PER_EVENT = 40;
+const int EVENT_DAYS = 4000;  // Events are spread over about 11 years
+const int INSERT_BATCH_SIZE = 1000;
+// The changes are applied to 1% of the library
+const int CHANGE_RATIO = 100;
+const QDate START_DATE = QDate(2008, 1, 1);
+const QString FAVORITES_ALBUM = "My favorites";
+const QString BENCHMARK_ALBUM = "Benchmark";
+const QStringList CAMERAS = QStringList() << "Canon EOS 5D Mark III"
+                                          << "NIKON D750" << "Apple iPhone 7"
+                                          << "SONY ILCE-7M2" << "FUJIFILM X-T2";
+const QStringList LENSES = QStringList() << "EF24-70mm f/2.8L II USM"
+                                         << "24.0-120.0 mm f/4.0"
+                                         << "iPhone 7 back camera 3.99mm f/1.8"
+                                         << "FE 28-70mm F3.5-5.6 OSS"
+                                         << "XF18-55mmF2.8-4 R LM OIS";
+
+quint32 hash(quint32 x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352d;
+    x ^= x >> 15;
+    x *= 0x846ca68b;
+    x ^= x >> 16;
+    return x;
+}
+
+}  // namespace
+
+DatabaseBenchmark::DatabaseBenchmark(int iterations)
+    : m_iterations(qMax(1, iterations)),
+      m_imageCount(dApp->databaseM->imageCount())
+{
+}
+
+void DatabaseBenchmark::run(int count)
+{
+    generate(count);
+    qDebug() << "Benchmark the library of" << m_imageCount << "images";
+
+    measureQueries();
+    measureSequences();
+    measureMutations();
+}
+
+QJsonObject DatabaseBenchmark::results() const
+{
+    QJsonObject root;
+    root.insert("qt", QString(qVersion()));
+    root.insert("time", QDateTime::currentDateTime().toString(Qt::ISODate));
+    root.insert("iterations", m_iterations);
+    root.insert("results", m_results);
+
+    return root;
+}
+
+void DatabaseBenchmark::generate(int count)
+{
+    if (count <= m_imageCount) {
+        return;
+    }
+
+    qDebug() << "Generate images from" << m_imageCount << "to" << count;
+    dApp->databaseM->insertImageIntoAlbum(FAVORITES_ALBUM, "");
+
+    QElapsedTimer timer;
+    timer.start();
+    const int first = m_imageCount;
+    while (m_imageCount < count) {
+        QList<DatabaseManager::ImageInfo> infos;
+        const int last = qMin(count, m_imageCount + INSERT_BATCH_SIZE);
+        for (int i = m_imageCount; i < last; i ++) {
+            infos << imageInfo(i);
+        }
+        dApp->databaseM->insertImageInfos(infos);
+        m_imageCount = last;
+    }
+
+    QJsonObject result;
+    result.insert("images", m_imageCount);
+    result.insert("name", QString("generate"));
+    result.insert("inserted", m_imageCount - first);
+    result.insert("total_ms", timer.nsecsElapsed() / 1000000.0);
+    m_results.append(result);
+}
+
+void DatabaseBenchmark::measureQueries()
+{
+    DatabaseManager *db = dApp->databaseM;
+    const DatabaseManager::ImageInfo info = imageInfo(m_imageCount / 2);
+    const QString timeline = info.time.toString("yyyy.MM.dd");
+    const QString month = info.time.toString("yyyy.MM");
+    const QString dayDir = QFileInfo(info.path).absolutePath();
+    const QString yearDir = QFileInfo(dayDir).absolutePath();
+    QString album;
+    for (int i = m_imageCount / 2; album.isEmpty() && i < m_imageCount; i ++) {
+        album = albumOf(i);
+    }
+    // Dumping the whole library is slow, a few runs are enough
+    const int dumpIterations = qMin(m_iterations, 3);
+
+    measure("getAllImagesName", [=] { db->getAllImagesName(); },
+            dumpIterations);
+    measure("getAllImagesPath", [=] { db->getAllImagesPath(); },
+            dumpIterations);
+    measure("getAllImageInfos", [=] { db->getAllImageInfos(); },
+            dumpIterations);
+    measure("getImageInfosByAlbum", [=] { db->getImageInfosByAlbum(album); });
+    measure("getImageInfosByTimeline", [=] {
+        db->getImageInfosByTimeline(timeline);
+    });
+    measure("getImageInfosByPage", [=] {
+        DatabaseManager::ImageCursor cursor;
+        db->getImageInfosByPage(cursor, 500);
+    });
+    measure("getImageInfoByName", [=] { db->getImageInfoByName(info.name); });
+    measure("getImageInfoByPath", [=] { db->getImageInfoByPath(info.path); });
+    measure("getImageInfosByDirectory(day)", [=] {
+        db->getImageInfosByDirectory(dayDir);
+    });
+    measure("getImageInfosByDirectory(year)", [=] {
+        db->getImageInfosByDirectory(yearDir);
+    });
+    measure("imageExist", [=] { db->imageExist(info.name); });
+    measure("imageCount", [=] { db->imageCount(); });
+    measure("imageCountAsync", [=] { db->imageCountAsync().waitForFinished(); });
+    measure("getImagesCountByMonth", [=] { db->getImagesCountByMonth(month); });
+    measure("getImagesCountByMonths", [=] { db->getImagesCountByMonths(); });
+    measure("getAlbumInfo", [=] { db->getAlbumInfo(album); });
+    measure("getAllAlbumInfos", [=] { db->getAllAlbumInfos(); });
+    measure("getAlbumNameList", [=] { db->getAlbumNameList(); });
+    measure("getImageNamesByAlbum", [=] { db->getImageNamesByAlbum(album); });
+    measure("imageExistAlbum", [=] { db->imageExistAlbum(info.name, album); });
+    measure("getImagesCountByAlbum", [=] { db->getImagesCountByAlbum(album); });
+    measure("albumsCount", [=] { db->albumsCount(); });
+    measure("getTimeLineList", [=] { db->getTimeLineList(); });
+    measure("searchImageInfos(name)", [=] {
+        db->searchImageInfos(info.name.left(8), 0, 100);
+    });
+    measure("searchImageInfos(camera)", [=] {
+        db->searchImageInfos(info.camera.split(" ").first(), 0, 100);
+    });
+    // Every image matches, the ranked candidates are capped
+    measure("searchImageInfos(broad)", [=] {
+        db->searchImageInfos("I", 0, 100);
+    });
+    measure("searchImageInfos(broad, deep page)", [=] {
+        db->searchImageInfos("I", 5000, 100);
+    });
+
+    // The same queries on the reader threads, waited for their results
+    measure("albumsCountAsync", [=] {
+        db->albumsCountAsync().waitForFinished();
+    });
+    measure("getImagesCountByAlbumAsync", [=] {
+        db->getImagesCountByAlbumAsync(album).waitForFinished();
+    });
+    measure("getAlbumNameListAsync", [=] {
+        db->getAlbumNameListAsync().waitForFinished();
+    });
+    measure("getAllImageInfosAsync", [=] {
+        db->getAllImageInfosAsync().waitForFinished();
+    }, dumpIterations);
+    measure("getImageInfosByAlbumAsync", [=] {
+        db->getImageInfosByAlbumAsync(album).waitForFinished();
+    });
+    measure("getAllAlbumInfosAsync", [=] {
+        db->getAllAlbumInfosAsync().waitForFinished();
+    });
+    measure("searchImageInfosAsync(camera)", [=] {
+        db->searchImageInfosAsync(info.camera.split(" ").first(), 0, 100)
+                .waitForFinished();
+    });
+}
+
+void DatabaseBenchmark::measureSequences()
+{
+    DatabaseManager *db = dApp->databaseM;
+    const int iterations = qMin(m_iterations, 3);
+
+    // The same pages as TimelineImageView reads
+    measure("timelinePopulation", [=] {
+        DatabaseManager::ImageCursor cursor;
+        db->getImageInfosByPage(cursor, 100);
+        while (! cursor.atEnd) {
+            db->getImageInfosByPage(cursor, 500);
+        }
+    }, iterations);
+
+    // AlbumsView lists the albums, then ImagesView opens every album
+    measure("albumPopulation", [=] {
+        for (const DatabaseManager::AlbumInfo &info : db->getAllAlbumInfos()) {
+            DatabaseManager::ImageCursor cursor;
+            db->getImageInfosByPage(cursor, 100, info.name);
+            while (! cursor.atEnd) {
+                db->getImageInfosByPage(cursor, 500, info.name);
+            }
+        }
+    }, iterations);
+}
+
+void DatabaseBenchmark::measureMutations()
+{
+    DatabaseManager *db = dApp->databaseM;
+    QList<DatabaseManager::ImageInfo> infos;
+    QStringList names;
+    for (int i = 0; i < m_imageCount; i += CHANGE_RATIO) {
+        infos << imageInfo(i);
+        names << infos.last().name;
+    }
+    const DatabaseManager::ImageInfo info = infos.last();
+
+    measure("updateImageInfo", [=] { db->updateImageInfo(info); });
+    measure("insertImageInfos(existing)", [=] {
+        db->insertImageInfos(infos);
+    });
+
+    measure("insertImageIntoAlbum", [=] {
+        db->insertImageIntoAlbum(BENCHMARK_ALBUM, info.name);
+    }, 0, [=] {
+        db->removeAlbum(BENCHMARK_ALBUM);
+    });
+    measure("insertImagesIntoAlbum", [=] {
+        db->insertImagesIntoAlbum(BENCHMARK_ALBUM, names);
+    }, 0, [=] {
+        db->removeAlbum(BENCHMARK_ALBUM);
+    });
+
+    db->insertImagesIntoAlbum(BENCHMARK_ALBUM, names);
+    measure("removeImageFromAlbum", [=] {
+        db->removeImageFromAlbum(BENCHMARK_ALBUM, info.name);
+    }, 0, [=] {
+        db->insertImageIntoAlbum(BENCHMARK_ALBUM, info.name);
+    });
+    measure("removeImagesFromAlbum", [=] {
+        db->removeImagesFromAlbum(BENCHMARK_ALBUM, names);
+    }, 0, [=] {
+        db->insertImagesIntoAlbum(BENCHMARK_ALBUM, names);
+    });
+    measure("renameAlbum", [=] {
+        db->renameAlbum(BENCHMARK_ALBUM, BENCHMARK_ALBUM + "_renamed");
+    }, 0, [=] {
+        db->renameAlbum(BENCHMARK_ALBUM + "_renamed", BENCHMARK_ALBUM);
+    });
+    measure("removeAlbum", [=] {
+        db->removeAlbum(BENCHMARK_ALBUM);
+    }, 0, [=] {
+        db->insertImagesIntoAlbum(BENCHMARK_ALBUM, names);
+    });
+    db->removeAlbum(BENCHMARK_ALBUM);
+
+    // The images of a day are moved to another directory and back
+    const QString dayDir = QFileInfo(info.path).absolutePath();
+    const QString movedDir = dayDir + "_moved";
+    measure("moveDirectory", [=] {
+        db->moveDirectory(dayDir, movedDir);
+    }, 0, [=] {
+        db->moveDirectory(movedDir, dayDir);
+    });
+
+    // Not waited, it times the cost of the caller only
+    QMap<QString, QString> metadata;
+    metadata.insert("Make", info.camera);
+    metadata.insert("LensModel", info.lens);
+    metadata.insert("DateTimeOriginal", info.time.toString(Qt::ISODate));
+    measure("insertMetadata", [=] {
+        db->insertMetadata(info.path, 1, 1, metadata);
+    });
+    // Waited, the metadata queued before are written when it returns
+    measure("insertImportRoot", [=] {
+        db->insertImportRoot(dayDir, BENCHMARK_ALBUM);
+    });
+    measure("getMetadata", [=] {
+        QMap<QString, QString> cached;
+        db->getMetadata(info.path, 1, 1, cached);
+    });
+    measure("getImportRoots", [=] { db->getImportRoots(); });
+
+    measure("clearRecentImported", [=] { db->clearRecentImported(); });
+    // Insert them again with the same albums
+    measure("removeImages", [=] {
+        db->removeImages(names);
+    }, qMin(m_iterations, 3), [=] {
+        db->insertImageInfos(infos);
+    });
+}
+
+/*!
+ * \brief DatabaseBenchmark::measure
+ * \param name
+ * \param func the timed call
+ * \param iterations 0 for the default iterations
+ * \param reset an untimed call after every iteration to restore the library
+ */
+void DatabaseBenchmark::measure(const QString &name,
+                                const std::function<void()> &func,
+                                int iterations,
+                                const std::function<void()> &reset)
+{
+    iterations = iterations > 0 ? iterations : m_iterations;
+    QList<double> samples;
+    QElapsedTimer timer;
+    for (int i = 0; i < iterations; i ++) {
+        timer.start();
+        func();
+        samples << timer.nsecsElapsed() / 1000000.0;
+        if (reset) {
+            reset();
+        }
+    }
+    qSort(samples);
+
+    double total = 0;
+    for (double sample : samples) {
+        total += sample;
+    }
+
+    QJsonObject result;
+    result.insert("images", m_imageCount);
+    result.insert("name", name);
+    result.insert("iterations", iterations);
+    result.insert("min_ms", samples.first());
+    result.insert("median_ms", samples.at(samples.length() / 2));
+    result.insert("mean_ms", total / samples.length());
+    result.insert("max_ms", samples.last());
+    m_results.append(result);
+
+    qDebug() << qPrintable(name) << samples.at(samples.length() / 2) << "ms";
+}
+
+/*!
+ * \brief DatabaseBenchmark::imageInfo
+ * Images are taken in events of IMAGES_PER_EVENT images, every event is
+ * in a random day and a directory of that day, like most cameras import.
+ * \param index
+ * \return
+ */
+DatabaseManager::ImageInfo DatabaseBenchmark::imageInfo(int index) const
+{
+    const quint32 event = index / IMAGES_PER_EVENT;
+    const QDate day = START_DATE.addDays(hash(event) % EVENT_DAYS);
+
+    DatabaseManager::ImageInfo info;
+    info.name = QString("IMG_%1.jpg").arg(index, 7, 10, QChar('0'));
+    info.path = QString("/synthetic/%1/%2/%3").arg(day.year())
+            .arg(day.toString("yyyy-MM-dd")).arg(info.name);
+    info.time = QDateTime(day, QTime(8 + hash(event) % 12, 0))
+            .addSecs((index % IMAGES_PER_EVENT) * 90);
+    info.size = hash(index) % 5 == 0 ? QSize(3000, 4000) : QSize(4000, 3000);
+    info.camera = CAMERAS[hash(event) % CAMERAS.length()];
+    info.lens = LENSES[CAMERAS.indexOf(info.camera)];
+
+    const QString album = albumOf(index);
+    if (! album.isEmpty()) {
+        info.albums << album;
+    }
+    if (hash(index) % 50 == 0) {
+        info.albums << FAVORITES_ALBUM;
+    }
+
+    return info;
+}
+
+// A quarter of events are in albums, an album holds up to 20 events
+QString DatabaseBenchmark::albumOf(int index) const
+{
+    const quint32 event = index / IMAGES_PER_EVENT;
+    if (hash(event ^ 0x9e3779b9) % 4 != 0) {
+        return QString();
+    }
+
+    return QString("Album %1").arg(event / 20);
+}
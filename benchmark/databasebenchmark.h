@@ -0,0 +1,43 @@
+#ifndef DATABASEBENCHMARK_H
+#define DATABASEBENCHMARK_H
+
+#include "controller/databasemanager.h"
+#include <QJsonArray>
+#include <QJsonObject>
+#include <functional>
+
+/*!
+ * \brief The DatabaseBenchmark class
+ * Grow a synthetic library and time the DatabaseManager on it.
+ * The generated images only depend on their index, so libraries of the
+ * same size are the same between builds, and growing a library to a
+ * larger size keeps the images it already has.
+ */
+class DatabaseBenchmark
+{
+public:
+    explicit DatabaseBenchmark(int iterations);
+
+    // Grow the library to count images and time everything on it
+    void run(int count);
+    QJsonObject results() const;
+
+private:
+    void generate(int count);
+    void measureQueries();
+    void measureSequences();
+    void measureMutations();
+    void measure(const QString &name, const std::function<void()> &func,
+                 int iterations = 0,
+                 const std::function<void()> &reset = nullptr);
+
+    DatabaseManager::ImageInfo imageInfo(int index) const;
+    QString albumOf(int index) const;
+
+private:
+    int m_iterations;
+    int m_imageCount;
+    QJsonArray m_results;
+};
+
+#endif // DATABASEBENCHMARK_H
@@ -0,0 +1,101 @@
+#include "application.h"
+#include "databasebenchmark.h"
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QSettings>
+#include <QTemporaryDir>
+
+namespace {
+
+const QString DEFAULT_SIZES = "10000,100000,1000000";
+const QString DEFAULT_DATABASE = QDir::tempPath() +
+        "/deepin-image-viewer-benchmark.db";
+
+}  // namespace
+
+/*!
+ * Time the DatabaseManager on synthetic libraries, eg:
+ *   deepin-image-viewer-benchmark --sizes 10000,100000 --output result.json
+ * The library grows from one size to the next, the results of every size
+ * are written as JSON to compare between builds.
+ */
+int main(int argc, char *argv[])
+{
+    QStringList arguments;
+    for (int i = 0; i < argc; i ++) {
+        arguments << QString::fromLocal8Bit(argv[i]);
+    }
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption("sizes",
+        "Comma separated image counts of libraries.", "sizes", DEFAULT_SIZES));
+    parser.addOption(QCommandLineOption("iterations",
+        "Runs of every timed call.", "count", "10"));
+    parser.addOption(QCommandLineOption("database",
+        "Library to reuse, a new one in the temp directory by default.",
+        "file"));
+    parser.addOption(QCommandLineOption("output",
+        "File of the JSON results, stdout by default.", "file"));
+    if (! parser.parse(arguments) || parser.isSet("help")) {
+        qWarning() << qPrintable(parser.errorText());
+        qWarning() << qPrintable(parser.helpText());
+        return 1;
+    }
+
+    // The database must be set before Application creates DatabaseManager
+    QString database = parser.value("database");
+    if (database.isEmpty()) {
+        database = DEFAULT_DATABASE;
+        for (const QString &suffix : QStringList() << "" << "-wal" << "-shm") {
+            QFile::remove(database + suffix);
+        }
+    }
+    DatabaseManager::setDatabasePath(database);
+
+    // Keep the settings of the user out of it, ConfigSetter reads the
+    // defaults from an empty configuration
+    QTemporaryDir config;
+    if (! config.isValid()) {
+        qWarning() << "Create config directory failed";
+        return 1;
+    }
+    QSettings::setPath(QSettings::NativeFormat, QSettings::UserScope,
+                       config.path());
+
+    // No window is shown, it runs without a display
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+    Application a(argc, argv);
+
+    DatabaseBenchmark benchmark(parser.value("iterations").toInt());
+    QList<int> sizes;
+    for (const QString &size : parser.value("sizes").split(",")) {
+        sizes << size.toInt();
+    }
+    qSort(sizes);
+    for (int size : sizes) {
+        benchmark.run(size);
+    }
+    // No event loop ran, so aboutToQuit isn't emitted, the writer thread of
+    // the database is stopped here
+    a.shutdown();
+
+    const QByteArray json = QJsonDocument(benchmark.results()).toJson();
+    QFile output;
+    if (parser.value("output").isEmpty()) {
+        output.open(stdout, QIODevice::WriteOnly);
+    }
+    else {
+        output.setFileName(parser.value("output"));
+        if (! output.open(QIODevice::WriteOnly)) {
+            qWarning() << "Open output file failed: " << output.errorString();
+            return 1;
+        }
+    }
+    output.write(json);
+
+    return 0;
+}
@@ -2,3 +2,13 @@ TEMPLATE = subdirs
 SUBDIRS += \
         viewer \
         qimage-plugins
+
+# The database benchmark is only built by: qmake CONFIG+=benchmark
+CONFIG(benchmark) {
+    SUBDIRS += benchmark
+}
+
+# The unit tests are only built by: qmake CONFIG+=tests
+CONFIG(tests) {
+    SUBDIRS += tests
+}
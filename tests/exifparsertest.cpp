@@ -0,0 +1,343 @@
+#include "exifparsertest.h"
+#include "utils/exifparser.h"
+#include <QFile>
+#include <QPair>
+#include <QtTest>
+
+using namespace utils::image;
+
+namespace {
+
+// Where the parts are put in the TIFF structure
+const int IFD0_OFFSET = 8;
+const int EXIF_IFD_OFFSET = 200;
+const int GPS_IFD_OFFSET = 300;
+const int IFD1_OFFSET = 400;
+const int DATA_OFFSET = 512;
+const int THUMBNAIL_OFFSET = 900;
+const int THUMBNAIL_LENGTH = 50;
+const int TIFF_SIZE = 1024;
+
+enum Type {
+    TypeByte = 1,
+    TypeAscii = 2,
+    TypeShort = 3,
+    TypeLong = 4,
+    TypeRational = 5
+};
+
+struct Entry {
+    quint16 tag;
+    quint16 type;
+    quint32 count;
+    QByteArray value;  // In the byte order of the file
+};
+
+/*!
+ * \brief The TiffWriter class
+ * Lay out the IFDs at the given offsets, the values which don't fit in
+ * their entries are put one after another from DATA_OFFSET.
+ */
+class TiffWriter
+{
+public:
+    explicit TiffWriter(bool bigEndian)
+        : m_data(TIFF_SIZE, 0),
+          m_bigEndian(bigEndian),
+          m_dataEnd(DATA_OFFSET)
+    {
+        m_data.replace(0, 2, bigEndian ? "MM" : "II");
+        m_data.replace(2, 2, u16(42));
+        m_data.replace(4, 4, u32(IFD0_OFFSET));
+    }
+
+    QByteArray u16(quint16 value) const
+    {
+        QByteArray bytes(2, 0);
+        bytes[m_bigEndian ? 0 : 1] = char(value >> 8);
+        bytes[m_bigEndian ? 1 : 0] = char(value);
+        return bytes;
+    }
+
+    QByteArray u32(quint32 value) const
+    {
+        QByteArray bytes(4, 0);
+        for (int i = 0; i < 4; i ++) {
+            bytes[m_bigEndian ? 3 - i : i] = char(value >> (i * 8));
+        }
+        return bytes;
+    }
+
+    Entry byteEntry(quint16 tag, quint8 value) const
+    {
+        return Entry{tag, TypeByte, 1, QByteArray(1, char(value))};
+    }
+
+    Entry shortEntry(quint16 tag, quint16 value) const
+    {
+        return Entry{tag, TypeShort, 1, u16(value)};
+    }
+
+    Entry longEntry(quint16 tag, quint32 value) const
+    {
+        return Entry{tag, TypeLong, 1, u32(value)};
+    }
+
+    Entry asciiEntry(quint16 tag, const QByteArray &value) const
+    {
+        const QByteArray terminated = value + '\0';
+        return Entry{tag, TypeAscii, quint32(terminated.length()), terminated};
+    }
+
+    // Pairs of numerator and denominator
+    Entry rationalEntry(quint16 tag,
+                        const QList<QPair<quint32, quint32>> &values) const
+    {
+        QByteArray bytes;
+        for (auto value : values) {
+            bytes += u32(value.first) + u32(value.second);
+        }
+        return Entry{tag, TypeRational, quint32(values.length()), bytes};
+    }
+
+    void writeIfd(int offset, const QList<Entry> &entries, quint32 next = 0)
+    {
+        m_data.replace(offset, 2, u16(entries.length()));
+        for (int i = 0; i < entries.length(); i ++) {
+            const Entry &entry = entries.at(i);
+            const int pos = offset + 2 + i * 12;
+            m_data.replace(pos, 2, u16(entry.tag));
+            m_data.replace(pos + 2, 2, u16(entry.type));
+            m_data.replace(pos + 4, 4, u32(entry.count));
+            if (entry.value.length() <= 4) {
+                m_data.replace(pos + 8, entry.value.length(), entry.value);
+            }
+            else {
+                m_data.replace(pos + 8, 4, u32(m_dataEnd));
+                m_data.replace(m_dataEnd, entry.value.length(), entry.value);
+                // Values start on a word boundary
+                m_dataEnd += (entry.value.length() + 1) & ~1;
+            }
+        }
+        m_data.replace(offset + 2 + entries.length() * 12, 4, u32(next));
+    }
+
+    QByteArray data() const
+    {
+        return m_data;
+    }
+
+private:
+    QByteArray m_data;
+    const bool m_bigEndian;
+    int m_dataEnd;
+};
+
+// The TIFF of a camera, IFD0 is a preview of 160x120 if it's reduced
+QByteArray cameraTiff(bool bigEndian, bool reduced = false, int orientation = 6)
+{
+    TiffWriter writer(bigEndian);
+    QList<Entry> ifd0;
+    if (reduced) {
+        ifd0 << writer.longEntry(0x00FE, 1);
+    }
+    ifd0 << writer.longEntry(0x0100, reduced ? 160 : 4000)
+         << writer.longEntry(0x0101, reduced ? 120 : 3000)
+         << writer.asciiEntry(0x010F, "SONY")
+         << writer.asciiEntry(0x0110, "ILCE-7M2")
+         << writer.shortEntry(0x0112, orientation)
+         << writer.longEntry(0x8769, EXIF_IFD_OFFSET)
+         << writer.longEntry(0x8825, GPS_IFD_OFFSET);
+    writer.writeIfd(IFD0_OFFSET, ifd0, IFD1_OFFSET);
+
+    writer.writeIfd(EXIF_IFD_OFFSET, QList<Entry>()
+                    << writer.asciiEntry(0x9003, "2017:05:04 10:20:30")
+                    << writer.longEntry(0xA002, 6000)
+                    << writer.longEntry(0xA003, 4000)
+                    << writer.asciiEntry(0xA434, "FE 28-70mm F3.5-5.6 OSS"));
+
+    // 33 51' 36" S, 151 12' 36" E, 29 m below the sea level
+    typedef QPair<quint32, quint32> Rational;
+    writer.writeIfd(GPS_IFD_OFFSET, QList<Entry>()
+                    << writer.asciiEntry(1, "S")
+                    << writer.rationalEntry(2, QList<Rational>()
+                                            << Rational(33, 1) << Rational(51, 1)
+                                            << Rational(36, 1))
+                    << writer.asciiEntry(3, "E")
+                    << writer.rationalEntry(4, QList<Rational>()
+                                            << Rational(151, 1) << Rational(12, 1)
+                                            << Rational(3600, 100))
+                    << writer.byteEntry(5, 1)
+                    << writer.rationalEntry(6, QList<Rational>()
+                                            << Rational(58, 2)));
+
+    writer.writeIfd(IFD1_OFFSET, QList<Entry>()
+                    << writer.longEntry(0x0201, THUMBNAIL_OFFSET)
+                    << writer.longEntry(0x0202, THUMBNAIL_LENGTH));
+
+    return writer.data();
+}
+
+// SOI, APP0 of JFIF, APP1 of the EXIF if there is, SOF0 of 640x480, SOS
+QByteArray jpeg(const QByteArray &tiff)
+{
+    QByteArray data("\xFF\xD8", 2);
+    data += QByteArray("\xFF\xE0\0\x10JFIF\0\x01\x01\0\0\x01\0\x01\0\0", 18);
+    if (! tiff.isEmpty()) {
+        const int length = 2 + 6 + tiff.length();
+        data += QByteArray("\xFF\xE1", 2);
+        data += char(length >> 8);
+        data += char(length & 0xFF);
+        data += QByteArray("Exif\0\0", 6) + tiff;
+    }
+    data += QByteArray("\xFF\xC0\0\x11\x08\x01\xE0\x02\x80\x03"
+                       "\x01\x22\0\x02\x11\x01\x03\x11\x01", 19);
+    data += QByteArray("\xFF\xDA\0\x0C\x03\x01\0\x02\x11\x03\x11\0\x3F\0", 14);
+    data += QByteArray("\xFF\xD9", 2);
+    return data;
+}
+
+void verifyCameraInfo(const ExifInfo &info)
+{
+    QVERIFY(info.valid);
+    QCOMPARE(info.camera, QString("SONY ILCE-7M2"));
+    QCOMPARE(info.lens, QString("FE 28-70mm F3.5-5.6 OSS"));
+    QCOMPARE(info.dateTimeOriginal,
+             QDateTime(QDate(2017, 5, 4), QTime(10, 20, 30)));
+    QVERIFY(info.hasGps);
+    QCOMPARE(info.latitude, - (33 + 51 / 60.0 + 36 / 3600.0));
+    QCOMPARE(info.longitude, 151 + 12 / 60.0 + 36 / 3600.0);
+    QCOMPARE(info.altitude, -29.0);
+    QCOMPARE(info.thumbnailLength, qint64(THUMBNAIL_LENGTH));
+}
+
+}  // namespace
+
+void ExifParserTest::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+}
+
+QString ExifParserTest::writeFile(const QString &name, const QByteArray &data)
+{
+    const QString path = m_dir.path() + "/" + name;
+    QFile file(path);
+    if (! file.open(QIODevice::WriteOnly) || file.write(data) != data.length()) {
+        return QString();
+    }
+    return path;
+}
+
+void ExifParserTest::parseTiff_data()
+{
+    QTest::addColumn<bool>("bigEndian");
+
+    QTest::newRow("little endian") << false;
+    QTest::newRow("big endian") << true;
+}
+
+void ExifParserTest::parseTiff()
+{
+    QFETCH(bool, bigEndian);
+
+    const QString path = writeFile("camera.tif", cameraTiff(bigEndian));
+    QVERIFY(! path.isEmpty());
+    const ExifInfo info = readExif(path);
+    verifyCameraInfo(info);
+    if (QTest::currentTestFailed()) {
+        return;
+    }
+    QCOMPARE(info.orientation, 6);
+    // IFD0 describes the image itself
+    QCOMPARE(info.size, QSize(4000, 3000));
+    QCOMPARE(info.thumbnailOffset, qint64(THUMBNAIL_OFFSET));
+}
+
+void ExifParserTest::parseReducedTiff()
+{
+    // IFD0 of most camera raws is a preview, the size is of EXIF then
+    const QString path = writeFile("camera.dng", cameraTiff(false, true));
+    QVERIFY(! path.isEmpty());
+    const ExifInfo info = readExif(path);
+    verifyCameraInfo(info);
+    if (QTest::currentTestFailed()) {
+        return;
+    }
+    QCOMPARE(info.size, QSize(6000, 4000));
+}
+
+void ExifParserTest::parseJpeg()
+{
+    const QByteArray data = jpeg(cameraTiff(true));
+    const QString path = writeFile("camera.jpg", data);
+    QVERIFY(! path.isEmpty());
+    const ExifInfo info = readExif(path);
+    verifyCameraInfo(info);
+    if (QTest::currentTestFailed()) {
+        return;
+    }
+    QCOMPARE(info.orientation, 6);
+    // The frame header wins, some editors don't update EXIF
+    QCOMPARE(info.size, QSize(640, 480));
+    // Offsets in the segment are relative to its TIFF header
+    QCOMPARE(info.thumbnailOffset,
+             qint64(data.indexOf("Exif") + 6 + THUMBNAIL_OFFSET));
+}
+
+void ExifParserTest::parseJpegWithoutExif()
+{
+    const QString path = writeFile("plain.jpg", jpeg(QByteArray()));
+    QVERIFY(! path.isEmpty());
+    const ExifInfo info = readExif(path);
+    QVERIFY(! info.valid);
+    QCOMPARE(info.orientation, 1);
+    QCOMPARE(info.size, QSize(640, 480));
+}
+
+void ExifParserTest::rejectInvalidOrientation()
+{
+    const QString path = writeFile("rotated.tif", cameraTiff(false, false, 9));
+    QVERIFY(! path.isEmpty());
+    QCOMPARE(readExif(path).orientation, 1);
+}
+
+void ExifParserTest::stopAtSelfLinkedIfd()
+{
+    TiffWriter writer(false);
+    writer.writeIfd(IFD0_OFFSET, QList<Entry>()
+                    << writer.shortEntry(0x0112, 3), IFD0_OFFSET);
+    const QString path = writeFile("loop.tif", writer.data());
+    QVERIFY(! path.isEmpty());
+
+    const ExifInfo info = readExif(path);
+    QVERIFY(info.valid);
+    QCOMPARE(info.orientation, 3);
+    QCOMPARE(info.thumbnailLength, qint64(0));
+}
+
+void ExifParserTest::stopAtTruncatedFile()
+{
+    // Cut in the middle of IFD0, nothing is read out of the file
+    const QString path = writeFile("truncated.tif",
+                                   cameraTiff(false).left(IFD0_OFFSET + 50));
+    QVERIFY(! path.isEmpty());
+
+    const ExifInfo info = readExif(path);
+    QVERIFY(info.camera.isEmpty());
+    QVERIFY(! info.dateTimeOriginal.isValid());
+    QVERIFY(! info.hasGps);
+    QCOMPARE(info.thumbnailLength, qint64(0));
+}
+
+void ExifParserTest::rejectOtherFiles()
+{
+    const QString text = writeFile("notes.txt", "II are two letters");
+    QVERIFY(! text.isEmpty());
+    QVERIFY(! readExif(text).valid);
+
+    const QString png = writeFile("image.png", QByteArray("\x89PNG\r\n\x1A\n", 8));
+    QVERIFY(! png.isEmpty());
+    QVERIFY(! readExif(png).valid);
+
+    QVERIFY(! readExif(m_dir.path() + "/missing.jpg").valid);
+}
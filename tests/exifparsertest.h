@@ -0,0 +1,36 @@
+#ifndef EXIFPARSERTEST_H
+#define EXIFPARSERTEST_H
+
+#include <QObject>
+#include <QTemporaryDir>
+
+/*!
+ * \brief The ExifParserTest class
+ * readExif() on TIFF structures built byte by byte, alone as a TIFF file or
+ * in the APP1 segment of JPEG, in both byte orders.
+ */
+class ExifParserTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void parseTiff_data();
+    void parseTiff();
+    void parseReducedTiff();
+    void parseJpeg();
+    void parseJpegWithoutExif();
+    void rejectInvalidOrientation();
+    void stopAtSelfLinkedIfd();
+    void stopAtTruncatedFile();
+    void rejectOtherFiles();
+
+private:
+    QString writeFile(const QString &name, const QByteArray &data);
+
+private:
+    QTemporaryDir m_dir;
+};
+
+#endif // EXIFPARSERTEST_H
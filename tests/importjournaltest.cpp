@@ -0,0 +1,186 @@
+#include "importjournaltest.h"
+#include "controller/databasemanager.h"
+#include "controller/importjournal.h"
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QtTest>
+#include <utime.h>
+
+namespace {
+
+const int EXPIRED_DAYS = 31;
+
+QString statePath(const QString &id)
+{
+    return QFileInfo(DatabaseManager::databasePath()).absolutePath()
+            + "/import-journals/" + id + "/state.json";
+}
+
+bool setModified(const QString &path, const QDateTime &time)
+{
+    struct utimbuf times;
+    times.actime = time.toTime_t();
+    times.modtime = time.toTime_t();
+    return utime(QFile::encodeName(path).constData(), &times) == 0;
+}
+
+}  // namespace
+
+void ImportJournalTest::init()
+{
+    QVERIFY(ImportJournal::journalIds().isEmpty());
+}
+
+void ImportJournalTest::cleanup()
+{
+    // The importer would resume the ones left
+    for (const QString &id : ImportJournal::journalIds()) {
+        ImportJournal(id).remove();
+    }
+}
+
+void ImportJournalTest::saveNewJournal()
+{
+    const QStringList roots = QStringList() << "/photos/2016" << "/photos/2017";
+    ImportJournal journal(roots, "Holiday");
+    QVERIFY(journal.isValid());
+    QCOMPARE(ImportJournal::journalIds(), QStringList() << journal.id());
+
+    ImportJournal loaded(journal.id());
+    QVERIFY(loaded.isValid());
+    QCOMPARE(loaded.roots(), roots);
+    QCOMPARE(loaded.album(), QString("Holiday"));
+    QVERIFY(! loaded.isStopped());
+    QVERIFY(! loaded.isWalked());
+    QCOMPARE(loaded.chunkCount(), 0);
+    QCOMPARE(loaded.committedCount(), 0);
+
+    // Imports started in the same ms get their own journal
+    ImportJournal other(roots, "Holiday");
+    QVERIFY(other.id() != journal.id());
+    QCOMPARE(ImportJournal::journalIds().length(), 2);
+}
+
+void ImportJournalTest::keepChunkPaths()
+{
+    ImportJournal journal(QStringList() << "/photos", QString());
+    // Everything but '\0' is allowed in a file name
+    const QStringList paths = QStringList()
+            << "/photos/IMG_0001.jpg"
+            << "/photos/new\nline.jpg"
+            << "/photos/with space .jpg"
+            << "/photos/tab\tand\rreturn.png"
+            << QString::fromUtf8("/photos/\xE7\x85\xA7\xE7\x89\x87.png");
+    QCOMPARE(journal.appendChunk(paths), 0);
+    QCOMPARE(journal.appendChunk(QStringList() << "/photos/IMG_0002.jpg"), 1);
+    QCOMPARE(journal.appendChunk(QStringList()), 2);
+
+    ImportJournal loaded(journal.id());
+    QCOMPARE(loaded.chunkCount(), 3);
+    QCOMPARE(loaded.chunk(0), paths);
+    QCOMPARE(loaded.chunk(1), QStringList() << "/photos/IMG_0002.jpg");
+    QVERIFY(loaded.chunk(2).isEmpty());
+    QVERIFY(loaded.chunk(3).isEmpty());
+}
+
+void ImportJournalTest::failAppendOfRemoved()
+{
+    ImportJournal journal(QStringList() << "/photos", QString());
+    QCOMPARE(journal.appendChunk(QStringList() << "/photos/IMG_0001.jpg"), 0);
+
+    journal.remove();
+    QVERIFY(! journal.isValid());
+    QCOMPARE(journal.appendChunk(QStringList() << "/photos/IMG_0002.jpg"), -1);
+    QCOMPARE(journal.chunkCount(), 1);
+    QVERIFY(ImportJournal::journalIds().isEmpty());
+}
+
+void ImportJournalTest::truncateChunks()
+{
+    ImportJournal journal(QStringList() << "/photos", QString());
+    for (int i = 0; i < 3; i ++) {
+        QCOMPARE(journal.appendChunk(QStringList()
+                                     << QString("/photos/IMG_%1.jpg").arg(i)), i);
+    }
+    journal.setWalked();
+    journal.setCommittedCount(2);
+
+    journal.truncate(1);
+    QCOMPARE(journal.chunkCount(), 1);
+    QCOMPARE(journal.committedCount(), 1);
+    QVERIFY(! journal.isWalked());
+    QVERIFY(journal.chunk(1).isEmpty());
+    QVERIFY(journal.chunk(2).isEmpty());
+
+    // Truncating past the end changes nothing
+    journal.truncate(5);
+    QCOMPARE(journal.chunkCount(), 1);
+
+    ImportJournal loaded(journal.id());
+    QCOMPARE(loaded.chunkCount(), 1);
+    QCOMPARE(loaded.committedCount(), 1);
+    QVERIFY(! loaded.isWalked());
+    QCOMPARE(loaded.chunk(0), QStringList() << "/photos/IMG_0.jpg");
+    // The index goes on from the truncation
+    QCOMPARE(loaded.appendChunk(QStringList() << "/photos/IMG_1.jpg"), 1);
+}
+
+void ImportJournalTest::saveCommittedCount()
+{
+    ImportJournal journal(QStringList() << "/photos", "Album");
+    journal.appendChunk(QStringList() << "/photos/IMG_0001.jpg");
+    journal.appendChunk(QStringList() << "/photos/IMG_0002.jpg");
+    journal.setCommittedCount(1);
+    journal.setStopped(true);
+
+    ImportJournal loaded(journal.id());
+    QCOMPARE(loaded.committedCount(), 1);
+    QVERIFY(loaded.isStopped());
+    loaded.setStopped(false);
+    QVERIFY(! ImportJournal(journal.id()).isStopped());
+}
+
+void ImportJournalTest::rejectOtherVersion()
+{
+    const QString id = ImportJournal(QStringList() << "/photos", QString()).id();
+    // The newline separated chunks of version 1 can't be read
+    QFile state(statePath(id));
+    QVERIFY(state.open(QIODevice::WriteOnly));
+    state.write("{\"roots\":[\"/photos\"],\"album\":\"\",\"stopped\":false,"
+                "\"walked\":true,\"chunkCount\":0,\"committedCount\":0}");
+    state.close();
+    QVERIFY(! ImportJournal(id).isValid());
+
+    // Nor can a broken one, both are removed
+    const QString broken = ImportJournal(QStringList() << "/photos", QString()).id();
+    QFile brokenState(statePath(broken));
+    QVERIFY(brokenState.open(QIODevice::WriteOnly));
+    brokenState.write("{\"version\":");
+    brokenState.close();
+    QVERIFY(! ImportJournal(broken).isValid());
+
+    ImportJournal::removeExpired();
+    QVERIFY(ImportJournal::journalIds().isEmpty());
+}
+
+void ImportJournalTest::expireStoppedJournals()
+{
+    const QDateTime expired =
+            QDateTime::currentDateTime().addDays(- EXPIRED_DAYS);
+
+    ImportJournal stoppedExpired(QStringList() << "/stopped/expired", QString());
+    stoppedExpired.setStopped(true);
+    QVERIFY(setModified(statePath(stoppedExpired.id()), expired));
+
+    ImportJournal stopped(QStringList() << "/stopped", QString());
+    stopped.setStopped(true);
+
+    // An interrupted one is resumed however old it is
+    ImportJournal interrupted(QStringList() << "/interrupted", QString());
+    QVERIFY(setModified(statePath(interrupted.id()), expired));
+
+    ImportJournal::removeExpired();
+    QCOMPARE(ImportJournal::journalIds(),
+             QStringList() << stopped.id() << interrupted.id());
+}
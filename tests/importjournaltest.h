@@ -0,0 +1,29 @@
+#ifndef IMPORTJOURNALTEST_H
+#define IMPORTJOURNALTEST_H
+
+#include <QObject>
+
+/*!
+ * \brief The ImportJournalTest class
+ * The journal must give back the walked paths as they were, whatever they
+ * contain, and keep the committed cursor consistent over truncation,
+ * reloading and expiry.
+ */
+class ImportJournalTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void saveNewJournal();
+    void keepChunkPaths();
+    void failAppendOfRemoved();
+    void truncateChunks();
+    void saveCommittedCount();
+    void rejectOtherVersion();
+    void expireStoppedJournals();
+};
+
+#endif // IMPORTJOURNALTEST_H
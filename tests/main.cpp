@@ -0,0 +1,51 @@
+#include "application.h"
+#include "controller/databasemanager.h"
+#include "exifparsertest.h"
+#include "importjournaltest.h"
+#include "orientationtest.h"
+#include "rescantest.h"
+#include "searchtest.h"
+#include "sniffertest.h"
+#include <QDebug>
+#include <QSettings>
+#include <QTemporaryDir>
+#include <QtTest>
+
+/*!
+ * Run the unit tests of the viewer, eg:
+ *   deepin-image-viewer-tests
+ * The database, the import journals and the settings live in a temporary
+ * directory, so nothing of the user is touched. The test classes share the
+ * database, the images of every class have their own names.
+ */
+int main(int argc, char *argv[])
+{
+    QTemporaryDir dir;
+    if (! dir.isValid()) {
+        qWarning() << "Create temporary directory failed";
+        return 1;
+    }
+    // The database must be set before Application creates DatabaseManager
+    DatabaseManager::setDatabasePath(dir.path() + "/deepinimageviewer.db");
+    QSettings::setPath(QSettings::NativeFormat, QSettings::UserScope,
+                       dir.path() + "/config");
+
+    // No window is shown, it runs without a display
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+    Application a(argc, argv);
+
+    QList<QObject *> tests;
+    tests << new SearchTest << new RescanTest << new SnifferTest
+          << new ImportJournalTest << new ExifParserTest
+          << new OrientationTest;
+
+    int result = 0;
+    for (QObject *test : tests) {
+        result |= QTest::qExec(test, argc, argv);
+        delete test;
+    }
+
+    // No event loop ran to the end, so aboutToQuit isn't emitted
+    a.shutdown();
+    return result;
+}
@@ -0,0 +1,72 @@
+#include "orientationtest.h"
+#include "utils/imageutils.h"
+#include <QImage>
+#include <QtTest>
+
+namespace {
+
+const int WIDTH = 3;
+const int HEIGHT = 2;
+
+// Every pixel tells where it is
+QImage stored()
+{
+    QImage image(WIDTH, HEIGHT, QImage::Format_RGB32);
+    for (int y = 0; y < HEIGHT; y ++) {
+        for (int x = 0; x < WIDTH; x ++) {
+            image.setPixel(x, y, qRgb(x * 50, y * 50, 0));
+        }
+    }
+    return image;
+}
+
+// The stored pixel shown at (x, y) by the orientation
+QPoint storedPoint(int orientation, int x, int y)
+{
+    switch (orientation) {
+    case 2:  // Mirrored horizontally
+        return QPoint(WIDTH - 1 - x, y);
+    case 3:  // Rotated by 180 degrees
+        return QPoint(WIDTH - 1 - x, HEIGHT - 1 - y);
+    case 4:  // Mirrored vertically
+        return QPoint(x, HEIGHT - 1 - y);
+    case 5:  // Transposed
+        return QPoint(y, x);
+    case 6:  // Rotated by 90 degrees clockwise
+        return QPoint(y, HEIGHT - 1 - x);
+    case 7:  // Transversed
+        return QPoint(WIDTH - 1 - y, HEIGHT - 1 - x);
+    case 8:  // Rotated by 90 degrees counterclockwise
+        return QPoint(WIDTH - 1 - y, x);
+    default:
+        return QPoint(x, y);
+    }
+}
+
+}  // namespace
+
+void OrientationTest::applyOrientation_data()
+{
+    QTest::addColumn<int>("orientation");
+
+    for (int orientation = 0; orientation <= 9; orientation ++) {
+        QTest::newRow(qPrintable(QString::number(orientation))) << orientation;
+    }
+}
+
+void OrientationTest::applyOrientation()
+{
+    QFETCH(int, orientation);
+
+    const QImage image = stored();
+    const QImage shown = utils::image::applyOrientation(image, orientation);
+    const bool transposed = orientation >= 5 && orientation <= 8;
+    QCOMPARE(shown.size(), transposed ? image.size().transposed()
+                                      : image.size());
+    for (int y = 0; y < shown.height(); y ++) {
+        for (int x = 0; x < shown.width(); x ++) {
+            QCOMPARE(shown.pixel(x, y),
+                     image.pixel(storedPoint(orientation, x, y)));
+        }
+    }
+}
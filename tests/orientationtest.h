@@ -0,0 +1,20 @@
+#ifndef ORIENTATIONTEST_H
+#define ORIENTATIONTEST_H
+
+#include <QObject>
+
+/*!
+ * \brief The OrientationTest class
+ * applyOrientation() must move every pixel where the EXIF orientation says,
+ * it's checked pixel by pixel on an image whose pixels are all different.
+ */
+class OrientationTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void applyOrientation_data();
+    void applyOrientation();
+};
+
+#endif // ORIENTATIONTEST_H
@@ -0,0 +1,203 @@
+#include "rescantest.h"
+#include "application.h"
+#include "controller/databasemanager.h"
+#include "controller/importpipeline.h"
+#include "utils/dirwalker.h"
+#include <QDir>
+#include <QEventLoop>
+#include <QFile>
+#include <QImage>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTimer>
+#include <QtTest>
+#include <unistd.h>
+
+namespace {
+
+const int PIPELINE_TIMEOUT = 30000;  // ms
+
+bool writeImage(const QString &path, int side)
+{
+    QImage image(side, side, QImage::Format_RGB32);
+    image.fill(Qt::red);
+    return QDir().mkpath(QFileInfo(path).absolutePath())
+            && image.save(path, "PNG");
+}
+
+// Run a rescan of root to the end
+bool rescan(const QString &root)
+{
+    ImportPipeline pipeline(QStringList() << root, QString(), true);
+    QEventLoop loop;
+    QObject::connect(&pipeline, &ImportPipeline::finished,
+                     &loop, &QEventLoop::quit, Qt::QueuedConnection);
+    QTimer timer;
+    timer.setSingleShot(true);
+    QObject::connect(&timer, &QTimer::timeout, &loop, [&loop] {
+        loop.exit(1);
+    });
+    timer.start(PIPELINE_TIMEOUT);
+    pipeline.start();
+
+    return loop.exec() == 0;
+}
+
+bool imageExist(const QString &name)
+{
+    return dApp->databaseM->imageExist(name);
+}
+
+// Root can read whatever the permissions are
+bool canLockDirs()
+{
+    return geteuid() != 0;
+}
+
+}  // namespace
+
+void RescanTest::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+}
+
+void RescanTest::cleanupTestCase()
+{
+    QStringList names;
+    for (auto info : dApp->databaseM->getImageInfosByDirectory(m_dir.path())) {
+        names << info.name;
+    }
+    dApp->databaseM->removeImages(names);
+
+    // Or the temporary directory can't be removed
+    QFile::setPermissions(m_dir.path() + "/unreadable/locked",
+                          QFile::ReadOwner | QFile::WriteOwner | QFile::ExeOwner);
+    QFile::setPermissions(m_dir.path() + "/failed/locked",
+                          QFile::ReadOwner | QFile::WriteOwner | QFile::ExeOwner);
+}
+
+void RescanTest::importNewFiles()
+{
+    const QString root = m_dir.path() + "/new";
+    QVERIFY(writeImage(root + "/rescan_new_1.png", 8));
+    QVERIFY(writeImage(root + "/sub/rescan_new_2.png", 8));
+    QFile notes(root + "/rescan_new_notes.txt");
+    QVERIFY(notes.open(QIODevice::WriteOnly));
+    notes.write("Not an image");
+    notes.close();
+
+    QVERIFY(rescan(root));
+    QVERIFY(imageExist("rescan_new_1.png"));
+    QVERIFY(imageExist("rescan_new_2.png"));
+    QVERIFY(! imageExist("rescan_new_notes.txt"));
+    QCOMPARE(dApp->databaseM->getImageInfosByDirectory(root).length(), 2);
+}
+
+void RescanTest::removeVanishedFiles()
+{
+    const QString root = m_dir.path() + "/vanished";
+    QVERIFY(writeImage(root + "/rescan_vanished_1.png", 8));
+    QVERIFY(writeImage(root + "/rescan_vanished_2.png", 8));
+    QVERIFY(rescan(root));
+    QVERIFY(imageExist("rescan_vanished_2.png"));
+
+    QVERIFY(QFile::remove(root + "/rescan_vanished_2.png"));
+    QVERIFY(rescan(root));
+    QVERIFY(imageExist("rescan_vanished_1.png"));
+    QVERIFY(! imageExist("rescan_vanished_2.png"));
+}
+
+void RescanTest::updateChangedFiles()
+{
+    const QString root = m_dir.path() + "/changed";
+    const QString path = root + "/rescan_changed.png";
+    QVERIFY(writeImage(path, 8));
+    QVERIFY(rescan(root));
+    QCOMPARE(dApp->databaseM->getImageInfoByName("rescan_changed.png").size,
+             QSize(8, 8));
+
+    QVERIFY(writeImage(path, 16));
+    QVERIFY(rescan(root));
+    QCOMPARE(dApp->databaseM->getImageInfoByName("rescan_changed.png").size,
+             QSize(16, 16));
+}
+
+void RescanTest::keepMovedFiles()
+{
+    const QString root = m_dir.path() + "/moved";
+    QVERIFY(writeImage(root + "/from/rescan_moved.png", 8));
+    QVERIFY(rescan(root));
+
+    QVERIFY(QDir().mkpath(root + "/to"));
+    QVERIFY(QFile::rename(root + "/from/rescan_moved.png",
+                          root + "/to/rescan_moved.png"));
+    QVERIFY(rescan(root));
+    // The name is the key of library, the image is updated to the new path
+    QCOMPARE(dApp->databaseM->getImageInfoByName("rescan_moved.png").path,
+             root + "/to/rescan_moved.png");
+}
+
+void RescanTest::keepImagesOfEmptyRoot()
+{
+    // An unmounted share looks like an empty directory
+    const QString root = m_dir.path() + "/unmounted";
+    QVERIFY(writeImage(root + "/rescan_unmounted.png", 8));
+    QVERIFY(rescan(root));
+
+    QVERIFY(QFile::remove(root + "/rescan_unmounted.png"));
+    QVERIFY(rescan(root));
+    QVERIFY(imageExist("rescan_unmounted.png"));
+}
+
+void RescanTest::keepImagesOfUnreadableDir()
+{
+    if (! canLockDirs()) {
+        QSKIP("Root reads the locked directories");
+    }
+
+    const QString root = m_dir.path() + "/unreadable";
+    QVERIFY(writeImage(root + "/locked/rescan_locked.png", 8));
+    QVERIFY(writeImage(root + "/open/rescan_open.png", 8));
+    QVERIFY(writeImage(root + "/open/rescan_gone.png", 8));
+    QVERIFY(rescan(root));
+
+    QVERIFY(QFile::remove(root + "/open/rescan_gone.png"));
+    QVERIFY(QFile::setPermissions(root + "/locked", 0));
+    const bool rescanned = rescan(root);
+    QFile::setPermissions(root + "/locked",
+                          QFile::ReadOwner | QFile::WriteOwner | QFile::ExeOwner);
+    QVERIFY(rescanned);
+
+    QVERIFY(imageExist("rescan_locked.png"));
+    QVERIFY(imageExist("rescan_open.png"));
+    // The readable directories are still diffed
+    QVERIFY(! imageExist("rescan_gone.png"));
+}
+
+void RescanTest::reportUnreadableDir()
+{
+    if (! canLockDirs()) {
+        QSKIP("Root reads the locked directories");
+    }
+
+    const QString root = m_dir.path() + "/failed";
+    QVERIFY(writeImage(root + "/locked/rescan_failed_locked.png", 8));
+    QVERIFY(writeImage(root + "/open/rescan_failed_open.png", 8));
+    QVERIFY(QFile::setPermissions(root + "/locked", 0));
+
+    QMutex mutex;
+    QStringList paths;
+    utils::DirWalker walker;
+    const bool finished = walker.walk(root, [&] (const QString &path) {
+        QMutexLocker locker(&mutex);
+        paths << path;
+        return true;
+    });
+    const QStringList failedDirs = walker.failedDirs();
+    QFile::setPermissions(root + "/locked",
+                          QFile::ReadOwner | QFile::WriteOwner | QFile::ExeOwner);
+
+    QVERIFY(finished);
+    QCOMPARE(paths, QStringList() << root + "/open/rescan_failed_open.png");
+    QCOMPARE(failedDirs, QStringList() << root + "/locked");
+}
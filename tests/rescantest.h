@@ -0,0 +1,33 @@
+#ifndef RESCANTEST_H
+#define RESCANTEST_H
+
+#include <QObject>
+#include <QTemporaryDir>
+
+/*!
+ * \brief The RescanTest class
+ * A rescan diffs the files under a root with the images of the library by
+ * their state, and must not take an unreadable or unmounted directory for
+ * removed images.
+ */
+class RescanTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void importNewFiles();
+    void removeVanishedFiles();
+    void updateChangedFiles();
+    void keepMovedFiles();
+    void keepImagesOfEmptyRoot();
+    void keepImagesOfUnreadableDir();
+    void reportUnreadableDir();
+
+private:
+    QTemporaryDir m_dir;
+};
+
+#endif // RESCANTEST_H
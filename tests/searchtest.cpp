@@ -0,0 +1,139 @@
+#include "searchtest.h"
+#include "application.h"
+#include "controller/databasemanager.h"
+#include <QtTest>
+
+namespace {
+
+const QString IMAGE_NAME = "searchtest_quokka.png";
+const QString ALBUM = "Kangaroo trip";
+const int PAGE_IMAGES = 5;
+
+DatabaseManager::ImageInfo imageInfo()
+{
+    DatabaseManager::ImageInfo info;
+    info.name = IMAGE_NAME;
+    info.path = "/searchtest/wombat/" + IMAGE_NAME;
+    info.time = QDateTime(QDate(2013, 4, 5), QTime(12, 0));
+    info.size = QSize(4000, 3000);
+    info.camera = "Zorblax Z1";
+    info.lens = "Glimmer 50mm";
+    return info;
+}
+
+QStringList searchNames(const QString &keywords, int offset = 0,
+                        int count = 100)
+{
+    QStringList names;
+    for (auto info : dApp->databaseM->searchImageInfos(keywords, offset, count)) {
+        names << info.name;
+    }
+    return names;
+}
+
+}  // namespace
+
+void SearchTest::init()
+{
+    QVERIFY(dApp->databaseM->insertImageInfos(
+                QList<DatabaseManager::ImageInfo>() << imageInfo()));
+}
+
+void SearchTest::cleanup()
+{
+    QStringList names = QStringList() << IMAGE_NAME;
+    for (int i = 0; i < PAGE_IMAGES; i ++) {
+        names << QString("searchtest_page_%1.png").arg(i);
+    }
+    dApp->databaseM->removeImages(names);
+    dApp->databaseM->removeAlbum(ALBUM);
+    dApp->databaseM->removeAlbum(ALBUM + " renamed");
+}
+
+void SearchTest::searchInsertedImage()
+{
+    const QStringList expected = QStringList() << IMAGE_NAME;
+    QCOMPARE(searchNames("searchtest_quokka"), expected);
+    // Every column is indexed, and the words are prefixes
+    QCOMPARE(searchNames("wombat"), expected);
+    QCOMPARE(searchNames("zorb"), expected);
+    QCOMPARE(searchNames("glimmer"), expected);
+    QCOMPARE(searchNames("2013-04-05"), expected);
+    QCOMPARE(searchNames("ZORBLAX"), expected);
+    QVERIFY(searchNames("quolla").isEmpty());
+}
+
+void SearchTest::searchMovedImage()
+{
+    DatabaseManager::ImageInfo info = imageInfo();
+    info.path = "/searchtest/numbat/" + IMAGE_NAME;
+    dApp->databaseM->updateImageInfo(info);
+
+    QCOMPARE(searchNames("numbat"), QStringList() << IMAGE_NAME);
+    QVERIFY(searchNames("wombat").isEmpty());
+    // The columns not updated are kept
+    QCOMPARE(searchNames("zorblax"), QStringList() << IMAGE_NAME);
+}
+
+void SearchTest::searchAlbums()
+{
+    QVERIFY(searchNames("kangaroo").isEmpty());
+
+    dApp->databaseM->insertImageIntoAlbum(ALBUM, IMAGE_NAME);
+    QCOMPARE(searchNames("kangaroo"), QStringList() << IMAGE_NAME);
+
+    dApp->databaseM->removeImageFromAlbum(ALBUM, IMAGE_NAME);
+    QVERIFY(searchNames("kangaroo").isEmpty());
+}
+
+void SearchTest::searchRenamedAlbum()
+{
+    dApp->databaseM->insertImageIntoAlbum(ALBUM, IMAGE_NAME);
+    dApp->databaseM->renameAlbum(ALBUM, ALBUM + " renamed");
+
+    QCOMPARE(searchNames("renamed"), QStringList() << IMAGE_NAME);
+    QCOMPARE(searchNames("kangaroo"), QStringList() << IMAGE_NAME);
+
+    dApp->databaseM->removeAlbum(ALBUM + " renamed");
+    QVERIFY(searchNames("kangaroo").isEmpty());
+}
+
+void SearchTest::searchRemovedImage()
+{
+    dApp->databaseM->removeImages(QStringList() << IMAGE_NAME);
+    QVERIFY(searchNames("searchtest_quokka").isEmpty());
+    QVERIFY(searchNames("zorblax").isEmpty());
+}
+
+void SearchTest::searchMultipleWords()
+{
+    // Every word must match, in any column
+    QCOMPARE(searchNames("zorblax glimmer"), QStringList() << IMAGE_NAME);
+    QVERIFY(searchNames("zorblax numbat").isEmpty());
+    // The quotes are escaped, they don't break the query
+    QCOMPARE(searchNames("\"zorblax"), QStringList() << IMAGE_NAME);
+    QCOMPARE(searchNames("\"zorblax\""), QStringList() << IMAGE_NAME);
+    QVERIFY(searchNames("   ").isEmpty());
+}
+
+void SearchTest::searchPages()
+{
+    QList<DatabaseManager::ImageInfo> infos;
+    for (int i = 0; i < PAGE_IMAGES; i ++) {
+        DatabaseManager::ImageInfo info = imageInfo();
+        info.name = QString("searchtest_page_%1.png").arg(i);
+        info.path = "/searchtest/paged/" + info.name;
+        infos << info;
+    }
+    QVERIFY(dApp->databaseM->insertImageInfos(infos));
+
+    // They rank the same, so only the pages as a whole are compared
+    QStringList all = searchNames("paged");
+    QCOMPARE(all.length(), PAGE_IMAGES);
+    QStringList pages = searchNames("paged", 0, 2) + searchNames("paged", 2, 2)
+            + searchNames("paged", 4, 2);
+    all.sort();
+    pages.sort();
+    QCOMPARE(pages, all);
+    QVERIFY(searchNames("paged", PAGE_IMAGES, 2).isEmpty());
+}
@@ -0,0 +1,28 @@
+#ifndef SEARCHTEST_H
+#define SEARCHTEST_H
+
+#include <QObject>
+
+/*!
+ * \brief The SearchTest class
+ * The triggers keep the search index in sync with the images and albums,
+ * none of the writes of DatabaseManager touch the index by itself.
+ */
+class SearchTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void searchInsertedImage();
+    void searchMovedImage();
+    void searchAlbums();
+    void searchRenamedAlbum();
+    void searchRemovedImage();
+    void searchMultipleWords();
+    void searchPages();
+};
+
+#endif // SEARCHTEST_H
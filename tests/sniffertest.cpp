@@ -0,0 +1,129 @@
+#include "sniffertest.h"
+#include "utils/imagesniffer.h"
+#include <QFile>
+#include <QtTest>
+
+using namespace utils::image;
+
+namespace {
+
+const QByteArray JPEG_MAGIC("\xFF\xD8\xFF\xE0\0\x10JFIF\0", 11);
+const QByteArray PNG_MAGIC("\x89PNG\r\n\x1A\n\0\0\0\x0DIHDR", 16);
+
+}  // namespace
+
+void SnifferTest::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+}
+
+QString SnifferTest::writeFile(const QString &name, const QByteArray &data)
+{
+    const QString path = m_dir.path() + "/" + name;
+    QFile file(path);
+    if (! file.open(QIODevice::WriteOnly) || file.write(data) != data.length()) {
+        return QString();
+    }
+    return path;
+}
+
+void SnifferTest::rejectNonImageSuffixes()
+{
+    // The content isn't read
+    const QString video = writeFile("clip.mp4", JPEG_MAGIC);
+    QVERIFY(! video.isEmpty());
+    QCOMPARE(sniffImageFormat(video), FormatUnknown);
+
+    const QString sidecar = writeFile("IMG_0001.XMP", PNG_MAGIC);
+    QVERIFY(! sidecar.isEmpty());
+    QCOMPARE(sniffImageFormat(sidecar), FormatUnknown);
+}
+
+void SnifferTest::trustPhotoSuffixes()
+{
+    // Told without opening the file, so a missing one is told as well
+    const QString dir = m_dir.path() + "/missing/";
+    QCOMPARE(sniffImageFormat(dir + "IMG_0001.jpg"), FormatJPEG);
+    QCOMPARE(sniffImageFormat(dir + "IMG_0001.JPEG"), FormatJPEG);
+    QCOMPARE(sniffImageFormat(dir + "IMG_0001.png"), FormatPNG);
+    QCOMPARE(sniffImageFormat(dir + "IMG_0001.tif"), FormatTIFF);
+    QCOMPARE(sniffImageFormat(dir + "DSC_0001.NEF"), FormatRAW);
+    QCOMPARE(sniffImageFormat(dir + "IMG_0001.CR2"), FormatRAW);
+    QCOMPARE(sniffImageFormat(dir + "DSCF0001.raf"), FormatRAW);
+}
+
+void SnifferTest::sniffSignatures_data()
+{
+    QTest::addColumn<QString>("name");
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<int>("format");
+
+    QTest::newRow("png without suffix") << "png" << PNG_MAGIC
+                                        << int(FormatPNG);
+    QTest::newRow("jpeg of other suffix") << "jpeg.dat" << JPEG_MAGIC
+                                          << int(FormatJPEG);
+    QTest::newRow("gif") << "gif.bin" << QByteArray("GIF89a\x01\0\x01\0", 10)
+                         << int(FormatGIF);
+    QTest::newRow("webp") << "webp.bin"
+                          << QByteArray("RIFF\x24\0\0\0WEBPVP8 ", 16)
+                          << int(FormatWebP);
+    QTest::newRow("tiff") << "tiff.bin" << QByteArray("II*\0\x08\0\0\0", 8)
+                          << int(FormatTIFF);
+    QTest::newRow("canon crw") << "crw"
+                               << QByteArray("II\x1A\0\0\0HEAPCCDR", 14)
+                               << int(FormatRAW);
+    // The weak magics are matched with their suffixes only
+    QTest::newRow("bmp") << "bitmap.bmp" << QByteArray("BM\x36\0\0\0")
+                         << int(FormatBMP);
+    QTest::newRow("bmp magic of other suffix") << "bitmap.dat"
+                                               << QByteArray("BM\x36\0\0\0")
+                                               << int(FormatUnknown);
+    QTest::newRow("ico") << "icon.ico" << QByteArray("\0\0\x01\0\x01\0", 6)
+                         << int(FormatOther);
+    QTest::newRow("svg") << "drawing.svg"
+                         << QByteArray("\xEF\xBB\xBF<?xml version=\"1.0\"?>\n"
+                                       "<!-- <html> -->\n"
+                                       "<!DOCTYPE svg>\n"
+                                       "<svg xmlns=\"http://www.w3.org/2000/svg\"/>")
+                         << int(FormatSVG);
+    QTest::newRow("html of svg suffix") << "page.svg"
+                                        << QByteArray("<html><body/></html>")
+                                        << int(FormatUnknown);
+    // No signature, told by the suffix
+    QTest::newRow("tga") << "targa.tga" << QByteArray("\0\0\x02\0", 4)
+                         << int(FormatOther);
+    QTest::newRow("empty tga") << "empty.tga" << QByteArray()
+                               << int(FormatOther);
+    QTest::newRow("empty") << "empty" << QByteArray() << int(FormatUnknown);
+    QTest::newRow("text") << "readme" << QByteArray("Hello")
+                          << int(FormatUnknown);
+}
+
+void SnifferTest::sniffSignatures()
+{
+    QFETCH(QString, name);
+    QFETCH(QByteArray, data);
+    QFETCH(int, format);
+
+    const QString path = writeFile(name, data);
+    QVERIFY(! path.isEmpty());
+    QCOMPARE(int(sniffImageFormat(path)), format);
+}
+
+void SnifferTest::sniffMissingFile()
+{
+    QCOMPARE(sniffImageFormat(m_dir.path() + "/missing"), FormatUnknown);
+    QCOMPARE(sniffImageFormat(m_dir.path() + "/missing.bmp"), FormatUnknown);
+}
+
+void SnifferTest::sniffChangedFile()
+{
+    const QString path = writeFile("changed", PNG_MAGIC);
+    QVERIFY(! path.isEmpty());
+    QCOMPARE(sniffImageFormat(path), FormatPNG);
+
+    // The cached result is dropped once the size or modified time changes
+    QVERIFY(! writeFile("changed", QByteArray("GIF87a\x01\0\x01\0\0\0", 12))
+            .isEmpty());
+    QCOMPARE(sniffImageFormat(path), FormatGIF);
+}
@@ -0,0 +1,33 @@
+#ifndef SNIFFERTEST_H
+#define SNIFFERTEST_H
+
+#include <QObject>
+#include <QTemporaryDir>
+
+/*!
+ * \brief The SnifferTest class
+ * The suffix fast paths of sniffImageFormat(), which do no I/O, and the
+ * signatures read for the unknown and ambiguous suffixes.
+ */
+class SnifferTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void rejectNonImageSuffixes();
+    void trustPhotoSuffixes();
+    void sniffSignatures_data();
+    void sniffSignatures();
+    void sniffMissingFile();
+    void sniffChangedFile();
+
+private:
+    QString writeFile(const QString &name, const QByteArray &data);
+
+private:
+    QTemporaryDir m_dir;
+};
+
+#endif // SNIFFERTEST_H
@@ -5,10 +5,19 @@
 #include "controller/exporter.h"
 #include "controller/globaleventfilter.h"
 #include "controller/importer.h"
+#include "controller/librarywatcher.h"
+#include "controller/metadataservice.h"
 #include "controller/signalmanager.h"
+#include "controller/thumbnailservice.h"
 #include "controller/wallpapersetter.h"
+#include "controller/workscheduler.h"
+#include "utils/thumbnailcache.h"
+#include "utils/thumbnailpack.h"
 
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QThreadPool>
 #include <QTranslator>
 
 namespace {
@@ -28,18 +37,74 @@ Application::Application(int& argc, char** argv)
 
 
     initChildren();
+    connect(this, &Application::aboutToQuit, this, &Application::shutdown);
 }
 
 void Application::initChildren()
 {
     setter = ConfigSetter::instance();
+    utils::image::ThumbnailCache::instance()->setBudget(
+        setter->value("THUMBNAILCACHE", "BudgetMB", 256).toLongLong()
+                * 1024 * 1024);
     databaseM = DatabaseManager::instance();
+    // Optional, a cell of raw pixels takes 144 KB for every image
+    if (setter->value("THUMBNAILCACHE", "Pack", false).toBool()) {
+        utils::image::ThumbnailPack::instance()->open(
+            QFileInfo(DatabaseManager::databasePath()).absolutePath()
+                    + "/thumbnails.pack");
+    }
+    // Before the workers start
+    scheduler = WorkScheduler::instance();
     exporter = Exporter::instance();
     importer = Importer::instance();
+    watcher = LibraryWatcher::instance();
     signalM = SignalManager::instance();
     wpSetter = WallpaperSetter::instance();
 }
 
+/*!
+ * \brief Application::shutdown
+ * Stop the workers which use the database before deleting it, the database
+ * finishes its queued writes while it's deleted.
+ */
+void Application::shutdown()
+{
+    importer->shutdown();
+    ThumbnailService::instance()->shutdown();
+    MetadataService::instance()->shutdown();
+    // The pages loading of the views and the watches of LibraryWatcher
+    QThreadPool::globalInstance()->waitForDone();
+
+    delete databaseM;
+    databaseM = nullptr;
+
+    const utils::image::ThumbnailCache::Stats stats =
+            utils::image::ThumbnailCache::instance()->stats();
+    qDebug() << "Thumbnail cache hits:" << stats.hits
+             << "misses:" << stats.misses << "evictions:" << stats.evictions
+             << "bytes:" << stats.bytes << "of" << stats.budget;
+}
+
+/*!
+ * \brief Application::notify
+ * Time the painting of windows for WorkScheduler. A window paints its widgets
+ * while it handles the UpdateRequest, the nested Paint events are timed too
+ * but only the longest one counts.
+ */
+bool Application::notify(QObject *obj, QEvent *e)
+{
+    if (! scheduler || (e->type() != QEvent::UpdateRequest
+                        && e->type() != QEvent::Paint)) {
+        return DApplication::notify(obj, e);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    const bool result = DApplication::notify(obj, e);
+    scheduler->recordFrame(timer.elapsed());
+    return result;
+}
+
 void Application::initI18n()
 {
     // install translators
@@ -8,8 +8,10 @@ class ConfigSetter;
 class DatabaseManager;
 class Exporter;
 class Importer;
+class LibraryWatcher;
 class SignalManager;
 class WallpaperSetter;
+class WorkScheduler;
 
 #if defined(dApp)
 #undef dApp
@@ -28,8 +30,16 @@ public:
     DatabaseManager *databaseM = nullptr;
     Exporter *exporter = nullptr;
     Importer *importer = nullptr;
+    LibraryWatcher *watcher = nullptr;
     SignalManager *signalM = nullptr;
     WallpaperSetter *wpSetter = nullptr;
+    WorkScheduler *scheduler = nullptr;
+
+    // Called on aboutToQuit, or by the callers which run no event loop
+    void shutdown();
+
+protected:
+    bool notify(QObject *obj, QEvent *e) Q_DECL_OVERRIDE;
 
 private:
     void initChildren();
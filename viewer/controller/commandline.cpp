@@ -207,7 +207,7 @@ void DeepinImageViewerDBus::enterAlbum(const QString &album)
 void DeepinImageViewerDBus::searchImage(const QString &keyWord)
 {
     qDebug() << "Go to search view and search image by: " << keyWord;
-    // TODO
+    emit dApp->signalM->gotoSearchPanel(keyWord);
 }
 
 void DeepinImageViewerDBus::editImage(const QString &path)
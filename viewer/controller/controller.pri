@@ -1,9 +1,17 @@
 HEADERS += \
     $$PWD/databasemanager.h \
+    $$PWD/databasewriter.h \
     $$PWD/importer.h \
+    $$PWD/importjournal.h \
+    $$PWD/importpipeline.h \
+    $$PWD/librarysnapshot.h \
+    $$PWD/librarywatcher.h \
+    $$PWD/metadataservice.h \
     $$PWD/popupmenumanager.h \
     $$PWD/signalmanager.h \
+    $$PWD/thumbnailservice.h \
     $$PWD/wallpapersetter.h \
+    $$PWD/workscheduler.h \
     $$PWD/commandline.h \
     $$PWD/configsetter.h \
     $$PWD/divdbuscontroller.h \
@@ -12,10 +20,18 @@ HEADERS += \
 
 SOURCES += \
     $$PWD/databasemanager.cpp \
+    $$PWD/databasewriter.cpp \
     $$PWD/importer.cpp \
+    $$PWD/importjournal.cpp \
+    $$PWD/importpipeline.cpp \
+    $$PWD/librarysnapshot.cpp \
+    $$PWD/librarywatcher.cpp \
+    $$PWD/metadataservice.cpp \
     $$PWD/popupmenumanager.cpp \
     $$PWD/signalmanager.cpp \
+    $$PWD/thumbnailservice.cpp \
     $$PWD/wallpapersetter.cpp \
+    $$PWD/workscheduler.cpp \
     $$PWD/commandline.cpp \
     $$PWD/configsetter.cpp \
     $$PWD/divdbuscontroller.cpp \
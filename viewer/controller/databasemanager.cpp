@@ -3,408 +3,808 @@
 #include "signalmanager.h"
 #include "utils/baseutils.h"
 #include "utils/imageutils.h"
-#include <QBuffer>
+#include <QDataStream>
 #include <QDebug>
 #include <QDir>
 #include <QFileInfo>
-#include <QMutex>
-#include <QMutexLocker>
+#include <QHash>
+#include <QRegExp>
+#include "databasewriter.h"
+#include "librarysnapshot.h"
 #include <QSqlDatabase>
 #include <QSqlDriver>
 #include <QSqlError>
 #include <QSqlQuery>
 #include <QSqlRecord>
+#include <QThread>
+#include <QThreadStorage>
 
 const QString DATABASE_PATH = QDir::homePath() + "/.local/share/deepin/deepin-image-viewer/";
 const QString DATABASE_NAME = "deepinimageviewer.db";
+const QString CONNECTION_NAME = "default_connection";
+const int DATABASE_BUSY_TIMEOUT = 5000;  // ms
+const qint64 DATABASE_MMAP_SIZE = 256 * 1024 * 1024;
 const QString IMAGE_TABLE_NAME = "ImageTable";
 const QString ALBUM_TABLE_NAME = "AlbumTable";
+const QString IMAGE_SEARCH_TABLE_NAME = "ImageSearch";
+const QString IMPORT_ROOT_TABLE_NAME = "ImportRootTable";
+const QString METADATA_TABLE_NAME = "MetadataTable";
+// Per connection table of the images changed by a bulk operation
+const QString CHANGED_IMAGES_TABLE_NAME = "ChangedImages";
+// Only the most recently imported matches are ranked, see searchImageInfos()
+const int SEARCH_RANK_LIMIT = 10000;
+// Bump it and add a migrateToVersionN() step when the schema changes
+const int DATABASE_VERSION = 7;
+
+namespace {
+
+QString databaseFile = DATABASE_PATH + DATABASE_NAME;
+
+// Columns read by readImageInfo(), qualified so they can be used in joins
+const QString IMAGE_COLUMNS = QString("%1.id, %1.filename, %1.filepath, "
+                                      "%1.time, %1.width, %1.height, "
+                                      "%1.camera, %1.lens, %1.file_size, "
+                                      "%1.modified, %1.inode, %1.orientation")
+        .arg(IMAGE_TABLE_NAME);
+
+qint64 timeToEpoch(const QDateTime &time)
+{
+    return time.isValid() ? time.toMSecsSinceEpoch() / 1000 : 0;
+}
 
-void DatabaseManager::updateImageInfo(const DatabaseManager::ImageInfo &info)
+// Month bucket as yyyyMM in local time, eg: 201605
+int timeToMonth(const QDateTime &time)
+{
+    return time.date().year() * 100 + time.date().month();
+}
+
+QDateTime epochToTime(qint64 time)
 {
-    QMutexLocker locker(&m_mutex);
+    return QDateTime::fromMSecsSinceEpoch(time * 1000);
+}
 
-    QSqlDatabase db = getDatabase();
-    if (db.isValid() && imageExist(info.name)) {
+// QtSql connections can only be used by the thread which created them,
+// every thread gets its own one and removes it while the thread exits
+class ThreadConnection
+{
+public:
+    explicit ThreadConnection(const QString &name) : m_name(name) {}
+    ~ThreadConnection() {
+        {
+            QSqlDatabase db = QSqlDatabase::database(m_name, false);
+            if (db.isOpen()) {
+                db.close();
+            }
+        }
+        QSqlDatabase::removeDatabase(m_name);
+    }
+    const QString &name() const { return m_name; }
+
+private:
+    QString m_name;
+};
+
+QThreadStorage<ThreadConnection *> threadConnections;
+
+DatabaseManager::ImageInfo readImageInfo(const QSqlQuery &query)
+{
+    DatabaseManager::ImageInfo info;
+    info.id = query.value(0).toLongLong();
+    info.name = query.value(1).toString();
+    info.path = query.value(2).toString();
+    info.time = epochToTime(query.value(3).toLongLong());
+    info.size = QSize(query.value(4).toInt(), query.value(5).toInt());
+    info.camera = query.value(6).toString();
+    info.lens = query.value(7).toString();
+    info.fileSize = query.value(8).toLongLong();
+    info.modified = query.value(9).toLongLong();
+    info.inode = query.value(10).toLongLong();
+    info.orientation = query.value(11).toInt();
+
+    return info;
+}
+
+/*!
+ * \brief loadChangedImages
+ * Load the ids of images into the temp table, so a bulk operation joins it
+ * by a set based statement instead of binding the names one by one.
+ * It should be called in a transaction of the writer thread.
+ */
+bool loadChangedImages(QSqlQuery &query, const QStringList &names)
+{
+    if (! query.exec(QString("CREATE TEMP TABLE IF NOT EXISTS %1 "
+                             "(id INTEGER PRIMARY KEY)")
+                     .arg(CHANGED_IMAGES_TABLE_NAME))
+            || ! query.exec(QString("DELETE FROM %1")
+                            .arg(CHANGED_IMAGES_TABLE_NAME))) {
+        qWarning() << "Create changed images table failed: "
+                   << query.lastError();
+        return false;
+    }
+
+    QVariantList filenames;
+    for (const QString &name : names) {
+        filenames << name;
+    }
+    query.prepare(QString("INSERT OR IGNORE INTO %1(id) "
+                          "SELECT id FROM %2 WHERE filename = ?")
+                  .arg(CHANGED_IMAGES_TABLE_NAME).arg(IMAGE_TABLE_NAME));
+    query.addBindValue(filenames);
+    if (! query.execBatch()) {
+        qWarning() << "Load changed images failed: " << query.lastError();
+        return false;
+    }
+
+    return true;
+}
+
+// Every word is a prefix phrase, eg: summer IMG_20 -> "summer"* "IMG_20"*
+// A word is split into tokens by the tokenizer like the indexed text is
+QString searchMatch(const QString &keywords)
+{
+    QStringList phrases;
+    for (QString word : keywords.split(QRegExp("\\s+"), QString::SkipEmptyParts)) {
+        phrases << "\"" + word.replace("\"", "\"\"") + "\"*";
+    }
+
+    return phrases.join(" ");
+}
+
+}  // namespace
+
+void DatabaseManager::updateImageInfo(const DatabaseManager::ImageInfo &info)
+{
+    const bool succeed = write([=] (QSqlDatabase &db) {
         QSqlQuery query( db );
         query.prepare( QString("UPDATE %1 SET "
                                "filepath = :path, "
-                               "album = :album, "
-                               "label = :label, "
                                "time = :time, "
-                               "thumbnail = :thumbnail "
+                               "month = :month, "
+                               "width = :width, "
+                               "height = :height, "
+                               "orientation = :orientation "
                                "WHERE filename = :name")
                        .arg( IMAGE_TABLE_NAME ) );
         query.bindValue( ":path", info.path );
-        query.bindValue( ":album", info.albums );
-        query.bindValue( ":label", info.labels );
-        query.bindValue( ":time", utils::base::timeToString(info.time) );
-        QByteArray inByteArray;
-        QBuffer inBuffer( &inByteArray );
-        inBuffer.open( QIODevice::WriteOnly );
-        if ( !info.thumbnail.save( &inBuffer, "JPG" )) { // write inPixmap into inByteArray
-            qDebug() << "Write pixmap to buffer error!" << info.name;
-        }
-        query.bindValue( ":thumbnail", inByteArray);
+        query.bindValue( ":time", timeToEpoch(info.time) );
+        query.bindValue( ":month", timeToMonth(info.time) );
+        query.bindValue( ":width", qMax(0, info.size.width()) );
+        query.bindValue( ":height", qMax(0, info.size.height()) );
+        query.bindValue( ":orientation", info.orientation );
         query.bindValue( ":name", info.name );
         if (!query.exec()) {
             qWarning() << "Update image database failed: " << query.lastError();
+            return false;
         }
+        return true;
+    }).result();
+
+    if (succeed) {
+        updateSnapshot([=] (LibrarySnapshot &snapshot) {
+            if (snapshot.contains(info.name)) {
+                snapshot.insertImage(info);
+            }
+        });
     }
 }
 
 QList<DatabaseManager::ImageInfo> DatabaseManager::getImageInfosByAlbum(
         const QString &album)
 {
-    // TODO it should read the DB directly
-    QStringList nameList = getImageNamesByAlbum(album);
-    QList<DatabaseManager::ImageInfo> infoList;
-
-    for (const QString name : nameList) {
-        if (name.isEmpty())
-            continue;
-        infoList << getImageInfoByName(name);
+    QList<ImageInfo> infoList;
+    QSqlDatabase db = getDatabase();
+    if (db.isValid()) {
+        QSqlQuery query( db );
+        query.prepare(QString("SELECT %1 FROM %2 "
+                              "JOIN %3 ON %3.id = %2.image_id "
+                              "WHERE %2.albumname = :album "
+                              "ORDER BY %3.time DESC")
+                      .arg(IMAGE_COLUMNS).arg(ALBUM_TABLE_NAME)
+                      .arg(IMAGE_TABLE_NAME));
+        query.bindValue(":album", album);
+        if (!query.exec()) {
+            qWarning() << "Get images by album failed: " << query.lastError();
+        }
+        else {
+            while (query.next()) {
+                infoList << readImageInfo(query);
+            }
+        }
     }
 
     return infoList;
 }
 
-QList<DatabaseManager::ImageInfo> DatabaseManager::getImageInfosByTimeline(const QString &timeline)
+QList<DatabaseManager::ImageInfo> DatabaseManager::getImageInfosByTimeline(
+        const QString &timeline)
 {
-    QList<ImageInfo> tList;
-    QList<ImageInfo> infos = getAllImageInfos();
-    for (ImageInfo info : infos) {
-        if (utils::base::timeToString(info.time, true) == timeline) {
-            tList << info;
+    QList<ImageInfo> infoList;
+    const QDateTime day(utils::base::stringToDateTime(timeline).date());
+    QSqlDatabase db = getDatabase();
+    if (db.isValid() && day.isValid()) {
+        QSqlQuery query( db );
+        query.prepare(QString("SELECT %1 FROM %2 "
+                              "WHERE time >= :begin AND time < :end "
+                              "ORDER BY time DESC")
+                      .arg(IMAGE_COLUMNS).arg(IMAGE_TABLE_NAME));
+        query.bindValue(":begin", timeToEpoch(day));
+        query.bindValue(":end", timeToEpoch(day.addDays(1)));
+        if (!query.exec()) {
+            qWarning() << "Get images by timeline failed: " << query.lastError();
+        }
+        else {
+            while (query.next()) {
+                infoList << readImageInfo(query);
+            }
         }
     }
 
-    return tList;
+    return infoList;
 }
 
-DatabaseManager::ImageInfo DatabaseManager::getImageInfoByName(const QString &name)
+/*!
+ * \brief DatabaseManager::getImageInfosByPage
+ * Read the images newest first, page by page. The cursor keeps the time and
+ * id of the last row read, so every page is an index range scan no matter
+ * how deep it is.
+ * \param cursor the position to continue, it is moved to the end of the page
+ * \param count max rows of the page
+ * \param album read the images of this album only if it isn't empty
+ * \return
+ */
+QList<DatabaseManager::ImageInfo> DatabaseManager::getImageInfosByPage(
+        ImageCursor &cursor, int count, const QString &album)
 {
-    QList<ImageInfo> list = getImageInfos("filename", name);
-    if (list.count() != 1) {
-        return ImageInfo();
+    QList<ImageInfo> infoList;
+    if (cursor.atEnd) {
+        return infoList;
     }
-    else {
-        return list.first();
+
+    QSqlDatabase db = getDatabase();
+    if (db.isValid()) {
+        QString queryStr = QString("SELECT %1 FROM %2 ").arg(IMAGE_COLUMNS)
+                .arg(IMAGE_TABLE_NAME);
+        if (! album.isEmpty()) {
+            queryStr += QString("JOIN %1 ON %1.image_id = %2.id "
+                                "AND %1.albumname = :album ")
+                    .arg(ALBUM_TABLE_NAME).arg(IMAGE_TABLE_NAME);
+        }
+        if (cursor.id != 0) {
+            queryStr += QString("WHERE %1.time < :time1 "
+                                "OR (%1.time = :time2 AND %1.id < :id) ")
+                    .arg(IMAGE_TABLE_NAME);
+        }
+        queryStr += QString("ORDER BY %1.time DESC, %1.id DESC LIMIT :count")
+                .arg(IMAGE_TABLE_NAME);
+
+        QSqlQuery query( db );
+        query.prepare(queryStr);
+        if (! album.isEmpty()) {
+            query.bindValue(":album", album);
+        }
+        if (cursor.id != 0) {
+            query.bindValue(":time1", cursor.time);
+            query.bindValue(":time2", cursor.time);
+            query.bindValue(":id", cursor.id);
+        }
+        query.bindValue(":count", count);
+        if (!query.exec()) {
+            qWarning() << "Get images by page failed: " << query.lastError();
+            cursor.atEnd = true;
+            return infoList;
+        }
+        while (query.next()) {
+            infoList << readImageInfo(query);
+            cursor.time = query.value(3).toLongLong();
+            cursor.id = infoList.last().id;
+        }
     }
+
+    cursor.atEnd = infoList.length() < count;
+    return infoList;
+}
+
+DatabaseManager::ImageInfo DatabaseManager::getImageInfoByName(const QString &name)
+{
+    return snapshot().imageByName(name);
 }
 
 DatabaseManager::ImageInfo DatabaseManager::getImageInfoByPath(const QString &path)
 {
-    QList<ImageInfo> list = getImageInfos("filepath", path);
-    if (list.count() != 1) {
-        return ImageInfo();
-    }
-    else {
-        return list.first();
+    return snapshot().imageByPath(path);
+}
+
+QList<DatabaseManager::ImageInfo> DatabaseManager::getImageInfosByDirectory(
+        const QString &dir)
+{
+    QList<ImageInfo> infoList;
+    QSqlDatabase db = getDatabase();
+    if (db.isValid()) {
+        // A range of the filepath index, '0' is the one after '/'
+        const QString prefix = QDir::cleanPath(dir);
+        QSqlQuery query( db );
+        query.prepare(QString("SELECT %1 FROM %2 "
+                              "WHERE filepath > :begin AND filepath < :end")
+                      .arg(IMAGE_COLUMNS).arg(IMAGE_TABLE_NAME));
+        query.bindValue(":begin", prefix + "/");
+        query.bindValue(":end", prefix + "0");
+        if (!query.exec()) {
+            qWarning() << "Get images by directory failed: " << query.lastError();
+        }
+        else {
+            while (query.next()) {
+                infoList << readImageInfo(query);
+            }
+        }
     }
+
+    return infoList;
 }
 
-void DatabaseManager::insertImageInfos(const QList<ImageInfo> &infos)
+bool DatabaseManager::insertImageInfos(const QList<ImageInfo> &infos)
 {
     if (infos.length() < 1) {
-        return;
+        return true;
     }
-    QSqlDatabase db = getDatabase();
 
-    if (db.isValid()) {
-//         const QString recentImport("Recent imported");
-         QVariantList filenames, filepaths, albumNames;
-         QVariantList labels, times, thumbnails;
-
-         QVariantList albumInfos, albumImgNames, albumInfoTimes;
-         for (ImageInfo info : infos) {
-             filenames << info.name;
-             filepaths << info.path;
-             albumNames << QVariant(info.albums).toString();
-             labels << QVariant(info.labels).toString();
-             times << utils::base::timeToString(info.time);
-             thumbnails << info.thumbnail;
-
-             QStringList albums = info.albums/* << recentImport*/;
-             albums.removeAll("");
-             for (QString album : albums) {
-                 albumInfos << album;
-                 albumImgNames << info.name;
-                 albumInfoTimes << utils::base::timeToString(info.time);
-             }
-         }
-         // Insert into images table
-         QSqlQuery query( db );
-         query.exec("BEGIN IMMEDIATE TRANSACTION");
-         query.prepare(QString("REPLACE INTO %1"
-                       "(filename, filepath, album, label, time, thumbnail) "
-                       "VALUES (?, ?, ?, ?, ?, ?)").arg(IMAGE_TABLE_NAME));
-         query.addBindValue(filenames);
-         query.addBindValue(filepaths);
-         query.addBindValue(albumNames);
-         query.addBindValue(labels);
-         query.addBindValue(times);
-         query.addBindValue(thumbnails);
-         if (! query.execBatch()) {
-             qWarning() << "Insert images into images table failed: "
-                        << query.lastError();
-             query.exec("COMMIT");
-         }
-         else {
-             query.exec("COMMIT");
-             emit dApp->signalM->imagesInserted(infos);
-         }
-
-         // Clear Recent imported album
-//         query.clear();
-//         query.exec("BEGIN IMMEDIATE TRANSACTION");
-//         query.prepare( QString("DELETE FROM %1 WHERE albumname = :name")
-//                        .arg(ALBUM_TABLE_NAME) );
-//         query.bindValue( ":name", recentImport );
-//         if (! query.exec()) {
-//             qWarning() << "Remove album from database failed: "
-//                        << query.lastError();
-//         }
-
-         // Insert into album table
-         query.clear();
-         query.exec("BEGIN IMMEDIATE TRANSACTION");
-         query.prepare("REPLACE INTO AlbumTable(albumname, filename, time) "
-                       "VALUES (?, ?, ?)");
-         query.addBindValue(albumInfos);
-         query.addBindValue(albumImgNames);
-         query.addBindValue(albumInfoTimes);
-         if (! query.execBatch()) {
-             qWarning() << "Insert images into album table failed: "
-                        << query.lastError();
-             query.exec("COMMIT");
-         }
-         else {
-             query.exec("COMMIT");
-         }
-     }
+    QVariantList filenames, filepaths, times, months, widths, heights;
+    QVariantList cameras, lenses, orientations, fileSizes, modifieds, inodes;
+    QVariantList albumNames, albumImgNames;
+    QStringList names;
+    for (ImageInfo info : infos) {
+        names << info.name;
+        filenames << info.name;
+        filepaths << info.path;
+        times << timeToEpoch(info.time);
+        months << timeToMonth(info.time);
+        widths << qMax(0, info.size.width());
+        heights << qMax(0, info.size.height());
+        cameras << info.camera;
+        lenses << info.lens;
+        orientations << info.orientation;
+        fileSizes << info.fileSize;
+        modifieds << info.modified;
+        inodes << info.inode;
+
+        QStringList albums = info.albums;
+        albums.removeAll("");
+        for (QString album : albums) {
+            albumNames << album;
+            albumImgNames << info.name;
+        }
+    }
+
+    // The job is waited, it is safe to fill the ids by reference
+    QHash<QString, qint64> ids;  // Name to id
+    const bool succeed = write([=, &ids] (QSqlDatabase &db) {
+        QSqlQuery query( db );
+        // Keep the id of existing rows, album records refer to it
+        query.prepare(QString("INSERT OR IGNORE INTO %1"
+                      "(filename, filepath, time, month, width, height, "
+                      "camera, lens, orientation, file_size, modified, inode) "
+                      "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)")
+                      .arg(IMAGE_TABLE_NAME));
+        query.addBindValue(filenames);
+        query.addBindValue(filepaths);
+        query.addBindValue(times);
+        query.addBindValue(months);
+        query.addBindValue(widths);
+        query.addBindValue(heights);
+        query.addBindValue(cameras);
+        query.addBindValue(lenses);
+        query.addBindValue(orientations);
+        query.addBindValue(fileSizes);
+        query.addBindValue(modifieds);
+        query.addBindValue(inodes);
+        bool succeed = query.execBatch();
+        if (succeed) {
+            query.prepare(QString("UPDATE %1 SET filepath = ?, time = ?, "
+                                  "month = ?, width = ?, height = ?, "
+                                  "camera = ?, lens = ?, orientation = ?, "
+                                  "file_size = ?, "
+                                  "modified = ?, inode = ? "
+                                  "WHERE filename = ?")
+                          .arg(IMAGE_TABLE_NAME));
+            query.addBindValue(filepaths);
+            query.addBindValue(times);
+            query.addBindValue(months);
+            query.addBindValue(widths);
+            query.addBindValue(heights);
+            query.addBindValue(cameras);
+            query.addBindValue(lenses);
+            query.addBindValue(orientations);
+            query.addBindValue(fileSizes);
+            query.addBindValue(modifieds);
+            query.addBindValue(inodes);
+            query.addBindValue(filenames);
+            succeed = query.execBatch();
+        }
+        if (! succeed) {
+            qWarning() << "Insert images into images table failed: "
+                       << query.lastError();
+            return false;
+        }
+
+        // Read the ids of the batch by one query
+        ids.clear();
+        if (! loadChangedImages(query, names)) {
+            return false;
+        }
+        if (! query.exec(QString("SELECT filename, i.id FROM %1 AS i "
+                                 "JOIN %2 AS c ON i.id = c.id")
+                         .arg(IMAGE_TABLE_NAME)
+                         .arg(CHANGED_IMAGES_TABLE_NAME))) {
+            qWarning() << "Get ids of images failed: " << query.lastError();
+            return false;
+        }
+        while (query.next()) {
+            ids.insert(query.value(0).toString(), query.value(1).toLongLong());
+        }
+
+        // Insert into album table
+        if (! albumNames.isEmpty()) {
+            query.prepare(QString("INSERT OR IGNORE INTO %1(albumname, image_id) "
+                                  "SELECT ?, id FROM %2 WHERE filename = ?")
+                          .arg(ALBUM_TABLE_NAME).arg(IMAGE_TABLE_NAME));
+            query.addBindValue(albumNames);
+            query.addBindValue(albumImgNames);
+            // The images are rolled back with them, the batch is inserted
+            // again as a whole
+            if (! query.execBatch()) {
+                qWarning() << "Insert images into album table failed: "
+                           << query.lastError();
+                return false;
+            }
+        }
+        return true;
+    }).result();
+
+    if (succeed) {
+        QList<ImageInfo> insertedInfos = infos;
+        for (int i = 0; i < insertedInfos.length(); i ++) {
+            insertedInfos[i].id = ids.value(insertedInfos[i].name);
+        }
+        updateSnapshot([&] (LibrarySnapshot &snapshot) {
+            for (const ImageInfo &info : insertedInfos) {
+                snapshot.insertImage(info);
+                for (const QString &album : info.albums) {
+                    if (! album.isEmpty()) {
+                        snapshot.insertIntoAlbum(album, info.id);
+                    }
+                }
+            }
+        });
+
+        emit dApp->signalM->imagesInserted(insertedInfos);
+    }
+
+    return succeed;
 }
 
 void DatabaseManager::removeImages(const QStringList &names)
 {
-    QSqlDatabase db = getDatabase();
-    if (! db.isValid())
+    if (names.isEmpty()) {
         return;
-    QString nStr;
-    for (QString name : names) {
-        nStr += "\"" + name + "\",";
     }
-    nStr.remove(nStr.length() - 1, 1);
 
-    QSqlQuery query(db);
-    // Remove from albums table
-    // Note: the value may contain the % character DONOT use QString::arg()
-    QString queryStr = "DELETE FROM " + ALBUM_TABLE_NAME +
-            " WHERE filename IN (" + nStr +")";
-    query.prepare(queryStr);
-    if (! query.exec()) {
-        qWarning() << "Remove images from DB failed: " << query.lastError();
-    }
-    else {
-        const QStringList al = getAlbumNameList();
-        for (QString album : al) {
-            emit dApp->signalM->removedFromAlbum(album, names);
+    const bool succeed = write([=] (QSqlDatabase &db) {
+        QSqlQuery query(db);
+        if (! loadChangedImages(query, names)) {
+            return false;
         }
-    }
 
-    // Remove from image table
-    queryStr = "DELETE FROM " + IMAGE_TABLE_NAME + " WHERE filename IN (" + nStr + ")";
-    query.prepare(queryStr);
-    if (! query.exec()) {
-        qWarning() << "Remove images from DB failed: " << query.lastError();
-    }
-    else {
+        // Remove from image table first, so the search index isn't updated
+        // for the album records of removed images
+        const QStringList queryStrs = QStringList()
+                << QString("DELETE FROM %1 WHERE id IN (SELECT id FROM %2)")
+                   .arg(IMAGE_TABLE_NAME).arg(CHANGED_IMAGES_TABLE_NAME)
+                << QString("DELETE FROM %1 WHERE image_id IN "
+                           "(SELECT id FROM %2)")
+                   .arg(ALBUM_TABLE_NAME).arg(CHANGED_IMAGES_TABLE_NAME);
+        for (const QString &queryStr : queryStrs) {
+            if (! query.exec(queryStr)) {
+                qWarning() << "Remove images from DB failed: "
+                           << query.lastError();
+                return false;
+            }
+        }
+        return true;
+    }).result();
+
+    if (succeed) {
+        // Collect the albums before the snapshot drops the records
+        const LibrarySnapshot before = snapshot();
+        QMap<QString, QStringList> albumNames;
+        for (const QString &album : before.albumNames()) {
+            for (const QString &name : names) {
+                if (before.imageInAlbum(name, album)) {
+                    albumNames[album] << name;
+                }
+            }
+        }
+
+        updateSnapshot([=] (LibrarySnapshot &snapshot) {
+            for (const QString &name : names) {
+                snapshot.removeImage(name);
+            }
+        });
+
+        for (auto it = albumNames.cbegin(); it != albumNames.cend(); ++it) {
+            emit dApp->signalM->removedFromAlbum(it.key(), it.value());
+        }
         emit dApp->signalM->imagesRemoved(names);
     }
 }
 
-bool DatabaseManager::imageExist(const QString &name)
+void DatabaseManager::moveDirectory(const QString &from, const QString &to)
 {
-    QSqlDatabase db = getDatabase();
-    if (db.isValid()) {
+    const QString source = QDir::cleanPath(from);
+    const QString target = QDir::cleanPath(to);
+    if (source == target) {
+        return;
+    }
+
+    // The job is waited, it is safe to fill the names by reference
+    QStringList names;
+    const bool succeed = write([=, &names] (QSqlDatabase &db) {
         QSqlQuery query( db );
-        query.exec("BEGIN IMMEDIATE TRANSACTION");
-        query.prepare( QString("SELECT COUNT(*) FROM %1 WHERE filename = :name")
-                       .arg( IMAGE_TABLE_NAME ) );
-        query.bindValue( ":name", name );
-        if (query.exec()) {
-            query.first();
-            if (query.value(0).toInt() > 0) {
-                query.exec("COMMIT");
-                return true;
-            }
+        query.prepare(QString("SELECT filename, filepath FROM %1 "
+                              "WHERE filepath > :begin AND filepath < :end")
+                      .arg(IMAGE_TABLE_NAME));
+        query.bindValue(":begin", source + "/");
+        query.bindValue(":end", source + "0");
+        if (! query.exec()) {
+            qWarning() << "Get images of moved directory failed: "
+                       << query.lastError();
+            return false;
+        }
+        QVariantList filenames, filepaths;
+        while (query.next()) {
+            filenames << query.value(0);
+            filepaths << target + query.value(1).toString().mid(source.length());
+        }
+        if (filenames.isEmpty()) {
+            return true;
+        }
+
+        query.prepare(QString("UPDATE %1 SET filepath = ? WHERE filename = ?")
+                      .arg(IMAGE_TABLE_NAME));
+        query.addBindValue(filepaths);
+        query.addBindValue(filenames);
+        if (! query.execBatch()) {
+            qWarning() << "Move images in DB failed: " << query.lastError();
+            return false;
+        }
+        names.clear();
+        for (const QVariant &name : filenames) {
+            names << name.toString();
+        }
+        return true;
+    }).result();
+
+    if (! succeed || names.isEmpty()) {
+        return;
+    }
+
+    const LibrarySnapshot before = snapshot();
+    QList<ImageInfo> infos;
+    for (const QString &name : names) {
+        ImageInfo info = before.imageByName(name);
+        if (! info.name.isEmpty()) {
+            info.path = target + info.path.mid(source.length());
+            infos << info;
         }
     }
+    updateSnapshot([=] (LibrarySnapshot &snapshot) {
+        for (const ImageInfo &info : infos) {
+            snapshot.insertImage(info);
+        }
+    });
+
+    // The views show them again by the new paths
+    emit dApp->signalM->imagesRemoved(names);
+    emit dApp->signalM->imagesInserted(infos);
+}
 
-    return false;
+bool DatabaseManager::imageExist(const QString &name)
+{
+    return snapshot().contains(name);
 }
 
 int DatabaseManager::imageCount()
+{
+    return snapshot().imageCount();
+}
+
+int DatabaseManager::getImagesCountByMonth(const QString &month)
 {
     QSqlDatabase db = getDatabase();
     if (db.isValid()) {
         QSqlQuery query( db );
-        query.exec("BEGIN IMMEDIATE TRANSACTION");
-        query.prepare( QString("SELECT COUNT(*) FROM %1").arg( IMAGE_TABLE_NAME ) );
+        query.prepare( QString("SELECT COUNT(*) FROM %1 WHERE month = :month")
+                        .arg( IMAGE_TABLE_NAME ) );
+        // Timeline month, eg: 2016.05
+        query.bindValue( ":month", timeToMonth(
+                             QDateTime(QDate::fromString(month, "yyyy.MM"))) );
         if (query.exec()) {
             query.first();
-            int count = query.value(0).toInt();
-            query.exec("COMMIT");
-            return count;
+            return query.value(0).toInt();
         }
     }
 
     return 0;
 }
 
-int DatabaseManager::getImagesCountByMonth(const QString &month)
+/*!
+ * \brief DatabaseManager::getImagesCountByMonths
+ * \return the images count of every month, the key is like 2016.05
+ */
+QMap<QString, int> DatabaseManager::getImagesCountByMonths()
 {
+    QMap<QString, int> counts;
     QSqlDatabase db = getDatabase();
     if (db.isValid()) {
         QSqlQuery query( db );
-        query.prepare( QString("SELECT COUNT(*) FROM %1 WHERE time LIKE \'%2%\'")
-                        .arg( IMAGE_TABLE_NAME ).arg( month ) );
-        if (query.exec()) {
-            query.first();
-            int count = query.value(0).toInt();
-            query.exec("COMMIT");
-            return count;
+        query.prepare( QString("SELECT month, COUNT(*) FROM %1 GROUP BY month")
+                       .arg( IMAGE_TABLE_NAME ) );
+        if (!query.exec()) {
+            qWarning() << "Get images count by month failed: "
+                       << query.lastError();
+        }
+        else {
+            while (query.next()) {
+                const int month = query.value(0).toInt();
+                counts.insert(QString("%1.%2").arg(month / 100)
+                              .arg(month % 100, 2, 10, QChar('0')),
+                              query.value(1).toInt());
+            }
         }
     }
 
-    return 0;
+    return counts;
 }
 
 void DatabaseManager::insertImageIntoAlbum(const QString &albumname,
-                                           const QString &filename,
-                                           const QString &time)
+                                           const QString &filename)
 {
-    //insert into test(albumname, filename, time)
-    //select "album4", "file4", "2016.1.2"
-    //where not exists(
-    //select * from test where albumname="album4" and filename="file4");
-    QSqlDatabase db = getDatabase();
-    if (db.isValid()) {
+    if (! filename.isEmpty()) {
+        insertImagesIntoAlbum(albumname, QStringList(filename));
+        return;
+    }
+
+    // Image id 0 is an empty record which keeps the album exist
+    const bool succeed = write([=] (QSqlDatabase &db) {
         QSqlQuery query( db );
-        query.prepare(QString("INSERT OR IGNORE INTO %1(albumname, filename, time) "
-                      "SELECT :albumname, :filename, :time "
-                      "WHERE NOT EXISTS ( "
-                      "SELECT * FROM AlbumTable "
-                      "WHERE albumname=:albumname AND filename=:filename)")
+        query.prepare(QString("INSERT OR IGNORE INTO %1(albumname, image_id) "
+                              "VALUES (:albumname, 0)")
                       .arg(ALBUM_TABLE_NAME));
         query.bindValue(":albumname", albumname);
-        query.bindValue(":filename", filename);
-        query.bindValue(":time", time);
         if (!query.exec()) {
             qWarning() << "Insert into album failed: " << query.lastError();
+            return false;
         }
+        return true;
+    }).result();
 
-        // For UI update
-        ImageInfo info = getImageInfoByName(filename);
-        info.albums << albumname;
-        emit dApp->signalM->insertIntoAlbum(info);
+    if (succeed) {
+        updateSnapshot([=] (LibrarySnapshot &snapshot) {
+            snapshot.insertIntoAlbum(albumname, 0);
+        });
     }
 }
 
-void DatabaseManager::removeImageFromAlbum(const QString &albumname,
-                                           const QString &filename)
+void DatabaseManager::insertImagesIntoAlbum(const QString &album,
+                                            const QStringList &names)
 {
-    QSqlDatabase db = getDatabase();
-    if (db.isValid()) {
+    if (album.isEmpty() || names.isEmpty()) {
+        return;
+    }
+
+    const bool succeed = write([=] (QSqlDatabase &db) {
         QSqlQuery query( db );
-        query.prepare( QString( "DELETE FROM %1 WHERE albumname = :albumname "
-                                "AND filename = :filename" )
-                       .arg(ALBUM_TABLE_NAME) );
-        query.bindValue( ":albumname", albumname );
-        query.bindValue( ":filename", filename );
+        if (! loadChangedImages(query, names)) {
+            return false;
+        }
+        query.prepare(QString("INSERT OR IGNORE INTO %1(albumname, image_id) "
+                              "SELECT :albumname, id FROM %2")
+                      .arg(ALBUM_TABLE_NAME).arg(CHANGED_IMAGES_TABLE_NAME));
+        query.bindValue(":albumname", album);
         if (!query.exec()) {
-            qWarning() << "Remove image record from album failed: "
-                       << query.lastError();
+            qWarning() << "Insert into album failed: " << query.lastError();
+            return false;
         }
+        return true;
+    }).result();
+
+    if (succeed) {
+        QList<ImageInfo> infos;
+        const LibrarySnapshot images = snapshot();
+        for (const QString &name : names) {
+            ImageInfo info = images.imageByName(name);
+            if (info.id != 0) {
+                info.albums << album;
+                infos << info;
+            }
+        }
+        updateSnapshot([=] (LibrarySnapshot &snapshot) {
+            snapshot.insertIntoAlbum(album, 0);
+            for (const ImageInfo &info : infos) {
+                snapshot.insertIntoAlbum(album, info.id);
+            }
+        });
+
+        // For UI update
+        emit dApp->signalM->insertedIntoAlbum(album, infos);
     }
+}
 
-    // For UI update
-    emit dApp->signalM->removedFromAlbum(albumname, QStringList(filename));
+void DatabaseManager::removeImageFromAlbum(const QString &albumname,
+                                           const QString &filename)
+{
+    removeImagesFromAlbum(albumname, QStringList(filename));
 }
 
 void DatabaseManager::removeImagesFromAlbum(const QString &album,
                                             const QStringList &names)
 {
-    QSqlDatabase db = getDatabase();
-    if (! db.isValid())
+    if (names.isEmpty()) {
         return;
-    QString nStr;
-    for (QString name : names) {
-        //TODO: there will be better way to filter the imagename include
-        //special char " () &etc.
-        if (name.contains("\"") || name.contains("(")
-                || name.contains(")"))
-            removeImageFromAlbum(album, name);
-        else
-            nStr += "\"" + name + "\",";
-    }
-    nStr.remove(nStr.length() - 1, 1);
-
-    QSqlQuery query(db);
-    // Remove from albums table
-    // Note: the value may contain the % character DONOT use QString::arg()
-    const QString queryStr = "DELETE FROM " + ALBUM_TABLE_NAME +
-            " WHERE albumname = \"" + album + "\"AND filename IN (" + nStr + ")";
-    query.prepare(queryStr);
-    if (! query.exec()) {
-        qWarning() << "Remove images from DB failed: " << query.lastError();
-    }
-    else {
-        emit dApp->signalM->removedFromAlbum(album, names);
     }
-}
-
-DatabaseManager::AlbumInfo DatabaseManager::getAlbumInfo(const QString &name)
-{
-    AlbumInfo info;
-    info.name = name;
 
-    QStringList nameList;
-    QSqlDatabase db = getDatabase();
-    if (db.isValid()) {
-        QSqlQuery query( db );
-        query.prepare(QString("SELECT DISTINCT filename FROM %1 "
-            "WHERE albumname =:name AND filename != \"\" ORDER BY time DESC")
-                      .arg(ALBUM_TABLE_NAME));
-        query.bindValue(":name", name);
-        if ( !query.exec() ) {
-            qWarning() << "Get images from AlbumTable failed: "
+    const bool succeed = write([=] (QSqlDatabase &db) {
+        QSqlQuery query(db);
+        if (! loadChangedImages(query, names)) {
+            return false;
+        }
+        query.prepare(QString("DELETE FROM %1 WHERE albumname = :album "
+                              "AND image_id IN (SELECT id FROM %2)")
+                      .arg(ALBUM_TABLE_NAME).arg(CHANGED_IMAGES_TABLE_NAME));
+        query.bindValue(":album", album);
+        if (! query.exec()) {
+            qWarning() << "Remove images from album failed: "
                        << query.lastError();
+            return false;
         }
-        else {
-            while (query.next()) {
-                nameList << query.value(0).toString();
+        return true;
+    }).result();
+
+    if (succeed) {
+        updateSnapshot([=] (LibrarySnapshot &snapshot) {
+            for (const QString &name : names) {
+                snapshot.removeFromAlbum(album, name);
             }
-        }
+        });
+
+        // For UI update
+        emit dApp->signalM->removedFromAlbum(album, names);
     }
+}
 
-    info.count = nameList.length();
-    if (nameList.length() == 1) {
-        info.endTime = getImageInfoByName(nameList.first()).time;
-        info.beginTime = info.endTime;
+DatabaseManager::AlbumInfo DatabaseManager::getAlbumInfo(const QString &name)
+{
+    const QList<AlbumInfo> infos = getAlbumInfos(name);
+    if (infos.isEmpty()) {
+        AlbumInfo info;
+        info.name = name;
+        return info;
     }
-    else if (nameList.length() > 1) {
-        info.endTime = getImageInfoByName(nameList.first()).time;
-        info.beginTime = getImageInfoByName(nameList.last()).time;
+    else {
+        return infos.first();
     }
+}
 
-    return info;
+/*!
+ * \brief DatabaseManager::getAllAlbumInfos
+ * \return the infos of all albums in creation order
+ */
+QList<DatabaseManager::AlbumInfo> DatabaseManager::getAllAlbumInfos()
+{
+    return getAlbumInfos();
 }
 
 void DatabaseManager::removeAlbum(const QString &name)
 {
-    QSqlDatabase db = getDatabase();
-    if (db.isValid()) {
+    const bool succeed = write([=] (QSqlDatabase &db) {
         QSqlQuery query( db );
         query.prepare( QString("DELETE FROM %1 WHERE albumname = :name")
                        .arg(ALBUM_TABLE_NAME) );
@@ -412,14 +812,21 @@ void DatabaseManager::removeAlbum(const QString &name)
         if (!query.exec()) {
             qWarning() << "Remove album from database failed: "
                        << query.lastError();
+            return false;
         }
+        return true;
+    }).result();
+
+    if (succeed) {
+        updateSnapshot([=] (LibrarySnapshot &snapshot) {
+            snapshot.removeAlbum(name);
+        });
     }
 }
 
 void DatabaseManager::renameAlbum(const QString &oldName, const QString &newName)
 {
-    QSqlDatabase db = getDatabase();
-    if (db.isValid()) {
+    const bool succeed = write([=] (QSqlDatabase &db) {
         QSqlQuery query( db );
         query.prepare( QString("UPDATE %1 SET "
                                "albumname = :newName "
@@ -429,7 +836,15 @@ void DatabaseManager::renameAlbum(const QString &oldName, const QString &newName
         query.bindValue( ":oldName", oldName );
         if (!query.exec()) {
             qWarning() << "Update album name failed: " << query.lastError();
+            return false;
         }
+        return true;
+    }).result();
+
+    if (succeed) {
+        updateSnapshot([=] (LibrarySnapshot &snapshot) {
+            snapshot.renameAlbum(oldName, newName);
+        });
     }
 }
 
@@ -438,42 +853,68 @@ void DatabaseManager::clearRecentImported()
     const QString a = "Recent imported";
     removeAlbum(a);
     // Make sure Recent imported always show in UI
-    insertImageIntoAlbum(a, "", "");
+    insertImageIntoAlbum(a, "");
 }
 
 bool DatabaseManager::imageExistAlbum(const QString &name, const QString &album)
 {
+    return snapshot().imageInAlbum(name, album);
+}
+
+QStringList DatabaseManager::getAlbumNameList()
+{
+    return snapshot().albumNames();
+}
+
+QStringList DatabaseManager::getImageNamesByAlbum(const QString &album)
+{
+    QStringList nameList;
     QSqlDatabase db = getDatabase();
     if (db.isValid()) {
         QSqlQuery query( db );
-        query.exec("BEGIN IMMEDIATE TRANSACTION");
-        query.prepare( QString("SELECT COUNT(*) FROM %1 WHERE filename = :name "
-                               "AND albumname = :album")
-                       .arg( ALBUM_TABLE_NAME ) );
-        query.bindValue( ":name", name );
-        query.bindValue( ":album", album );
-        if (query.exec()) {
-            query.first();
-            if (query.value(0).toInt() == 1) {
-                query.exec("COMMIT");
-                return true;
+        query.prepare(QString("SELECT %2.filename FROM %1 "
+                              "JOIN %2 ON %2.id = %1.image_id "
+                              "WHERE %1.albumname = :album ORDER BY %2.time DESC")
+                      .arg(ALBUM_TABLE_NAME).arg(IMAGE_TABLE_NAME));
+        query.bindValue(":album", album);
+        if ( !query.exec() ) {
+            qWarning() << "Get images from AlbumTable failed: "
+                       << query.lastError();
+        }
+        else {
+            while (query.next()) {
+                nameList << query.value(0).toString();
             }
         }
     }
 
-    return false;
+    return nameList;
 }
 
-QStringList DatabaseManager::getAlbumNameList()
+int DatabaseManager::albumsCount()
+{
+    return snapshot().albumNames().length();
+}
+
+int DatabaseManager::getImagesCountByAlbum(const QString &album)
+{
+    return snapshot().albumImageCount(album);
+}
+
+QStringList DatabaseManager::getTimeLineList(bool ascending)
 {
     QStringList list;
     QSqlDatabase db = getDatabase();
     if (db.isValid()) {
         QSqlQuery query( db );
-        query.prepare( QString("SELECT DISTINCT albumname FROM %1")
-                       .arg(ALBUM_TABLE_NAME) );
+        // Same format as utils::base::timeToString(time, true)
+        query.prepare(QString("SELECT strftime('%Y.%m.%d', time, 'unixepoch', "
+                              "'localtime') AS day FROM %1 "
+                              "GROUP BY day ORDER BY day %2")
+                      .arg(IMAGE_TABLE_NAME)
+                      .arg(ascending ? "ASC" : "DESC"));
         if ( !query.exec() ) {
-            qWarning() << "Get AlbumNames failed: " << query.lastError();
+            qWarning() << "Get TimeLine failed: " << query.lastError();
         }
         else {
             while (query.next()) {
@@ -485,108 +926,232 @@ QStringList DatabaseManager::getAlbumNameList()
     return list;
 }
 
-QStringList DatabaseManager::getImageNamesByAlbum(const QString &album)
+QMap<QString, QString> DatabaseManager::getImportRoots()
 {
-    QStringList nameList;
+    QMap<QString, QString> roots;
     QSqlDatabase db = getDatabase();
     if (db.isValid()) {
         QSqlQuery query( db );
-        QString queryStr = "SELECT DISTINCT filename FROM " + ALBUM_TABLE_NAME
-            + " WHERE albumname = \"" + album +"\" ORDER BY time DESC";
-        query.prepare(queryStr);
-        if ( !query.exec() ) {
-            qWarning() << "Get images from AlbumTable failed: "
-                       << query.lastError();
+        if ( !query.exec(QString("SELECT root, album FROM %1")
+                         .arg(IMPORT_ROOT_TABLE_NAME)) ) {
+            qWarning() << "Get import roots failed: " << query.lastError();
         }
         else {
             while (query.next()) {
-                nameList << query.value(0).toString();
+                roots.insert(query.value(0).toString(),
+                             query.value(1).toString());
             }
         }
     }
 
-    return nameList;
+    return roots;
 }
 
-int DatabaseManager::albumsCount()
+void DatabaseManager::insertImportRoot(const QString &root, const QString &album)
 {
-    QSqlDatabase db = getDatabase();
-    if (db.isValid()) {
+    write([=] (QSqlDatabase &db) {
         QSqlQuery query( db );
-        query.exec("BEGIN IMMEDIATE TRANSACTION");
-        query.prepare( QString("SELECT COUNT(DISTINCT albumname) FROM %1")
-                       .arg( ALBUM_TABLE_NAME ) );
-        if (query.exec()) {
-            query.first();
-            int count = query.value(0).toInt();
-            query.exec("COMMIT");
-            return count;
+        query.prepare( QString("INSERT OR REPLACE INTO %1(root, album) "
+                               "VALUES (:root, :album)")
+                       .arg( IMPORT_ROOT_TABLE_NAME ) );
+        query.bindValue( ":root", QDir::cleanPath(root) );
+        query.bindValue( ":album", album );
+        if (!query.exec()) {
+            qWarning() << "Insert import root failed: " << query.lastError();
+            return false;
         }
-    }
-
-    return 0;
+        return true;
+    }).waitForFinished();
 }
 
-int DatabaseManager::getImagesCountByAlbum(const QString &album)
+bool DatabaseManager::getMetadata(const QString &path, qint64 fileSize,
+                                  qint64 modified,
+                                  QMap<QString, QString> &metadata)
 {
     QSqlDatabase db = getDatabase();
-    if (db.isValid()) {
-        QSqlQuery query( db );
-        query.prepare(QString("SELECT COUNT(*) FROM %1 "
-                      "WHERE albumname =:albumname AND filename !=\"\"")
-                      .arg(ALBUM_TABLE_NAME));
-        query.bindValue(":albumname", album);
-        if (query.exec()) {
-            query.first();
-            int count = query.value(0).toInt();
-            query.exec("COMMIT");
-            return count;
-        }
-        else {
-            qDebug() << "Get images count error :" << query.lastError();
-        }
+    if (! db.isValid()) {
+        return false;
     }
 
-    return 0;
+    QSqlQuery query( db );
+    query.prepare( QString("SELECT metadata FROM %1 WHERE filepath = :path "
+                           "AND file_size = :size AND modified = :modified")
+                   .arg( METADATA_TABLE_NAME ) );
+    query.bindValue( ":path", path );
+    query.bindValue( ":size", fileSize );
+    query.bindValue( ":modified", modified );
+    if (! query.exec()) {
+        qWarning() << "Get metadata failed: " << query.lastError();
+        return false;
+    }
+    if (! query.first()) {
+        return false;
+    }
+
+    QDataStream stream(query.value(0).toByteArray());
+    stream >> metadata;
+    return stream.status() == QDataStream::Ok;
 }
 
-QStringList DatabaseManager::getTimeLineList(bool ascending)
+void DatabaseManager::insertMetadata(const QString &path, qint64 fileSize,
+                                     qint64 modified,
+                                     const QMap<QString, QString> &metadata)
 {
-    QStringList list;
-    QSqlDatabase db = getDatabase();
-    if (db.isValid()) {
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << metadata;
+
+    // Not waited, it's only a cache
+    write([=] (QSqlDatabase &db) {
         QSqlQuery query( db );
-        query.prepare(QString("SELECT DISTINCT time FROM %1 ORDER BY time %2").
-                      arg(IMAGE_TABLE_NAME).
-                      arg(ascending ? "ASC" : "DESC"));
-        if ( !query.exec() ) {
-            qWarning() << "Get TimeLine failed: " << query.lastError();
+        query.prepare( QString("INSERT OR REPLACE INTO %1"
+                               "(filepath, file_size, modified, metadata) "
+                               "VALUES (:path, :size, :modified, :metadata)")
+                       .arg( METADATA_TABLE_NAME ) );
+        query.bindValue( ":path", path );
+        query.bindValue( ":size", fileSize );
+        query.bindValue( ":modified", modified );
+        query.bindValue( ":metadata", data );
+        if (!query.exec()) {
+            qWarning() << "Insert metadata failed: " << query.lastError();
+            return false;
         }
-        else {
-            for ( int i = 0; query.next(); i ++ ) {
-                using namespace utils::base;
-                const QString tl = timeToString(
-                            stringToDateTime(query.value(0).toString()), true);
-                if (list.indexOf(tl) == -1)
-                    list << tl;
-            }
+        return true;
+    });
+}
+
+/*!
+ * \brief DatabaseManager::searchImageInfos
+ * Every word of keywords is a prefix query on the file name, directory,
+ * albums, camera, lens and date(yyyy-MM-dd) of images.
+ * Ranking costs about the same for every match, so a word matching most of
+ * a large library would take hundreds of ms. The candidates are capped to
+ * the SEARCH_RANK_LIMIT most recently imported matches, which are ranked by
+ * relevance as a whole, the older matches of such a broad query are left
+ * out. The page is taken from the ranked rowids of the index before they
+ * are joined with the image table.
+ * \param keywords
+ * \param offset the number of matches to skip
+ * \param count
+ * \return
+ */
+QList<DatabaseManager::ImageInfo> DatabaseManager::searchImageInfos(
+        const QString &keywords, int offset, int count)
+{
+    QList<ImageInfo> infoList;
+    const QString match = searchMatch(keywords);
+    if (match.isEmpty() || count <= 0) {
+        return infoList;
+    }
+
+    QSqlDatabase db = getDatabase();
+    if (! db.isValid()) {
+        return infoList;
+    }
+
+    QSqlQuery query( db );
+    query.prepare( QString("SELECT %1 FROM "
+                           "(SELECT rowid, rank FROM "
+                           "(SELECT rowid, rank FROM %2 WHERE %2 MATCH :match "
+                           "ORDER BY rowid DESC LIMIT :candidates) "
+                           "ORDER BY rank LIMIT :limit OFFSET :offset) AS m "
+                           "JOIN %3 ON %3.id = m.rowid ORDER BY m.rank")
+                   .arg( IMAGE_COLUMNS ).arg( IMAGE_SEARCH_TABLE_NAME )
+                   .arg( IMAGE_TABLE_NAME ) );
+    query.bindValue( ":match", match );
+    query.bindValue( ":candidates", SEARCH_RANK_LIMIT );
+    query.bindValue( ":limit", count );
+    query.bindValue( ":offset", qMax(0, offset) );
+    if (! query.exec()) {
+        qWarning() << "Search images failed: " << query.lastError();
+    }
+    else {
+        while (query.next()) {
+            infoList << readImageInfo(query);
         }
     }
 
-    return list;
+    return infoList;
+}
+
+QFuture<int> DatabaseManager::imageCountAsync()
+{
+    return read<int>([=] { return imageCount(); });
+}
+
+QFuture<int> DatabaseManager::albumsCountAsync()
+{
+    return read<int>([=] { return albumsCount(); });
+}
+
+QFuture<int> DatabaseManager::getImagesCountByAlbumAsync(const QString &album)
+{
+    return read<int>([=] { return getImagesCountByAlbum(album); });
+}
+
+QFuture<QStringList> DatabaseManager::getAlbumNameListAsync()
+{
+    return read<QStringList>([=] { return getAlbumNameList(); });
+}
+
+QFuture<QList<DatabaseManager::ImageInfo>>
+DatabaseManager::getAllImageInfosAsync()
+{
+    return read<QList<ImageInfo>>([=] { return getAllImageInfos(); });
+}
+
+QFuture<QList<DatabaseManager::ImageInfo>>
+DatabaseManager::getImageInfosByAlbumAsync(const QString &album)
+{
+    return read<QList<ImageInfo>>([=] {
+        return getImageInfosByAlbum(album);
+    });
+}
+
+QFuture<QList<DatabaseManager::AlbumInfo>>
+DatabaseManager::getAllAlbumInfosAsync()
+{
+    return read<QList<AlbumInfo>>([=] { return getAllAlbumInfos(); });
+}
+
+QFuture<QList<DatabaseManager::ImageInfo>>
+DatabaseManager::searchImageInfosAsync(const QString &keywords,
+                                       int offset, int count)
+{
+    return read<QList<ImageInfo>>([=] {
+        return searchImageInfos(keywords, offset, count);
+    });
 }
 
 DatabaseManager::DatabaseManager(QObject *parent)
-    : QObject(parent),m_connectionName("default_connection")
+    : QObject(parent),
+      m_writer(new DatabaseWriter),
+      m_snapshot(nullptr)
 {
     checkDatabase();
+    m_writer->start();
 
-    // Destruct current instance before process exits.
-    // Or else DatabaseManager::~DatabaseManager() will never be called.
-    connect(qApp, &QApplication::aboutToQuit,
-            [&]() {
-        delete this;
-    });
+    // Keep the reader threads, and so their connections, alive
+    m_readerPool.setMaxThreadCount(2);
+    m_readerPool.setExpiryTimeout(-1);
+}
+
+/*!
+ * \brief DatabaseManager::setDatabasePath
+ * Use another database file instead of the one in the user's data
+ * directory, eg: a synthetic library of the benchmark.
+ * It must be called before the first call of instance().
+ * \param path
+ */
+void DatabaseManager::setDatabasePath(const QString &path)
+{
+    Q_ASSERT(! m_databaseManager);
+    databaseFile = path;
+}
+
+QString DatabaseManager::databasePath()
+{
+    return databaseFile;
 }
 
 DatabaseManager *DatabaseManager::m_databaseManager = NULL;
@@ -601,10 +1166,14 @@ DatabaseManager *DatabaseManager::instance()
 
 DatabaseManager::~DatabaseManager()
 {
-    QSqlDatabase db = getDatabase();
-    if (db.isOpen()) {
-        db.close();
-    }
+    // Finish the running reads and the queued writes
+    m_readerPool.waitForDone();
+    m_writer->stop();
+    delete m_writer;
+
+    delete m_snapshot;
+    threadConnections.setLocalData(nullptr);
+    m_databaseManager = NULL;
 }
 
 const QStringList DatabaseManager::getAllImagesName()
@@ -661,25 +1230,15 @@ const QList<DatabaseManager::ImageInfo> DatabaseManager::getAllImageInfos()
     QSqlDatabase db = getDatabase();
     if (db.isValid()) {
         QSqlQuery query( db );
-        query.prepare( QString("SELECT "
-                               "filename, filepath, album, label, time, thumbnail "
-                               "FROM %1 ORDER BY time DESC")
-                       .arg( IMAGE_TABLE_NAME ));
+        query.prepare( QString("SELECT %1 FROM %2 ORDER BY time DESC")
+                       .arg( IMAGE_COLUMNS ).arg( IMAGE_TABLE_NAME ));
         if (!query.exec()) {
             qWarning() << "Get Image from database failed: " << query.lastError();
             return infoList;
         }
         else {
             while (query.next()) {
-                ImageInfo info;
-                info.name = query.value(0).toString();
-                info.path = query.value(1).toString();
-                info.albums = query.value(2).toStringList();
-                info.labels = query.value(3).toStringList();
-                info.time = utils::base::stringToDateTime(query.value(4).toString());
-                info.thumbnail.loadFromData(query.value(5).toByteArray());
-
-                infoList << info;
+                infoList << readImageInfo(query);
             }
         }
     }
@@ -687,39 +1246,46 @@ const QList<DatabaseManager::ImageInfo> DatabaseManager::getAllImageInfos()
     return infoList;
 }
 
-QList<DatabaseManager::ImageInfo> DatabaseManager::getImageInfos(const QString &key, const QString &value)
+/*!
+ * \brief DatabaseManager::getAlbumInfos
+ * Read the count, time range and cover of albums by one query.
+ * \param name the album name, return all albums if it is empty
+ * \return
+ */
+QList<DatabaseManager::AlbumInfo> DatabaseManager::getAlbumInfos(
+        const QString &name)
 {
-    QMutexLocker locker(&m_mutex);
-
-    QList<ImageInfo> infoList;
+    QList<AlbumInfo> infoList;
     QSqlDatabase db = getDatabase();
     if (db.isValid()) {
         QSqlQuery query( db );
-        // Note: the value may contain the % character DONOT use QString::arg()
-        // const QString queryStr = QString() + "SELECT " +
-        //     " filename, filepath, album, label, time, thumbnail " +
-        //     " FROM " + IMAGE_TABLE_NAME +
-        //     " WHERE " + key + " = \"" + value + "\" ORDER BY time DESC";
-
-        query.prepare(QString("SELECT "
-                      "filename, filepath, album, label, time, thumbnail "
-                      "FROM %1 WHERE %2= :value "
-                      "ORDER BY time DESC").arg(IMAGE_TABLE_NAME).arg(key));
-
-        query.bindValue(":value", value);
+        const QString queryStr = "SELECT a.albumname, COUNT(i.id), "
+                "MIN(i.time), MAX(i.time), "
+                "(SELECT ci.filepath FROM " + ALBUM_TABLE_NAME + " ca JOIN " +
+                IMAGE_TABLE_NAME + " ci ON ci.id = ca.image_id "
+                "WHERE ca.albumname = a.albumname "
+                "ORDER BY ci.time DESC LIMIT 1) "
+                "FROM " + ALBUM_TABLE_NAME + " a LEFT JOIN " + IMAGE_TABLE_NAME +
+                " i ON i.id = a.image_id " +
+                (name.isEmpty() ? "" : "WHERE a.albumname = :name ") +
+                "GROUP BY a.albumname ORDER BY MIN(a.albumid)";
+        query.prepare(queryStr);
+        if (! name.isEmpty()) {
+            query.bindValue(":name", name);
+        }
         if (!query.exec()) {
-            qWarning() << "Get Image from database failed: " << query.lastError();
-            return infoList;
+            qWarning() << "Get album infos failed: " << query.lastError();
         }
         else {
             while (query.next()) {
-                ImageInfo info;
+                AlbumInfo info;
                 info.name = query.value(0).toString();
-                info.path = query.value(1).toString();
-                info.albums = query.value(2).toStringList();
-                info.labels = query.value(3).toStringList();
-                info.time = utils::base::stringToDateTime(query.value(4).toString());
-                info.thumbnail.loadFromData(query.value(5).toByteArray());
+                info.count = query.value(1).toInt();
+                if (info.count > 0) {
+                    info.beginTime = epochToTime(query.value(2).toLongLong());
+                    info.endTime = epochToTime(query.value(3).toLongLong());
+                    info.cover = query.value(4).toString();
+                }
 
                 infoList << info;
             }
@@ -729,34 +1295,130 @@ QList<DatabaseManager::ImageInfo> DatabaseManager::getImageInfos(const QString &
     return infoList;
 }
 
-QSqlDatabase DatabaseManager::getDatabase()
+/*!
+ * \brief DatabaseManager::write
+ * All writes are serialized by the writer thread, so readers on the other
+ * connections never wait for a long import transaction.
+ * \param job
+ * \return
+ */
+QFuture<bool> DatabaseManager::write(
+        const std::function<bool(QSqlDatabase &)> &job)
+{
+    return m_writer->enqueue(job);
+}
+
+/*!
+ * \brief DatabaseManager::snapshot
+ * The copy is cheap and never changes, the lookups on it don't touch the
+ * database.
+ * \return the in-memory copy of the library, it is loaded at the first call
+ */
+LibrarySnapshot DatabaseManager::snapshot()
 {
-    if( QSqlDatabase::contains(m_connectionName) )
     {
-        QSqlDatabase db = QSqlDatabase::database(m_connectionName);
-        return db;
-    }
-    else {
-        //if database not open, open it.
-        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", m_connectionName);//not dbConnection
-        db.setDatabaseName(DATABASE_PATH + DATABASE_NAME);
-        if (!db.open()) {
-            qWarning()<< "Open database error:" << db.lastError();
-            return QSqlDatabase();
-        }
-        else {
-            //            qDebug() << "Database Opended!";
-            return db;
+        QReadLocker locker(&m_snapshotLock);
+        if (m_snapshot) {
+            return *m_snapshot;
         }
     }
+
+    QWriteLocker locker(&m_snapshotLock);
+    if (! m_snapshot) {
+        m_snapshot = new LibrarySnapshot(loadSnapshot());
+    }
+    return *m_snapshot;
+}
+
+/*!
+ * \brief DatabaseManager::updateSnapshot
+ * Apply the committed change to the snapshot. Nothing to do if it hasn't
+ * been loaded, the change will be read from the database.
+ * Note: the update must be idempotent, the snapshot may be loaded after the
+ * change committed.
+ * \param update
+ */
+void DatabaseManager::updateSnapshot(
+        const std::function<void(LibrarySnapshot &)> &update)
+{
+    QWriteLocker locker(&m_snapshotLock);
+    if (m_snapshot) {
+        update(*m_snapshot);
+    }
+}
+
+LibrarySnapshot DatabaseManager::loadSnapshot()
+{
+    LibrarySnapshot snapshot;
+    QSqlDatabase db = getDatabase();
+    if (! db.isValid()) {
+        return snapshot;
+    }
+
+    QSqlQuery query( db );
+    query.setForwardOnly(true);
+    if (! query.exec(QString("SELECT id, filename, filepath, time, width, height, "
+                             "orientation FROM %1").arg(IMAGE_TABLE_NAME))) {
+        qWarning() << "Load images failed: " << query.lastError();
+    }
+    while (query.next()) {
+        ImageInfo info;
+        info.id = query.value(0).toLongLong();
+        info.name = query.value(1).toString();
+        info.path = query.value(2).toString();
+        info.time = epochToTime(query.value(3).toLongLong());
+        info.size = QSize(query.value(4).toInt(), query.value(5).toInt());
+        info.orientation = query.value(6).toInt();
+        snapshot.insertImage(info);
+    }
+
+    // Albums are created in the order of their first record
+    if (! query.exec(QString("SELECT albumname, image_id FROM %1 "
+                             "ORDER BY albumid").arg(ALBUM_TABLE_NAME))) {
+        qWarning() << "Load albums failed: " << query.lastError();
+    }
+    while (query.next()) {
+        snapshot.insertIntoAlbum(query.value(0).toString(),
+                                 query.value(1).toLongLong());
+    }
+
+    return snapshot;
+}
+
+QSqlDatabase DatabaseManager::getDatabase()
+{
+    if (threadConnections.hasLocalData()) {
+        return QSqlDatabase::database(threadConnections.localData()->name());
+    }
+
+    //if database not open, open it.
+    const QString name = QString("%1_%2").arg(CONNECTION_NAME)
+            .arg(quintptr(QThread::currentThreadId()));
+    threadConnections.setLocalData(new ThreadConnection(name));
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", name);//not dbConnection
+    db.setDatabaseName(databaseFile);
+    db.setConnectOptions(QString("QSQLITE_BUSY_TIMEOUT=%1")
+                         .arg(DATABASE_BUSY_TIMEOUT));
+    if (!db.open()) {
+        qWarning()<< "Open database error:" << db.lastError();
+        return QSqlDatabase();
+    }
+
+    // WAL lets readers go on while the writer thread is committing
+    QSqlQuery query(db);
+    query.exec("PRAGMA journal_mode = WAL");
+    query.exec("PRAGMA synchronous = NORMAL");
+    query.exec(QString("PRAGMA mmap_size = %1").arg(DATABASE_MMAP_SIZE));
+
+    return db;
 }
 
 void DatabaseManager::checkDatabase()
 {
     //if database not exist, create it.
-    QDir dp(DATABASE_PATH);
+    QDir dp(QFileInfo(databaseFile).absolutePath());
     if ( !dp.exists() ) {
-        dp.mkpath(DATABASE_PATH);
+        dp.mkpath(dp.absolutePath());
     }
 
     QSqlDatabase db = getDatabase();
@@ -765,29 +1427,423 @@ void DatabaseManager::checkDatabase()
     }
 
     QSqlQuery query(db);
-    //////////////////////////////////////////////////////////////////////////
-    //filename              | filepath | album | label | time | thumbnail   //
-    //TEXT primari key      | TEXT     | TEXT  | TEXT  | TEXT | BLOB        //
-    //////////////////////////////////////////////////////////////////////////
-
-    //image_file
-    query.exec( QString("CREATE TABLE IF NOT EXISTS %1 ( "
-                        "filename TEXT primary key, "
-                        "filepath TEXT, "
-                        "album TEXT, "      //array
-                        "label TEXT,"       //array
-                        "time TEXT, "
-                        "thumbnail BLOB )").arg(IMAGE_TABLE_NAME) );
-
-    //////////////////////////////////////////////////////////////////////////
-    //albumid             | albumname         | filename      | time        //
-    //INTEGER primari key | TEXT              | TEXT          | TEXT        //
-    //////////////////////////////////////////////////////////////////////////
-
-    //album
-    query.exec( QString("CREATE TABLE IF NOT EXISTS %1 ( "
-                        "albumid INTEGER primary key, "
-                        "albumname TEXT, "
-                        "filename TEXT, "
-                        "time TEXT )").arg(ALBUM_TABLE_NAME) );
+    int version = 0;
+    if (query.exec("PRAGMA user_version") && query.first()) {
+        version = query.value(0).toInt();
+    }
+    if (version >= DATABASE_VERSION) {
+        return;
+    }
+
+    // Every step updates the user_version in its own transaction
+    if (version < 1 && ! migrateToVersion1(db)) {
+        qWarning() << "Upgrade database to version 1 failed!";
+        return;
+    }
+    if (version < 2 && ! migrateToVersion2(db)) {
+        qWarning() << "Upgrade database to version 2 failed!";
+        return;
+    }
+    if (version < 3 && ! migrateToVersion3(db)) {
+        qWarning() << "Upgrade database to version 3 failed!";
+        return;
+    }
+    if (version < 4 && ! migrateToVersion4(db)) {
+        qWarning() << "Upgrade database to version 4 failed!";
+        return;
+    }
+    if (version < 5 && ! migrateToVersion5(db)) {
+        qWarning() << "Upgrade database to version 5 failed!";
+        return;
+    }
+    if (version < 6 && ! migrateToVersion6(db)) {
+        qWarning() << "Upgrade database to version 6 failed!";
+        return;
+    }
+    if (version < 7 && ! migrateToVersion7(db)) {
+        qWarning() << "Upgrade database to version 7 failed!";
+        return;
+    }
+}
+
+/*!
+ * \brief DatabaseManager::migrateToVersion1
+ * Create the indexed schema and move the records of the old string keyed
+ * tables(if any) into it.
+ * \param db
+ * \return
+ */
+bool DatabaseManager::migrateToVersion1(QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    query.exec("BEGIN IMMEDIATE TRANSACTION");
+
+    // The tables of version 0 use the same names, move them away first
+    bool hasLegacy = false;
+    query.exec(QString("SELECT name FROM sqlite_master "
+                       "WHERE type = 'table' AND name = '%1'")
+               .arg(IMAGE_TABLE_NAME));
+    if (query.first()) {
+        hasLegacy = true;
+        query.exec(QString("ALTER TABLE %1 RENAME TO %1_v0").arg(IMAGE_TABLE_NAME));
+        query.exec(QString("ALTER TABLE %1 RENAME TO %1_v0").arg(ALBUM_TABLE_NAME));
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    //id                      | filename | filepath | time    | month  | thumbnail
+    //INTEGER primari key     | TEXT     | TEXT     | INTEGER | INTEGER| BLOB
+    //time: seconds since epoch, month: yyyyMM
+    ///////////////////////////////////////////////////////////////////////////
+    const QStringList schema = QStringList()
+            << QString("CREATE TABLE %1 ( "
+                       "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+                       "filename TEXT NOT NULL UNIQUE, "
+                       "filepath TEXT NOT NULL, "
+                       "time INTEGER NOT NULL DEFAULT 0, "
+                       "month INTEGER NOT NULL DEFAULT 0, "
+                       "thumbnail BLOB )").arg(IMAGE_TABLE_NAME)
+            << QString("CREATE INDEX %1_time ON %1(time)").arg(IMAGE_TABLE_NAME)
+            << QString("CREATE INDEX %1_month ON %1(month)").arg(IMAGE_TABLE_NAME)
+            << QString("CREATE INDEX %1_filepath ON %1(filepath)").arg(IMAGE_TABLE_NAME)
+    ///////////////////////////////////////////////////////////////////////////
+    //albumid                 | albumname | image_id
+    //INTEGER primari key     | TEXT      | INTEGER (0 for the empty album)
+    ///////////////////////////////////////////////////////////////////////////
+            << QString("CREATE TABLE %1 ( "
+                       "albumid INTEGER PRIMARY KEY, "
+                       "albumname TEXT NOT NULL, "
+                       "image_id INTEGER NOT NULL DEFAULT 0 )").arg(ALBUM_TABLE_NAME)
+            << QString("CREATE UNIQUE INDEX %1_album_image "
+                       "ON %1(albumname, image_id)").arg(ALBUM_TABLE_NAME)
+            << QString("CREATE INDEX %1_image ON %1(image_id)").arg(ALBUM_TABLE_NAME);
+    for (QString sql : schema) {
+        if (! query.exec(sql)) {
+            qWarning() << "Create table failed: " << query.lastError();
+            query.exec("ROLLBACK");
+            return false;
+        }
+    }
+
+    if (hasLegacy) {
+        // The string time can't be converted by SQL, it is local time
+        // Thumbnails are not copied, the column is dropped by version 3
+        QVariantList filenames, filepaths, times, months;
+        query.exec(QString("SELECT filename, filepath, time FROM %1_v0")
+                   .arg(IMAGE_TABLE_NAME));
+        while (query.next()) {
+            const QDateTime time =
+                    utils::base::stringToDateTime(query.value(2).toString());
+            filenames << query.value(0);
+            filepaths << query.value(1);
+            times << timeToEpoch(time);
+            months << timeToMonth(time);
+        }
+
+        QSqlQuery insertQuery(db);
+        insertQuery.prepare(QString("INSERT OR IGNORE INTO %1"
+                                    "(filename, filepath, time, month) "
+                                    "VALUES (?, ?, ?, ?)").arg(IMAGE_TABLE_NAME));
+        insertQuery.addBindValue(filenames);
+        insertQuery.addBindValue(filepaths);
+        insertQuery.addBindValue(times);
+        insertQuery.addBindValue(months);
+        if (! filenames.isEmpty() && ! insertQuery.execBatch()) {
+            qWarning() << "Migrate images failed: " << insertQuery.lastError();
+            query.exec("ROLLBACK");
+            return false;
+        }
+
+        // Empty filename was used to keep the album exist, map it to id 0
+        if (! query.exec(QString("INSERT OR IGNORE INTO %1(albumname, image_id) "
+                                 "SELECT a.albumname, IFNULL(i.id, 0) "
+                                 "FROM %1_v0 a LEFT JOIN %2 i "
+                                 "ON i.filename = a.filename "
+                                 "WHERE a.albumname IS NOT NULL "
+                                 "AND (a.filename = '' OR i.id IS NOT NULL) "
+                                 "ORDER BY a.albumid")
+                         .arg(ALBUM_TABLE_NAME).arg(IMAGE_TABLE_NAME))) {
+            qWarning() << "Migrate albums failed: " << query.lastError();
+            query.exec("ROLLBACK");
+            return false;
+        }
+
+        query.exec(QString("DROP TABLE %1_v0").arg(IMAGE_TABLE_NAME));
+        query.exec(QString("DROP TABLE %1_v0").arg(ALBUM_TABLE_NAME));
+    }
+
+    query.exec("PRAGMA user_version = 1");
+    return query.exec("COMMIT");
+}
+
+/*!
+ * \brief DatabaseManager::migrateToVersion2
+ * Add the image dimensions, 0 for unknown.
+ * \param db
+ * \return
+ */
+bool DatabaseManager::migrateToVersion2(QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    query.exec("BEGIN IMMEDIATE TRANSACTION");
+    const QStringList schema = QStringList()
+            << QString("ALTER TABLE %1 ADD COLUMN width INTEGER NOT NULL DEFAULT 0")
+               .arg(IMAGE_TABLE_NAME)
+            << QString("ALTER TABLE %1 ADD COLUMN height INTEGER NOT NULL DEFAULT 0")
+               .arg(IMAGE_TABLE_NAME)
+            << "PRAGMA user_version = 2";
+    for (QString sql : schema) {
+        if (! query.exec(sql)) {
+            qWarning() << "Alter table failed: " << query.lastError();
+            query.exec("ROLLBACK");
+            return false;
+        }
+    }
+
+    return query.exec("COMMIT");
+}
+
+/*!
+ * \brief DatabaseManager::migrateToVersion3
+ * Drop the thumbnail column, thumbnails are served by the thumbnail cache.
+ * SQLite can't drop a column, so the table is rebuilt with the same ids.
+ * \param db
+ * \return
+ */
+bool DatabaseManager::migrateToVersion3(QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    query.exec("BEGIN IMMEDIATE TRANSACTION");
+    const QStringList schema = QStringList()
+            << QString("CREATE TABLE %1_v3 ( "
+                       "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+                       "filename TEXT NOT NULL UNIQUE, "
+                       "filepath TEXT NOT NULL, "
+                       "time INTEGER NOT NULL DEFAULT 0, "
+                       "month INTEGER NOT NULL DEFAULT 0, "
+                       "width INTEGER NOT NULL DEFAULT 0, "
+                       "height INTEGER NOT NULL DEFAULT 0 )").arg(IMAGE_TABLE_NAME)
+            << QString("INSERT INTO %1_v3"
+                       "(id, filename, filepath, time, month, width, height) "
+                       "SELECT id, filename, filepath, time, month, width, height "
+                       "FROM %1").arg(IMAGE_TABLE_NAME)
+            // Don't reuse the ids of removed images
+            << QString("UPDATE sqlite_sequence SET seq = "
+                       "(SELECT MAX(seq) FROM sqlite_sequence "
+                       "WHERE name IN ('%1', '%1_v3')) "
+                       "WHERE name = '%1_v3'").arg(IMAGE_TABLE_NAME)
+            << QString("DROP TABLE %1").arg(IMAGE_TABLE_NAME)
+            << QString("ALTER TABLE %1_v3 RENAME TO %1").arg(IMAGE_TABLE_NAME)
+            << QString("CREATE INDEX %1_time ON %1(time)").arg(IMAGE_TABLE_NAME)
+            << QString("CREATE INDEX %1_month ON %1(month)").arg(IMAGE_TABLE_NAME)
+            << QString("CREATE INDEX %1_filepath ON %1(filepath)").arg(IMAGE_TABLE_NAME)
+            << "PRAGMA user_version = 3";
+    for (QString sql : schema) {
+        if (! query.exec(sql)) {
+            qWarning() << "Rebuild table failed: " << query.lastError();
+            query.exec("ROLLBACK");
+            return false;
+        }
+    }
+    if (! query.exec("COMMIT")) {
+        return false;
+    }
+
+    // Give the space of thumbnails back
+    query.exec("VACUUM");
+    return true;
+}
+
+/*!
+ * \brief DatabaseManager::migrateToVersion4
+ * Add the camera and lens of images, and the full-text search index.
+ * The index is kept in sync with the image and album tables by triggers,
+ * so none of the writes need to know about it.
+ * \param db
+ * \return
+ */
+bool DatabaseManager::migrateToVersion4(QSqlDatabase &db)
+{
+    // The directory of path, the trailing '/' is kept
+    const auto dirOf = [] (const QString &path) {
+        return QString("rtrim(%1, replace(%1, '/', ''))").arg(path);
+    };
+    const auto dateOf = [] (const QString &time) {
+        return QString("strftime('%Y-%m-%d', %1, 'unixepoch', 'localtime')")
+                .arg(time);
+    };
+    const auto albumsOf = [] (const QString &id) {
+        return QString("IFNULL((SELECT group_concat(albumname, ' ') FROM %1 "
+                       "WHERE image_id = %2), '')").arg(ALBUM_TABLE_NAME).arg(id);
+    };
+
+    QSqlQuery query(db);
+    query.exec("BEGIN IMMEDIATE TRANSACTION");
+    const QStringList schema = QStringList()
+            << QString("ALTER TABLE %1 ADD COLUMN camera TEXT NOT NULL DEFAULT ''")
+               .arg(IMAGE_TABLE_NAME)
+            << QString("ALTER TABLE %1 ADD COLUMN lens TEXT NOT NULL DEFAULT ''")
+               .arg(IMAGE_TABLE_NAME)
+    ///////////////////////////////////////////////////////////////////////////
+    //rowid(ImageTable.id) | filename | directory | albums | camera | lens | date
+    ///////////////////////////////////////////////////////////////////////////
+            << QString("CREATE VIRTUAL TABLE %1 USING fts5( "
+                       "filename, directory, albums, camera, lens, date, "
+                       "tokenize = 'unicode61 remove_diacritics 2', "
+                       "prefix = '1 2 3' )").arg(IMAGE_SEARCH_TABLE_NAME)
+            // Weights of the columns
+            << QString("INSERT INTO %1(%1, rank) "
+                       "VALUES('rank', 'bm25(10.0, 2.0, 5.0, 3.0, 3.0, 1.0)')")
+               .arg(IMAGE_SEARCH_TABLE_NAME)
+            << QString("INSERT INTO %1"
+                       "(rowid, filename, directory, albums, camera, lens, date) "
+                       "SELECT id, filename, %3, %4, camera, lens, %5 FROM %2")
+               .arg(IMAGE_SEARCH_TABLE_NAME).arg(IMAGE_TABLE_NAME)
+               .arg(dirOf("filepath")).arg(albumsOf(IMAGE_TABLE_NAME + ".id"))
+               .arg(dateOf("time"))
+            << QString("CREATE TRIGGER %2_search_insert AFTER INSERT ON %2 "
+                       "BEGIN INSERT INTO %1"
+                       "(rowid, filename, directory, albums, camera, lens, date) "
+                       "VALUES (new.id, new.filename, %3, '', "
+                       "new.camera, new.lens, %4); END")
+               .arg(IMAGE_SEARCH_TABLE_NAME).arg(IMAGE_TABLE_NAME)
+               .arg(dirOf("new.filepath")).arg(dateOf("new.time"))
+            // Importing an existing image updates it with the same values
+            << QString("CREATE TRIGGER %2_search_update "
+                       "AFTER UPDATE OF filepath, time, camera, lens ON %2 "
+                       "WHEN old.filepath IS NOT new.filepath "
+                       "OR old.time IS NOT new.time "
+                       "OR old.camera IS NOT new.camera "
+                       "OR old.lens IS NOT new.lens "
+                       "BEGIN UPDATE %1 SET directory = %3, camera = new.camera, "
+                       "lens = new.lens, date = %4 WHERE rowid = new.id; END")
+               .arg(IMAGE_SEARCH_TABLE_NAME).arg(IMAGE_TABLE_NAME)
+               .arg(dirOf("new.filepath")).arg(dateOf("new.time"))
+            << QString("CREATE TRIGGER %2_search_delete AFTER DELETE ON %2 "
+                       "BEGIN DELETE FROM %1 WHERE rowid = old.id; END")
+               .arg(IMAGE_SEARCH_TABLE_NAME).arg(IMAGE_TABLE_NAME)
+            << QString("CREATE TRIGGER %2_search_insert AFTER INSERT ON %2 "
+                       "WHEN new.image_id != 0 "
+                       "BEGIN UPDATE %1 SET albums = %3 "
+                       "WHERE rowid = new.image_id; END")
+               .arg(IMAGE_SEARCH_TABLE_NAME).arg(ALBUM_TABLE_NAME)
+               .arg(albumsOf("new.image_id"))
+            << QString("CREATE TRIGGER %2_search_update "
+                       "AFTER UPDATE OF albumname ON %2 "
+                       "WHEN new.image_id != 0 "
+                       "BEGIN UPDATE %1 SET albums = %3 "
+                       "WHERE rowid = new.image_id; END")
+               .arg(IMAGE_SEARCH_TABLE_NAME).arg(ALBUM_TABLE_NAME)
+               .arg(albumsOf("new.image_id"))
+            << QString("CREATE TRIGGER %2_search_delete AFTER DELETE ON %2 "
+                       "WHEN old.image_id != 0 "
+                       "BEGIN UPDATE %1 SET albums = %3 "
+                       "WHERE rowid = old.image_id; END")
+               .arg(IMAGE_SEARCH_TABLE_NAME).arg(ALBUM_TABLE_NAME)
+               .arg(albumsOf("old.image_id"))
+            << "PRAGMA user_version = 4";
+    for (QString sql : schema) {
+        if (! query.exec(sql)) {
+            qWarning() << "Create search index failed: " << query.lastError();
+            query.exec("ROLLBACK");
+            return false;
+        }
+    }
+
+    return query.exec("COMMIT");
+}
+
+/*!
+ * \brief DatabaseManager::migrateToVersion5
+ * Add the state of image files and the imported directories for the rescan,
+ * 0 means the state is unknown and the file is read again.
+ * \param db
+ * \return
+ */
+bool DatabaseManager::migrateToVersion5(QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    query.exec("BEGIN IMMEDIATE TRANSACTION");
+    const QStringList schema = QStringList()
+            << QString("ALTER TABLE %1 ADD COLUMN file_size INTEGER NOT NULL DEFAULT 0")
+               .arg(IMAGE_TABLE_NAME)
+            << QString("ALTER TABLE %1 ADD COLUMN modified INTEGER NOT NULL DEFAULT 0")
+               .arg(IMAGE_TABLE_NAME)
+            << QString("ALTER TABLE %1 ADD COLUMN inode INTEGER NOT NULL DEFAULT 0")
+               .arg(IMAGE_TABLE_NAME)
+    ///////////////////////////////////////////////////////////////////////////
+    //root                    | album
+    //TEXT primari key        | TEXT (album of the images found under root)
+    ///////////////////////////////////////////////////////////////////////////
+            << QString("CREATE TABLE %1 ( "
+                       "root TEXT PRIMARY KEY, "
+                       "album TEXT NOT NULL DEFAULT '' )").arg(IMPORT_ROOT_TABLE_NAME)
+            << "PRAGMA user_version = 5";
+    for (QString sql : schema) {
+        if (! query.exec(sql)) {
+            qWarning() << "Alter table failed: " << query.lastError();
+            query.exec("ROLLBACK");
+            return false;
+        }
+    }
+
+    return query.exec("COMMIT");
+}
+
+/*!
+ * \brief DatabaseManager::migrateToVersion6
+ * Add the EXIF orientation. The file states are reset, so the rescan reads
+ * the existing images again to fill it.
+ * \param db
+ * \return
+ */
+bool DatabaseManager::migrateToVersion6(QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    query.exec("BEGIN IMMEDIATE TRANSACTION");
+    const QStringList schema = QStringList()
+            << QString("ALTER TABLE %1 ADD COLUMN orientation INTEGER NOT NULL DEFAULT 1")
+               .arg(IMAGE_TABLE_NAME)
+            << QString("UPDATE %1 SET file_size = 0").arg(IMAGE_TABLE_NAME)
+            << "PRAGMA user_version = 6";
+    for (QString sql : schema) {
+        if (! query.exec(sql)) {
+            qWarning() << "Alter table failed: " << query.lastError();
+            query.exec("ROLLBACK");
+            return false;
+        }
+    }
+
+    return query.exec("COMMIT");
+}
+
+/*!
+ * \brief DatabaseManager::migrateToVersion7
+ * Add the cache of metadata tags, which are slow to read from the files.
+ * \param db
+ * \return
+ */
+bool DatabaseManager::migrateToVersion7(QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    query.exec("BEGIN IMMEDIATE TRANSACTION");
+    const QStringList schema = QStringList()
+    ///////////////////////////////////////////////////////////////////////////
+    //filepath           | file_size | modified           | metadata
+    //TEXT primari key   | INTEGER   | INTEGER(ns)        | BLOB(QMap stream)
+    ///////////////////////////////////////////////////////////////////////////
+            << QString("CREATE TABLE %1 ( "
+                       "filepath TEXT PRIMARY KEY, "
+                       "file_size INTEGER NOT NULL, "
+                       "modified INTEGER NOT NULL, "
+                       "metadata BLOB NOT NULL )").arg(METADATA_TABLE_NAME)
+            << "PRAGMA user_version = 7";
+    for (QString sql : schema) {
+        if (! query.exec(sql)) {
+            qWarning() << "Alter table failed: " << query.lastError();
+            query.exec("ROLLBACK");
+            return false;
+        }
+    }
+
+    return query.exec("COMMIT");
 }
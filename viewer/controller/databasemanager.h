@@ -4,29 +4,58 @@
 #include <QObject>
 #include <QPixmap>
 #include <QDateTime>
+#include <QMap>
 #include <QSqlDatabase>
-#include <QMutex>
+#include <QFuture>
+#include <QFutureInterface>
+#include <QFutureWatcher>
+#include <QReadWriteLock>
+#include <QRunnable>
+#include <QThreadPool>
+#include <functional>
+
+class DatabaseWriter;
+class LibrarySnapshot;
 
 class DatabaseManager : public QObject
 {
     Q_OBJECT
 public:
     struct ImageInfo {
+        qint64 id = 0;
         QString name;
         QString path;
         QStringList albums; // Discard
         QStringList labels;  // Deprecated
         QDateTime time;
+        QSize size;
+        QString camera;  // EXIF make and model, not kept by the snapshot
+        QString lens;
+        int orientation = 1;  // EXIF orientation, 1 to 8
+        // State of the file when it was read, a rescan skips the unchanged
+        // ones, not kept by the snapshot either
+        qint64 fileSize = 0;
+        qint64 modified = 0;  // Nanoseconds since epoch
+        qint64 inode = 0;
         QPixmap thumbnail; // Deprecated
     };
     struct AlbumInfo {
         QString name;
-        int count;
+        int count = 0;
         QDateTime beginTime;
         QDateTime endTime;
+        QString cover;  // Path of the latest image
+    };
+    // Position of the keyset pagination, default one is before the first row
+    struct ImageCursor {
+        qint64 time = 0;
+        qint64 id = 0;
+        bool atEnd = false;
     };
 
     static DatabaseManager *instance();
+    static void setDatabasePath(const QString &path);
+    static QString databasePath();
     ~DatabaseManager();
 
     const QStringList getAllImagesName();
@@ -34,21 +63,32 @@ public:
     const QList<ImageInfo> getAllImageInfos();
     QList<ImageInfo> getImageInfosByAlbum(const QString &album);
     QList<ImageInfo> getImageInfosByTimeline(const QString &timeline);
+    QList<ImageInfo> getImageInfosByPage(ImageCursor &cursor, int count,
+                                         const QString &album = QString());
     ImageInfo getImageInfoByName(const QString &name);
     ImageInfo getImageInfoByPath(const QString &path);
-    void insertImageInfos(const QList<ImageInfo> &infos);
+    // The images under dir and its sub directories
+    QList<ImageInfo> getImageInfosByDirectory(const QString &dir);
+    // Return false if they aren't written, nothing of them is inserted then
+    bool insertImageInfos(const QList<ImageInfo> &infos);
     void updateImageInfo(const ImageInfo &info);
     void removeImages(const QStringList &names);
+    // The images under from are moved to be under to, they keep their ids
+    // and so their albums
+    void moveDirectory(const QString &from, const QString &to);
     bool imageExist(const QString &name);
     int getImagesCountByMonth(const QString &month);
+    QMap<QString, int> getImagesCountByMonths();
     int imageCount();
 
     AlbumInfo getAlbumInfo(const QString &name);
+    QList<AlbumInfo> getAllAlbumInfos();
     QStringList getAlbumNameList();
     QStringList getImageNamesByAlbum(const QString &album);
+    // Empty filename only creates the album
     void insertImageIntoAlbum(const QString &albumname,
-                              const QString &filename,
-                              const QString &time);
+                              const QString &filename);
+    void insertImagesIntoAlbum(const QString &album, const QStringList &names);
     void removeImageFromAlbum(const QString &albumname, const QString &filename);
     void removeImagesFromAlbum(const QString &album, const QStringList &names);
     void removeAlbum(const QString &name);
@@ -60,17 +100,119 @@ public:
 
     QStringList getTimeLineList(bool ascending = true);
 
+    // Directories imported by the user, they are walked again by a rescan
+    QMap<QString, QString> getImportRoots();  // <root, album>
+    void insertImportRoot(const QString &root, const QString &album);
+
+    // Metadata tags of the file in the state(size, modified in nanoseconds),
+    // return false if it isn't cached
+    bool getMetadata(const QString &path, qint64 fileSize, qint64 modified,
+                     QMap<QString, QString> &metadata);
+    void insertMetadata(const QString &path, qint64 fileSize, qint64 modified,
+                        const QMap<QString, QString> &metadata);
+
+    QList<ImageInfo> searchImageInfos(const QString &keywords,
+                                      int offset, int count);
+
+    LibrarySnapshot snapshot();
+
+    // Asynchronous versions, the queries run on the reader threads
+    QFuture<int> imageCountAsync();
+    QFuture<int> albumsCountAsync();
+    QFuture<int> getImagesCountByAlbumAsync(const QString &album);
+    QFuture<QStringList> getAlbumNameListAsync();
+    QFuture<QList<ImageInfo>> getAllImageInfosAsync();
+    QFuture<QList<ImageInfo>> getImageInfosByAlbumAsync(const QString &album);
+    QFuture<QList<AlbumInfo>> getAllAlbumInfosAsync();
+    QFuture<QList<ImageInfo>> searchImageInfosAsync(const QString &keywords,
+                                                    int offset, int count);
+
+    template <typename T, typename Callback>
+    static void watch(const QFuture<T> &future, QObject *context,
+                      Callback callback);
+
 private:
     explicit DatabaseManager(QObject *parent = 0);
 
-    QList<ImageInfo> getImageInfos(const QString &key, const QString &value);
-    QSqlDatabase getDatabase();
+    QList<AlbumInfo> getAlbumInfos(const QString &name = QString());
+    QFuture<bool> write(const std::function<bool(QSqlDatabase &)> &job);
+    template <typename T>
+    QFuture<T> read(const std::function<T()> &query);
+    void updateSnapshot(const std::function<void(LibrarySnapshot &)> &update);
+    LibrarySnapshot loadSnapshot();
+    static QSqlDatabase getDatabase();
     void checkDatabase();
+    bool migrateToVersion1(QSqlDatabase &db);
+    bool migrateToVersion2(QSqlDatabase &db);
+    bool migrateToVersion3(QSqlDatabase &db);
+    bool migrateToVersion4(QSqlDatabase &db);
+    bool migrateToVersion5(QSqlDatabase &db);
+    bool migrateToVersion6(QSqlDatabase &db);
+    bool migrateToVersion7(QSqlDatabase &db);
 
 private:
+    template <typename T> class DatabaseQuery;
+    friend class DatabaseWriter;
     static DatabaseManager *m_databaseManager;
-    QString m_connectionName;
-    QMutex m_mutex;
+    DatabaseWriter *m_writer;
+    LibrarySnapshot *m_snapshot;  // Loaded at the first use
+    QReadWriteLock m_snapshotLock;
+    QThreadPool m_readerPool;
 };
 
+// A query on the reader pool, it is skipped if canceled before running
+template <typename T>
+class DatabaseManager::DatabaseQuery : public QRunnable
+{
+public:
+    explicit DatabaseQuery(const std::function<T()> &query)
+        : m_query(query)
+    {
+        m_promise.reportStarted();
+    }
+
+    QFuture<T> future() { return m_promise.future(); }
+
+    void run() Q_DECL_OVERRIDE
+    {
+        if (! m_promise.isCanceled()) {
+            m_promise.reportResult(m_query());
+        }
+        m_promise.reportFinished();
+    }
+
+private:
+    std::function<T()> m_query;
+    QFutureInterface<T> m_promise;
+};
+
+template <typename T>
+QFuture<T> DatabaseManager::read(const std::function<T()> &query)
+{
+    DatabaseQuery<T> *task = new DatabaseQuery<T>(query);
+    QFuture<T> future = task->future();
+    m_readerPool.start(task);
+
+    return future;
+}
+
+/*!
+ * \brief DatabaseManager::watch
+ * Call back in the thread of context once the future finished, nothing
+ * happens if the future is canceled or the context is destroyed.
+ */
+template <typename T, typename Callback>
+void DatabaseManager::watch(const QFuture<T> &future, QObject *context,
+                            Callback callback)
+{
+    QFutureWatcher<T> *watcher = new QFutureWatcher<T>(context);
+    QObject::connect(watcher, &QFutureWatcherBase::finished, context, [=] {
+        if (! watcher->isCanceled()) {
+            callback(watcher->result());
+        }
+        watcher->deleteLater();
+    });
+    watcher->setFuture(future);
+}
+
 #endif // DATABASEMANAGER_H
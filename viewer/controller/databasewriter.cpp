@@ -0,0 +1,116 @@
+#include "databasewriter.h"
+#include "databasemanager.h"
+#include <QDebug>
+#include <QMutexLocker>
+#include <QSqlError>
+#include <QSqlQuery>
+
+DatabaseWriter::DatabaseWriter(QObject *parent)
+    : QThread(parent),
+      m_stopped(false)
+{
+}
+
+DatabaseWriter::~DatabaseWriter()
+{
+    stop();
+}
+
+QFuture<bool> DatabaseWriter::enqueue(const Job &job)
+{
+    Task task;
+    task.job = job;
+    task.promise.reportStarted();
+    QFuture<bool> future = task.promise.future();
+
+    if (QThread::currentThread() != this) {
+        QMutexLocker locker(&m_mutex);
+        if (! m_stopped && isRunning()) {
+            m_tasks.enqueue(task);
+            m_condition.wakeOne();
+            return future;
+        }
+    }
+
+    // Called by a job itself or while not running, the queue will never be
+    // drained, run it in the current thread
+    QSqlDatabase db = DatabaseManager::getDatabase();
+    const bool succeed = db.isValid() && runJob(db, job);
+    task.promise.reportResult(succeed);
+    task.promise.reportFinished();
+
+    return future;
+}
+
+/*!
+ * \brief DatabaseWriter::stop
+ * Finish all queued jobs and wait for the thread to exit.
+ */
+void DatabaseWriter::stop()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopped = true;
+        m_condition.wakeOne();
+    }
+    wait();
+}
+
+void DatabaseWriter::run()
+{
+    QSqlDatabase db = DatabaseManager::getDatabase();
+
+    forever {
+        QQueue<Task> tasks;
+        {
+            QMutexLocker locker(&m_mutex);
+            while (m_tasks.isEmpty() && ! m_stopped) {
+                m_condition.wait(&m_mutex);
+            }
+            if (m_tasks.isEmpty()) {
+                break;
+            }
+            tasks.swap(m_tasks);
+        }
+
+        QList<bool> results;
+        QSqlQuery query(db);
+        const bool inTransaction = db.isValid()
+                && query.exec("BEGIN IMMEDIATE TRANSACTION");
+        for (const Task &task : tasks) {
+            results << (inTransaction && runJob(db, task.job));
+        }
+        if (inTransaction && ! query.exec("COMMIT")) {
+            qWarning() << "Commit database transaction failed: "
+                       << query.lastError();
+            query.exec("ROLLBACK");
+            for (int i = 0; i < results.length(); i ++) {
+                results[i] = false;
+            }
+        }
+
+        for (int i = 0; i < tasks.length(); i ++) {
+            tasks[i].promise.reportResult(results[i]);
+            tasks[i].promise.reportFinished();
+        }
+    }
+}
+
+bool DatabaseWriter::runJob(QSqlDatabase &db, const Job &job)
+{
+    QSqlQuery query(db);
+    if (! query.exec("SAVEPOINT job")) {
+        qWarning() << "Create savepoint failed: " << query.lastError();
+        return false;
+    }
+
+    if (job(db)) {
+        query.exec("RELEASE job");
+        return true;
+    }
+    else {
+        query.exec("ROLLBACK TO job");
+        query.exec("RELEASE job");
+        return false;
+    }
+}
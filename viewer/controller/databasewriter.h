@@ -0,0 +1,51 @@
+#ifndef DATABASEWRITER_H
+#define DATABASEWRITER_H
+
+#include <QFuture>
+#include <QFutureInterface>
+#include <QMutex>
+#include <QQueue>
+#include <QSqlDatabase>
+#include <QThread>
+#include <QWaitCondition>
+#include <functional>
+
+/*!
+ * \brief The DatabaseWriter class
+ * The only thread which writes the library database.
+ * Jobs queued while a transaction is running are coalesced into the next
+ * one, each job runs in its own SAVEPOINT so a failed job doesn't roll
+ * back the others.
+ */
+class DatabaseWriter : public QThread
+{
+    Q_OBJECT
+public:
+    // Return false to roll back everything the job has written
+    typedef std::function<bool(QSqlDatabase &)> Job;
+
+    explicit DatabaseWriter(QObject *parent = 0);
+    ~DatabaseWriter();
+
+    QFuture<bool> enqueue(const Job &job);
+    void stop();
+
+protected:
+    void run() Q_DECL_OVERRIDE;
+
+private:
+    struct Task {
+        Job job;
+        QFutureInterface<bool> promise;
+    };
+
+    bool runJob(QSqlDatabase &db, const Job &job);
+
+private:
+    QMutex m_mutex;
+    QWaitCondition m_condition;
+    QQueue<Task> m_tasks;
+    bool m_stopped;
+};
+
+#endif // DATABASEWRITER_H
@@ -1,59 +1,30 @@
 #include "importer.h"
 #include "application.h"
 #include "controller/databasemanager.h"
-#include "controller/signalmanager.h"
-#include "utils/imageutils.h"
+#include "controller/importjournal.h"
+#include "controller/importpipeline.h"
+#include "controller/librarywatcher.h"
+#include "utils/baseutils.h"
 #include <QDebug>
 #include <QDir>
-#include <QDirIterator>
 #include <QFileDialog>
 #include <QFileInfo>
 #include <QTimer>
 
 Importer::Importer(QObject *parent)
     : QObject(parent),
+      m_pipeline(nullptr),
+      m_generation(0),
       m_progress(1),
-      m_imagesCount(0)
+      m_importedCount(0),
+      m_currentCount(0)
 {
-    connect(&m_futureWatcher, SIGNAL(finished()),
-            this, SLOT(onFutureWatcherFinish()));
-    connect(&m_futureWatcher, SIGNAL(resultReadyAt(int)),
-            this, SLOT(onFutureResultReady(int)));
-}
-
-QString insertImage(QString path)
-{
-    const QStringList albums = Importer::instance()->getAlbums(path);
-    QFileInfo fileInfo(path);
-    DatabaseManager::ImageInfo imgInfo;
-    imgInfo.name = fileInfo.fileName();
-    imgInfo.path = fileInfo.absoluteFilePath();
-    imgInfo.time = utils::image::getCreateDateTime(path);
-    imgInfo.albums = albums;
-    imgInfo.labels = QStringList();
-//    DatabaseManager::instance()->insertImageInfo(imgInfo);
-
-    return path;
-}
-
-void Importer::loadCacheImages()
-{
-    QStringList pathList = m_cacheImportList;
-    QFuture<QString> future = QtConcurrent::mapped(pathList, insertImage);
-    m_futureWatcher.setFuture(future);
-}
+    // Batches are inserted in the pipeline thread
+    qRegisterMetaType<QList<DatabaseManager::ImageInfo>>(
+                "QList<DatabaseManager::ImageInfo>");
 
-QStringList Importer::getAlbums(const QString &path) const
-{
-    const QString album = m_albums.value(path);
-    if (album.isEmpty()) {
-        return QStringList();
-    }
-    else {
-        QStringList l;
-        l << album;
-        return l;
-    }
+    // Don't compete with the first paint
+    TIMER_SINGLESHOT(3000, {resumeImports();}, this);
 }
 
 Importer *Importer::m_importer = NULL;
@@ -71,27 +42,35 @@ bool Importer::isRunning() const
     return m_progress != 1;
 }
 
-double Importer::getProgress() const
+bool Importer::isImporting(const QString &root) const
 {
-    return m_progress;
+    const QString dir = QDir::cleanPath(QFileInfo(root).absoluteFilePath());
+    QList<QStringList> rootLists;
+    if (m_pipeline) {
+        rootLists << m_pipeline->roots();
+    }
+    for (const ImportTask &task : m_tasks) {
+        rootLists << task.roots;
+    }
+    for (const QStringList &roots : rootLists) {
+        for (const QString &r : roots) {
+            if (QDir::cleanPath(QFileInfo(r).absoluteFilePath()) == dir) {
+                return true;
+            }
+        }
+    }
+
+    return false;
 }
 
-int Importer::finishedCount() const
+double Importer::getProgress() const
 {
-    return m_imagesCount - m_cacheImportList.length();
+    return m_progress;
 }
 
-/*!
- * \brief Importer::nap
- * Nap for unblock main UI
- */
-void Importer::nap()
+int Importer::finishedCount() const
 {
-    if (m_progress != 1) {
-        m_futureWatcher.setPaused(true);
-        TIMER_SINGLESHOT(500,
-        {m_futureWatcher.setPaused(false);},this);
-    }
+    return m_importedCount + m_currentCount;
 }
 
 void Importer::showImportDialog(const QString &album)
@@ -106,85 +85,241 @@ void Importer::showImportDialog(const QString &album)
 
 void Importer::stopImport()
 {
-    m_futureWatcher.cancel();
-    m_futureWatcher.waitForFinished();
-    m_cacheImportList.clear();
-    m_albums.clear();
+    m_tasks.clear();
+    if (m_pipeline) {
+        // The committed batches are kept, and the rest is resumed if the
+        // roots are imported again
+        m_pipeline->stop();
+        deletePipeline();
+    }
+    m_importedCount = 0;
+    m_currentCount = 0;
     m_progress = 1.0;
-    m_imagesCount = 0;
     emit importProgressChanged(m_progress);
 }
 
+/*!
+ * \brief Importer::shutdown
+ * Cancel the running import and wait for its workers. It isn't stopped, so
+ * its journal resumes it at the next start.
+ */
+void Importer::shutdown()
+{
+    m_tasks.clear();
+    if (m_pipeline) {
+        m_pipeline->cancel();
+        // Waits for the workers
+        deletePipeline();
+    }
+}
+
 void Importer::importDir(const QString &path, const QString &album)
 {
-    const QFileInfoList infos = utils::image::getImagesInfo(path);
-    if( !QDir(path).exists() || infos.isEmpty() ) {
+    if (path.isEmpty() || ! QDir(path).exists()) {
         return;
     }
 
-    // To avoid the repeat names
-    QStringList imgNames;
-    QList<DatabaseManager::ImageInfo> imgInfos;
-    for (QFileInfo info : infos) {
-        if (imgNames.indexOf(info.fileName()) != -1)
-            continue;
-        imgNames << info.fileName();
-        DatabaseManager::ImageInfo imgInfo;
-        imgInfo.name = info.fileName();
-        imgInfo.path = info.absoluteFilePath();
-        imgInfo.time = utils::image::getCreateDateTime(imgInfo.path);
-        imgInfo.albums = QStringList(album);
-        imgInfo.labels = QStringList();
+    // Remember it for the rescan, and keep it in sync from now on
+    dApp->databaseM->insertImportRoot(QFileInfo(path).absoluteFilePath(), album);
+    dApp->watcher->addRoot(path);
+    import(QStringList(path), album);
+}
+
+void Importer::importFiles(const QStringList &files, const QString &album)
+{
+    if (files.isEmpty())
+        return;
+
+    import(files, album);
+}
+
+/*!
+ * \brief Importer::updateFiles
+ * The batches of LibraryWatcher are small and frequent, starting over is
+ * cheaper than keeping a journal of them on disk.
+ * \param files
+ * \param album
+ */
+void Importer::updateFiles(const QStringList &files, const QString &album)
+{
+    if (files.isEmpty()) {
+        return;
+    }
+
+    import(files, album, true);
+}
 
-        imgInfos << imgInfo;
+/*!
+ * \brief Importer::rescan
+ * Only the new and changed files are read, and the images whose files are
+ * gone are removed, so it costs about a stat per file.
+ * \param dir
+ */
+void Importer::rescan(const QString &dir)
+{
+    const QMap<QString, QString> roots = dApp->databaseM->getImportRoots();
+    if (! dir.isEmpty()) {
+        // Images found in a sub directory go to the album of its root
+        const QString path = QDir::cleanPath(QFileInfo(dir).absoluteFilePath());
+        QString root;
+        for (const QString &r : roots.keys()) {
+            if ((path == r || path.startsWith(r + "/"))
+                    && r.length() > root.length()) {
+                root = r;
+            }
+        }
+        import(QStringList(path), roots.value(root), true);
+        return;
     }
 
-    dApp->databaseM->insertImageInfos(imgInfos);
+    for (auto it = roots.cbegin(); it != roots.cend(); ++it) {
+        // The sub directories are walked with their parent
+        bool nested = false;
+        for (const QString &root : roots.keys()) {
+            if (it.key().startsWith(root + "/")) {
+                nested = true;
+                break;
+            }
+        }
+        if (! nested) {
+            import(QStringList(it.key()), it.value(), true);
+        }
+    }
+}
 
-    emit importProgressChanged(1);
+void Importer::onPipelineProgress(int generation, int imported, int found)
+{
+    if (! m_pipeline || generation != m_generation) {
+        return;
+    }
+
+    m_currentCount = imported;
+    // It is finished only after the pipeline is
+    m_progress = qMin(0.99, 1.0 * imported / qMax(1, found));
+    emit importProgressChanged(m_progress);
 }
 
-void Importer::importFiles(const QStringList &files, const QString &album)
+void Importer::onPipelineFinished(int generation)
 {
-    if (files.isEmpty())
+    if (! m_pipeline || generation != m_generation) {
+        return;
+    }
+
+    // Only the commit worker is left, it returns once finished is emitted
+    deletePipeline();
+    m_importedCount += m_currentCount;
+    m_currentCount = 0;
+
+    if (! m_tasks.isEmpty()) {
+        startNext();
+        return;
+    }
+
+    // Nothing was imported and no progress was shown
+    if (m_progress == 1 && m_importedCount == 0) {
         return;
-    QList<DatabaseManager::ImageInfo> imgInfos;
-    for (QString file : files) {
-        QFileInfo info(file);
-        DatabaseManager::ImageInfo imgInfo;
-        imgInfo.name = info.fileName();
-        imgInfo.path = info.absoluteFilePath();
-        imgInfo.time = utils::image::getCreateDateTime(file);
-        imgInfo.albums = QStringList(album);
-        imgInfo.labels = QStringList();
+    }
+
+    qDebug() << "Imported finish:" << m_importedCount;
+    m_importedCount = 0;
+    m_progress = 1;
+    emit importProgressChanged(m_progress);
+}
 
-        imgInfos << imgInfo;
+void Importer::import(const QStringList &roots, const QString &album,
+                      bool rescan)
+{
+    ImportTask task;
+    task.roots = roots;
+    task.album = album;
+    task.rescan = rescan;
+    // Continue the import of the same roots if it was stopped
+    if (! rescan) {
+        for (const QString &id : ImportJournal::journalIds()) {
+            const ImportJournal journal(id);
+            if (journal.isValid() && journal.roots() == roots
+                    && journal.album() == album && ! isJournalUsed(id)) {
+                task.journal = id;
+                break;
+            }
+        }
     }
-    dApp->databaseM->insertImageInfos(imgInfos);
+    m_tasks.enqueue(task);
 
-    emit importProgressChanged(1);
+    if (! m_pipeline) {
+        startNext();
+    }
 }
 
-void Importer::onFutureWatcherFinish()
+/*!
+ * \brief Importer::resumeImports
+ * Resume the imports interrupted by a crash or quit, the ones stopped by the
+ * user wait for the same roots to be imported again, until they expire.
+ */
+void Importer::resumeImports()
 {
-    // Imported finish
-    if (m_cacheImportList.isEmpty()) {
-        qDebug() << "Imported finish, no more cache!";
-        m_imagesCount = 0;
-        m_progress = 1;
-        m_albums.clear();
-        emit importProgressChanged(m_progress);
-//        emit dApp->signalM->showProcessTooltip(
-//                    tr("Imported successfully"), true);
+    ImportJournal::removeExpired();
+    for (const QString &id : ImportJournal::journalIds()) {
+        const ImportJournal journal(id);
+        if (! journal.isValid() || journal.isStopped() || isJournalUsed(id)) {
+            continue;
+        }
+
+        qDebug() << "Resume import:" << journal.roots();
+        ImportTask task;
+        task.roots = journal.roots();
+        task.album = journal.album();
+        task.rescan = false;
+        task.journal = id;
+        m_tasks.enqueue(task);
+    }
+
+    if (! m_pipeline && ! m_tasks.isEmpty()) {
+        startNext();
+    }
+}
+
+bool Importer::isJournalUsed(const QString &journal) const
+{
+    if (m_pipeline && m_pipeline->journalId() == journal) {
+        return true;
+    }
+    for (const ImportTask &task : m_tasks) {
+        if (task.journal == journal) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void Importer::startNext()
+{
+    const ImportTask task = m_tasks.dequeue();
+    ImportJournal *journal = task.journal.isEmpty()
+            ? nullptr : new ImportJournal(task.journal);
+    if (journal && journal->isValid()) {
+        m_pipeline = new ImportPipeline(journal, this);
     }
     else {
-        loadCacheImages();
+        delete journal;
+        m_pipeline = new ImportPipeline(task.roots, task.album, task.rescan, this);
     }
+    const int generation = ++ m_generation;
+    connect(m_pipeline, &ImportPipeline::progressChanged,
+            this, [=] (int imported, int found) {
+        onPipelineProgress(generation, imported, found);
+    });
+    connect(m_pipeline, &ImportPipeline::finished, this, [=] {
+        onPipelineFinished(generation);
+    });
+    m_pipeline->start();
 }
 
-void Importer::onFutureResultReady(int index)
+// The queued events of it may be delivered after it's gone
+void Importer::deletePipeline()
 {
-    m_cacheImportList.removeAll(m_futureWatcher.resultAt(index));
-    m_progress = 1 - (1.0 * m_cacheImportList.count() / m_imagesCount);
-    emit importProgressChanged(m_progress);
+    disconnect(m_pipeline, nullptr, this, nullptr);
+    delete m_pipeline;
+    m_pipeline = nullptr;
 }
@@ -2,47 +2,63 @@
 #define IMPORTER_H
 
 #include <QObject>
-#include <QPixmap>
-#include <QFuture>
-#include <QFutureWatcher>
-#include <QMap>
-#include <QtConcurrent>
+#include <QQueue>
+#include <QStringList>
 
-class QTimer;
+class ImportPipeline;
 class Importer : public QObject
 {
     Q_OBJECT
 public:
     static Importer *instance();
     bool isRunning() const;
+    // The import of root is running or queued
+    bool isImporting(const QString &root) const;
     double getProgress() const;
     int finishedCount() const;
-    void nap();
     void showImportDialog(const QString &album = "");
     void stopImport();
+    // Before the database is deleted at exit
+    void shutdown();
     void importDir(const QString &path, const QString &album = "");
     void importFiles(const QStringList &files, const QString &album = "");
-
-    QStringList getAlbums(const QString &path) const;
+    // Apply the files changed in the watched directories, without a journal
+    void updateFiles(const QStringList &files, const QString &album = "");
+    // Sync the library with the imported directory, all of them if it's empty
+    void rescan(const QString &dir = "");
 
 signals:
     void importProgressChanged(double progress);
 
-private slots:
-    void onFutureWatcherFinish();
-    void onFutureResultReady(int index);
-
 private:
     explicit Importer(QObject *parent = 0);
-    void loadCacheImages();
+    // The events queued by a pipeline deleted since then are of another
+    // generation, they are dropped
+    void onPipelineProgress(int generation, int imported, int found);
+    void onPipelineFinished(int generation);
+    void deletePipeline();
+    void import(const QStringList &roots, const QString &album,
+                bool rescan = false);
+    void resumeImports();
+    bool isJournalUsed(const QString &journal) const;
+    void startNext();
 
 private:
+    struct ImportTask {
+        QStringList roots;
+        QString album;
+        bool rescan;
+        QString journal;  // Id of the interrupted import to resume
+    };
+
     static Importer *m_importer;
-    QStringList m_cacheImportList;
-    QMap<QString, QString> m_albums;  // <path, album>
-    QFutureWatcher<QString> m_futureWatcher;
+    // Imports requested while another one is running
+    QQueue<ImportTask> m_tasks;
+    ImportPipeline *m_pipeline;
+    int m_generation;  // Of the running pipeline
     double m_progress;
-    int m_imagesCount;
+    int m_importedCount;  // Of the finished pipelines
+    int m_currentCount;  // Of the running pipeline
 };
 
 #endif // IMPORTER_H
@@ -0,0 +1,275 @@
+#include "importjournal.h"
+#include "databasemanager.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QSaveFile>
+
+namespace {
+
+const QString STATE_FILE = "state.json";
+// Bump it when the format of files changes, the older journals are dropped
+const int JOURNAL_VERSION = 2;
+const int JOURNAL_EXPIRY_DAYS = 30;
+// The paths of a chunk are separated by it, which no path contains
+const char PATH_SEPARATOR = '\0';
+
+// Next to the database, the journals belong to it
+QString journalPath()
+{
+    return QFileInfo(DatabaseManager::databasePath()).absolutePath()
+            + "/import-journals/";
+}
+
+// The file is replaced as a whole, it is never seen half written
+bool writeFile(const QString &path, const QByteArray &data)
+{
+    QSaveFile file(path);
+    if (! file.open(QIODevice::WriteOnly) || file.write(data) != data.length()
+            || ! file.commit()) {
+        qWarning() << "Write import journal failed:" << path << file.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+}  // namespace
+
+QStringList ImportJournal::journalIds()
+{
+    // Ids are the creation time in ms, padded to the same width
+    return QDir(journalPath()).entryList(QDir::Dirs | QDir::NoDotAndDotDot,
+                                        QDir::Name);
+}
+
+void ImportJournal::removeExpired()
+{
+    const QDateTime expiry =
+            QDateTime::currentDateTime().addDays(- JOURNAL_EXPIRY_DAYS);
+    for (const QString &id : journalIds()) {
+        ImportJournal journal(id);
+        const QFileInfo state(journalPath() + id + "/" + STATE_FILE);
+        if (! journal.isValid()
+                || (journal.isStopped() && state.lastModified() < expiry)) {
+            qDebug() << "Remove expired import journal:" << journal.roots();
+            journal.remove();
+        }
+    }
+}
+
+ImportJournal::ImportJournal(const QString &id)
+    : m_id(id),
+      m_valid(false),
+      m_stopped(false),
+      m_walked(false),
+      m_chunkCount(0),
+      m_committedCount(0)
+{
+    m_valid = load();
+}
+
+ImportJournal::ImportJournal(const QStringList &roots, const QString &album)
+    : m_id(QString("%1").arg(QDateTime::currentMSecsSinceEpoch(), 16, 10,
+                             QChar('0'))),
+      m_roots(roots),
+      m_album(album),
+      m_valid(false),
+      m_stopped(false),
+      m_walked(false),
+      m_chunkCount(0),
+      m_committedCount(0)
+{
+    // Imports started in the same ms get their own journal
+    while (QDir(journalPath() + m_id).exists()) {
+        m_id = QString("%1").arg(m_id.toLongLong() + 1, 16, 10, QChar('0'));
+    }
+    m_valid = QDir().mkpath(journalPath() + m_id);
+    if (m_valid) {
+        save();
+    }
+}
+
+bool ImportJournal::isValid() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_valid;
+}
+
+QString ImportJournal::id() const
+{
+    return m_id;
+}
+
+QStringList ImportJournal::roots() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_roots;
+}
+
+QString ImportJournal::album() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_album;
+}
+
+bool ImportJournal::isStopped() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_stopped;
+}
+
+bool ImportJournal::isWalked() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_walked;
+}
+
+int ImportJournal::chunkCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_chunkCount;
+}
+
+int ImportJournal::committedCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_committedCount;
+}
+
+int ImportJournal::appendChunk(const QStringList &paths)
+{
+    QMutexLocker locker(&m_mutex);
+    const int index = m_chunkCount;
+    QByteArray data;
+    for (const QString &path : paths) {
+        data += path.toUtf8() + PATH_SEPARATOR;
+    }
+    if (! m_valid || ! writeFile(chunkPath(index), data)) {
+        return -1;
+    }
+
+    // The state refers to the chunk once it is written
+    m_chunkCount ++;
+    save();
+    return index;
+}
+
+QStringList ImportJournal::chunk(int index) const
+{
+    QFile file(chunkPath(index));
+    if (! file.open(QIODevice::ReadOnly)) {
+        return QStringList();
+    }
+
+    QStringList paths;
+    for (const QByteArray &path : file.readAll().split(PATH_SEPARATOR)) {
+        if (! path.isEmpty()) {
+            paths << QString::fromUtf8(path);
+        }
+    }
+    return paths;
+}
+
+void ImportJournal::truncate(int index)
+{
+    QMutexLocker locker(&m_mutex);
+    if (index >= m_chunkCount) {
+        return;
+    }
+
+    const int count = m_chunkCount;
+    m_chunkCount = index;
+    m_committedCount = qMin(m_committedCount, index);
+    m_walked = false;
+    save();
+    for (int i = index; i < count; i ++) {
+        QFile::remove(chunkPath(i));
+    }
+}
+
+void ImportJournal::setStopped(bool stopped)
+{
+    QMutexLocker locker(&m_mutex);
+    m_stopped = stopped;
+    save();
+}
+
+void ImportJournal::setWalked()
+{
+    QMutexLocker locker(&m_mutex);
+    m_walked = true;
+    save();
+}
+
+void ImportJournal::setCommittedCount(int count)
+{
+    QMutexLocker locker(&m_mutex);
+    if (count != m_committedCount) {
+        m_committedCount = count;
+        save();
+    }
+}
+
+void ImportJournal::remove()
+{
+    QMutexLocker locker(&m_mutex);
+    m_valid = false;
+    QDir(journalPath() + m_id).removeRecursively();
+}
+
+QString ImportJournal::chunkPath(int index) const
+{
+    return QString("%1%2/chunk-%3").arg(journalPath()).arg(m_id).arg(index);
+}
+
+bool ImportJournal::load()
+{
+    QFile file(journalPath() + m_id + "/" + STATE_FILE);
+    if (! file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    const QJsonObject state = QJsonDocument::fromJson(file.readAll()).object();
+    if (state.isEmpty()) {
+        qWarning() << "Broken import journal:" << file.fileName();
+        return false;
+    }
+    if (state.value("version").toInt() != JOURNAL_VERSION) {
+        return false;
+    }
+    for (const QJsonValue &root : state.value("roots").toArray()) {
+        m_roots << root.toString();
+    }
+    m_album = state.value("album").toString();
+    m_stopped = state.value("stopped").toBool();
+    m_walked = state.value("walked").toBool();
+    m_chunkCount = state.value("chunkCount").toInt();
+    m_committedCount = state.value("committedCount").toInt();
+
+    return true;
+}
+
+void ImportJournal::save()
+{
+    if (! m_valid) {
+        return;
+    }
+
+    QJsonObject state;
+    state.insert("version", JOURNAL_VERSION);
+    state.insert("roots", QJsonArray::fromStringList(m_roots));
+    state.insert("album", m_album);
+    state.insert("stopped", m_stopped);
+    state.insert("walked", m_walked);
+    state.insert("chunkCount", m_chunkCount);
+    state.insert("committedCount", m_committedCount);
+    writeFile(journalPath() + m_id + "/" + STATE_FILE,
+              QJsonDocument(state).toJson(QJsonDocument::Compact));
+}
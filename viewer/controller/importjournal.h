@@ -0,0 +1,69 @@
+#ifndef IMPORTJOURNAL_H
+#define IMPORTJOURNAL_H
+
+#include <QMutex>
+#include <QStringList>
+
+/*!
+ * \brief The ImportJournal class
+ * The on-disk record of a running import: its roots, the walked paths in
+ * chunks, and how many chunks are committed from the first one. An import
+ * which is interrupted(stopped, crashed or quit) resumes from the first
+ * uncommitted chunk instead of starting over.
+ * It is removed once the import finished. A stopped one whose roots are
+ * never imported again expires, see removeExpired().
+ */
+class ImportJournal
+{
+public:
+    // The journals of the interrupted imports, oldest first
+    static QStringList journalIds();
+    // Remove the broken journals, and the stopped ones untouched for long
+    static void removeExpired();
+
+    // Load the journal of id
+    explicit ImportJournal(const QString &id);
+    // Start a new journal
+    ImportJournal(const QStringList &roots, const QString &album);
+
+    bool isValid() const;
+    QString id() const;
+    QStringList roots() const;
+    QString album() const;
+    // Stopped by the user, it isn't resumed until the roots are imported again
+    bool isStopped() const;
+    // All the paths are in the chunks
+    bool isWalked() const;
+    int chunkCount() const;
+    // Chunks [0, committedCount) are committed
+    int committedCount() const;
+
+    // Return the index of chunk, -1 if it can't be written
+    int appendChunk(const QStringList &paths);
+    QStringList chunk(int index) const;
+    // Drop the chunks from index, they are walked again
+    void truncate(int index);
+    void setStopped(bool stopped);
+    void setWalked();
+    void setCommittedCount(int count);
+    // The import finished
+    void remove();
+
+private:
+    QString chunkPath(int index) const;
+    bool load();
+    void save();
+
+private:
+    mutable QMutex m_mutex;
+    QString m_id;
+    QStringList m_roots;
+    QString m_album;
+    bool m_valid;
+    bool m_stopped;
+    bool m_walked;
+    int m_chunkCount;
+    int m_committedCount;
+};
+
+#endif // IMPORTJOURNAL_H
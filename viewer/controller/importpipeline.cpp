@@ -0,0 +1,474 @@
+#include "importpipeline.h"
+#include "application.h"
+#include "controller/importjournal.h"
+#include "controller/workscheduler.h"
+#include "utils/dirwalker.h"
+#include "utils/exifparser.h"
+#include "utils/imageutils.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QImageReader>
+#include <QMutexLocker>
+#include <QSet>
+#include <QtConcurrent>
+#include <sys/stat.h>
+
+namespace {
+
+const int PATH_QUEUE_SIZE = 4096;
+const int IMAGE_QUEUE_SIZE = 1024;
+const int COMMIT_BATCH_SIZE = 1000;
+const int COMMIT_INTERVAL = 500;  // ms, flush a partial batch after it
+const int JOURNAL_CHUNK_SIZE = 1000;
+// Sniffing is bound by I/O, metadata reading uses the other cores
+const int SNIFF_THREADS = 2;
+// ms, a waiting reader checks whether the import is canceled after it
+const int SLOT_TIMEOUT = 100;
+
+// Fill the name, path and file state of info, return false if it can't stat
+bool readFileState(const QString &path, DatabaseManager::ImageInfo &info)
+{
+    struct stat st;
+    if (::stat(QFile::encodeName(path).constData(), &st) != 0) {
+        return false;
+    }
+
+    info.name = QFileInfo(path).fileName();
+    info.path = path;
+    info.fileSize = st.st_size;
+    info.modified = qint64(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    info.inode = st.st_ino;
+    return true;
+}
+
+bool sameFileState(const DatabaseManager::ImageInfo &a,
+                   const DatabaseManager::ImageInfo &b)
+{
+    return a.fileSize == b.fileSize && a.modified == b.modified
+            && a.inode == b.inode;
+}
+
+}  // namespace
+
+ImportPipeline::ImportPipeline(const QStringList &roots, const QString &album,
+                               bool rescan, QObject *parent)
+    : QObject(parent),
+      m_roots(roots),
+      m_album(album),
+      m_rescan(rescan),
+      // A rescan is cheap to start over
+      m_journal(rescan ? nullptr : new ImportJournal(roots, album)),
+      m_files(PATH_QUEUE_SIZE),
+      m_images(IMAGE_QUEUE_SIZE),
+      m_infos(COMMIT_BATCH_SIZE * 2),
+      m_committedChunks(0),
+      m_sniffers(0),
+      m_readers(0),
+      m_found(0),
+      m_canceled(0)
+{
+}
+
+ImportPipeline::ImportPipeline(ImportJournal *journal, QObject *parent)
+    : QObject(parent),
+      m_roots(journal->roots()),
+      m_album(journal->album()),
+      m_rescan(false),
+      m_journal(journal),
+      m_files(PATH_QUEUE_SIZE),
+      m_images(IMAGE_QUEUE_SIZE),
+      m_infos(COMMIT_BATCH_SIZE * 2),
+      m_committedChunks(journal->committedCount()),
+      m_sniffers(0),
+      m_readers(0),
+      m_found(0),
+      m_canceled(0)
+{
+    m_journal->setStopped(false);
+}
+
+ImportPipeline::~ImportPipeline()
+{
+    cancel();
+    m_pool.waitForDone();
+    delete m_journal;
+}
+
+QString ImportPipeline::journalId() const
+{
+    return m_journal ? m_journal->id() : QString();
+}
+
+QStringList ImportPipeline::roots() const
+{
+    return m_roots;
+}
+
+void ImportPipeline::start()
+{
+    const int readers = qMax(1, QThread::idealThreadCount());
+    m_sniffers.store(SNIFF_THREADS);
+    m_readers.store(readers);
+    // The walker and the committer have their own thread
+    m_pool.setMaxThreadCount(SNIFF_THREADS + readers + 2);
+
+    QtConcurrent::run(&m_pool, [=] { walk(); });
+    for (int i = 0; i < SNIFF_THREADS; i ++) {
+        QtConcurrent::run(&m_pool, [=] { sniff(); });
+    }
+    for (int i = 0; i < readers; i ++) {
+        QtConcurrent::run(&m_pool, [=] { readMetadata(); });
+    }
+    QtConcurrent::run(&m_pool, [=] { commit(); });
+}
+
+void ImportPipeline::cancel()
+{
+    m_canceled.store(1);
+    m_files.abort();
+    m_images.abort();
+    m_infos.abort();
+}
+
+void ImportPipeline::stop()
+{
+    if (m_journal) {
+        m_journal->setStopped(true);
+    }
+    cancel();
+}
+
+
+void ImportPipeline::walk()
+{
+    if (m_journal && m_journal->isWalked()) {
+        walkJournal();
+        m_files.close();
+        return;
+    }
+
+    if (m_journal) {
+        // The uncommitted chunks of an interrupted walk are walked again
+        for (int i = 0; i < m_journal->committedCount(); i ++) {
+            for (const QString &path : m_journal->chunk(i)) {
+                m_committedPaths.insert(path);
+            }
+        }
+        m_journal->truncate(m_journal->committedCount());
+    }
+
+    for (const QString &root : m_roots) {
+        const QString path = QFileInfo(root).absoluteFilePath();
+        if (QFileInfo(path).isDir()) {
+            walkDir(QDir::cleanPath(path));
+            continue;
+        }
+
+        DatabaseManager::ImageInfo info;
+        if (readFileState(path, info)) {
+            pushWalked(info);
+        }
+    }
+
+    if (m_journal && ! m_canceled.load()) {
+        QMutexLocker locker(&m_chunkMutex);
+        if (flushChunk()) {
+            m_journal->setWalked();
+        }
+    }
+    m_files.close();
+}
+
+void ImportPipeline::walkDir(const QString &root)
+{
+    // <path, image> of the library, what is left after walking has vanished
+    QHash<QString, DatabaseManager::ImageInfo> known;
+    if (m_rescan) {
+        for (auto info : dApp->databaseM->getImageInfosByDirectory(root)) {
+            known.insert(info.path, info);
+        }
+    }
+
+    QMutex knownMutex;
+    QAtomicInt walked(0);
+    utils::DirWalker walker;
+    const bool finished = walker.walk(root, [&] (const QString &path) {
+        DatabaseManager::ImageInfo info;
+        if (! readFileState(path, info)) {
+            return true;
+        }
+        walked.ref();
+
+        if (m_rescan) {
+            QMutexLocker locker(&knownMutex);
+            auto image = known.find(info.path);
+            if (image != known.end()) {
+                const bool unchanged = sameFileState(image.value(), info);
+                known.erase(image);
+                if (unchanged) {
+                    return ! m_canceled.load();
+                }
+            }
+        }
+        return pushWalked(info) && ! m_canceled.load();
+    });
+    if (! finished) {
+        return;
+    }
+
+    // An unmounted share looks like an empty directory, keep its images
+    if (walked.load() == 0 && ! known.isEmpty()) {
+        qWarning() << "Rescan found nothing in" << root
+                   << ", its images are kept";
+        return;
+    }
+    // So do the subtrees which couldn't be read
+    const QStringList failedDirs = walker.failedDirs();
+    for (const QString &dir : failedDirs) {
+        qWarning() << "Rescan can't read" << dir << ", its images are kept";
+    }
+    for (const DatabaseManager::ImageInfo &info : known) {
+        bool unread = false;
+        for (const QString &dir : failedDirs) {
+            if (info.path.startsWith(dir + "/")) {
+                unread = true;
+                break;
+            }
+        }
+        if (! unread) {
+            m_vanished << info.name;
+        }
+    }
+}
+
+/*!
+ * \brief ImportPipeline::walkJournal
+ * All the paths of the interrupted import are journaled, pass on the ones of
+ * the uncommitted chunks.
+ */
+void ImportPipeline::walkJournal()
+{
+    for (int i = m_journal->committedCount(); i < m_journal->chunkCount(); i ++) {
+        QList<Item> items;
+        for (const QString &path : m_journal->chunk(i)) {
+            DatabaseManager::ImageInfo info;
+            if (readFileState(path, info)) {
+                items << Item{info, i};
+            }
+        }
+
+        {
+            QMutexLocker locker(&m_unfinishedMutex);
+            m_unfinished.insert(i, items.length());
+        }
+        if (items.isEmpty()) {
+            finishItems(QList<int>());
+        }
+        for (const Item &item : items) {
+            if (! m_files.push(item)) {
+                return;
+            }
+        }
+    }
+}
+
+// Called in the walker threads
+bool ImportPipeline::pushWalked(const DatabaseManager::ImageInfo &info)
+{
+    if (! m_journal) {
+        return m_files.push(Item{info, -1});
+    }
+    if (m_committedPaths.contains(info.path)) {
+        return true;
+    }
+
+    QMutexLocker locker(&m_chunkMutex);
+    m_chunk << info;
+    return m_chunk.length() < JOURNAL_CHUNK_SIZE || flushChunk();
+}
+
+// Journal the walked paths as a chunk and pass them on, m_chunkMutex is locked
+bool ImportPipeline::flushChunk()
+{
+    if (m_chunk.isEmpty()) {
+        return true;
+    }
+
+    QStringList paths;
+    for (const DatabaseManager::ImageInfo &info : m_chunk) {
+        paths << info.path;
+    }
+    const int chunk = m_journal->appendChunk(paths);
+    if (chunk < 0) {
+        // The cursor can't pass a chunk which isn't on disk, the import is
+        // resumed from the last written one
+        m_chunk.clear();
+        cancel();
+        return false;
+    }
+    {
+        QMutexLocker locker(&m_unfinishedMutex);
+        m_unfinished.insert(chunk, m_chunk.length());
+    }
+
+    const QList<DatabaseManager::ImageInfo> infos = m_chunk;
+    m_chunk.clear();
+    for (const DatabaseManager::ImageInfo &info : infos) {
+        if (! m_files.push(Item{info, chunk})) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*!
+ * \brief ImportPipeline::finishItems
+ * The items are committed or dropped, move the committed cursor of journal
+ * over the chunks which have nothing in flight.
+ * \param chunks of the items
+ */
+void ImportPipeline::finishItems(const QList<int> &chunks)
+{
+    if (! m_journal) {
+        return;
+    }
+
+    QMutexLocker locker(&m_unfinishedMutex);
+    for (int chunk : chunks) {
+        if (chunk >= 0) {
+            m_unfinished[chunk] --;
+        }
+    }
+
+    int committed = m_committedChunks;
+    while (m_unfinished.value(committed, -1) == 0) {
+        m_unfinished.remove(committed);
+        committed ++;
+    }
+    if (committed != m_committedChunks) {
+        m_committedChunks = committed;
+        m_journal->setCommittedCount(committed);
+    }
+}
+
+void ImportPipeline::sniff()
+{
+    Item item;
+    while (m_files.pop(item)) {
+        if (utils::image::imageSupportRead(item.info.path)) {
+            m_found.ref();
+            m_images.push(item);
+        }
+        else {
+            finishItems(QList<int>() << item.chunk);
+        }
+    }
+
+    if (! m_sniffers.deref()) {
+        m_images.close();
+    }
+}
+
+/*!
+ * \brief ImportPipeline::readMetadata
+ * It takes most of the CPU, the readers beyond the concurrency of
+ * WorkScheduler wait for their turn to keep the UI responsive.
+ */
+void ImportPipeline::readMetadata()
+{
+    WorkScheduler *scheduler = WorkScheduler::instance();
+    Item item;
+    while (m_images.pop(item)) {
+        bool slot = false;
+        while (! m_canceled.load()
+               && ! (slot = scheduler->acquireSlot(SLOT_TIMEOUT))) {
+        }
+
+        DatabaseManager::ImageInfo &info = item.info;
+        const QString &path = info.path;
+        // All of them in one pass of the header
+        const utils::image::ExifInfo exif = utils::image::readExif(path);
+        info.time = exif.dateTimeOriginal.isValid()
+                ? exif.dateTimeOriginal : QFileInfo(path).created();
+        info.size = exif.size.isValid() ? exif.size : QImageReader(path).size();
+        info.camera = exif.camera;
+        info.lens = exif.lens;
+        info.orientation = exif.orientation;
+        if (! m_album.isEmpty()) {
+            info.albums << m_album;
+        }
+        if (slot) {
+            scheduler->releaseSlot();
+        }
+        m_infos.push(item);
+    }
+
+    if (! m_readers.deref()) {
+        m_infos.close();
+    }
+}
+
+void ImportPipeline::commit()
+{
+    // The name is the key of library, the first one wins
+    QSet<QString> names;
+    QList<DatabaseManager::ImageInfo> batch;
+    QList<int> chunks;  // Of the batch and the dropped items
+    QElapsedTimer timer;
+    int imported = 0;
+
+    forever {
+        Item item;
+        const bool popped = m_infos.pop(item, COMMIT_INTERVAL);
+        if (popped) {
+            chunks << item.chunk;
+            if (! names.contains(item.info.name)) {
+                names.insert(item.info.name);
+                if (batch.isEmpty()) {
+                    timer.start();
+                }
+                batch << item.info;
+            }
+        }
+
+        const bool drained = ! popped && m_infos.isFinished();
+        if (! batch.isEmpty() && ! m_canceled.load()
+                && (drained || batch.length() >= COMMIT_BATCH_SIZE
+                    || timer.elapsed() >= COMMIT_INTERVAL)) {
+            // The journal isn't advanced past a batch failed to be written,
+            // it's imported again when the import is resumed
+            if (! dApp->databaseM->insertImageInfos(batch)) {
+                cancel();
+                break;
+            }
+            finishItems(chunks);
+            imported += batch.length();
+            batch.clear();
+            chunks.clear();
+            emit progressChanged(imported, m_found.load());
+        }
+        if (drained) {
+            break;
+        }
+    }
+
+    // The walk is done once the queues are drained, a moved file is
+    // committed with its new path under the same name
+    QStringList vanished;
+    for (const QString &name : m_vanished) {
+        if (! names.contains(name)) {
+            vanished << name;
+        }
+    }
+    if (! m_canceled.load() && ! vanished.isEmpty()) {
+        dApp->databaseM->removeImages(vanished);
+    }
+    if (! m_canceled.load() && m_journal) {
+        m_journal->remove();
+    }
+
+    emit finished();
+}
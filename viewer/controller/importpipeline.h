@@ -0,0 +1,97 @@
+#ifndef IMPORTPIPELINE_H
+#define IMPORTPIPELINE_H
+
+#include "controller/databasemanager.h"
+#include "utils/blockingqueue.h"
+#include <QAtomicInt>
+#include <QMutex>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QThreadPool>
+
+/*!
+ * \brief The ImportPipeline class
+ * Import images by stages which run at the same time on their own threads:
+ * walk the roots -> sniff the format -> read the metadata -> commit to the
+ * database by batches. The stages are linked by bounded queues, and every
+ * batch is visible in the library once it is committed, so the first
+ * images show up while the rest are still being read.
+ * A rescan only stats the files under the roots: the unchanged ones are
+ * skipped, the changed ones are read again, and the images whose files are
+ * gone are removed from the library.
+ * An import keeps a journal of the walked paths and the committed chunks of
+ * them, so it can be resumed from where it was interrupted.
+ */
+class ImportJournal;
+class ImportPipeline : public QObject
+{
+    Q_OBJECT
+public:
+    // Roots are directories(walked recursively) or image files
+    explicit ImportPipeline(const QStringList &roots, const QString &album,
+                            bool rescan = false, QObject *parent = 0);
+    // Resume the interrupted import, the pipeline takes the journal
+    explicit ImportPipeline(ImportJournal *journal, QObject *parent = 0);
+    ~ImportPipeline();
+
+    QString journalId() const;
+    QStringList roots() const;
+    void start();
+    // The committed batches are kept, it resumes at the next start
+    void cancel();
+    // Cancel, and don't resume until the roots are imported again
+    void stop();
+
+signals:
+    // Emitted in the commit thread after every batch
+    void progressChanged(int imported, int found);
+    void finished();
+
+private:
+    struct Item {
+        DatabaseManager::ImageInfo info;
+        int chunk;  // Of the journal, -1 if it isn't journaled
+    };
+
+    void walk();
+    void walkDir(const QString &root);
+    void walkJournal();
+    bool pushWalked(const DatabaseManager::ImageInfo &info);
+    bool flushChunk();
+    void finishItems(const QList<int> &chunks);
+    void sniff();
+    void readMetadata();
+    void commit();
+
+private:
+    const QStringList m_roots;
+    const QString m_album;
+    const bool m_rescan;
+    QThreadPool m_pool;
+
+    ImportJournal *m_journal;  // Null for the rescan
+
+    // Only the path and the file state are filled before the metadata stage
+    utils::BlockingQueue<Item> m_files;
+    utils::BlockingQueue<Item> m_images;
+    utils::BlockingQueue<Item> m_infos;
+
+    // Walked paths are journaled by chunks before passing on
+    QMutex m_chunkMutex;
+    QList<DatabaseManager::ImageInfo> m_chunk;
+    // Paths of the committed chunks, skipped while walking again
+    QSet<QString> m_committedPaths;
+    QMutex m_unfinishedMutex;
+    QHash<int, int> m_unfinished;  // <chunk, items in flight>
+    int m_committedChunks;
+    // Names of the images whose files are gone, removed after the commit
+    QStringList m_vanished;
+    // Workers left in the stage, the last one closes the next queue
+    QAtomicInt m_sniffers;
+    QAtomicInt m_readers;
+    QAtomicInt m_found;
+    QAtomicInt m_canceled;
+};
+
+#endif // IMPORTPIPELINE_H
@@ -0,0 +1,217 @@
+#include "librarysnapshot.h"
+
+namespace {
+
+// Split the path to directory and file name
+void splitPath(const QString &path, QString &dir, QString &name)
+{
+    const int index = path.lastIndexOf('/');
+    dir = path.left(index);
+    name = path.mid(index + 1);
+}
+
+}  // namespace
+
+LibrarySnapshot::LibrarySnapshot()
+    : d(new LibrarySnapshotData)
+{
+}
+
+LibrarySnapshot::LibrarySnapshot(const LibrarySnapshot &other)
+    : d(other.d)
+{
+}
+
+LibrarySnapshot &LibrarySnapshot::operator=(const LibrarySnapshot &other)
+{
+    d = other.d;
+    return *this;
+}
+
+LibrarySnapshot::~LibrarySnapshot()
+{
+}
+
+int LibrarySnapshot::imageCount() const
+{
+    return d->ids.length();
+}
+
+bool LibrarySnapshot::contains(const QString &name) const
+{
+    return d->nameIndex.contains(name);
+}
+
+bool LibrarySnapshot::containsPath(const QString &path) const
+{
+    QString dir, name;
+    splitPath(path, dir, name);
+    const int row = rowOf(name);
+    return row != -1 && d->dirs[row] == d->dirIndex.value(dir, -1);
+}
+
+DatabaseManager::ImageInfo LibrarySnapshot::imageByName(const QString &name) const
+{
+    const int row = rowOf(name);
+    return row == -1 ? DatabaseManager::ImageInfo() : imageAt(row);
+}
+
+DatabaseManager::ImageInfo LibrarySnapshot::imageByPath(const QString &path) const
+{
+    QString dir, name;
+    splitPath(path, dir, name);
+    const int row = rowOf(name);
+    if (row == -1 || d->dirs[row] != d->dirIndex.value(dir, -1)) {
+        return DatabaseManager::ImageInfo();
+    }
+    else {
+        return imageAt(row);
+    }
+}
+
+QStringList LibrarySnapshot::albumNames() const
+{
+    return d->albumNames;
+}
+
+int LibrarySnapshot::albumImageCount(const QString &album) const
+{
+    return d->albums.value(album).count();
+}
+
+bool LibrarySnapshot::imageInAlbum(const QString &name, const QString &album) const
+{
+    const int row = rowOf(name);
+    return row != -1 && d->albums.value(album).contains(d->ids[row]);
+}
+
+void LibrarySnapshot::insertImage(const DatabaseManager::ImageInfo &info)
+{
+    QString dir, file;
+    splitPath(info.path, dir, file);
+    int dirRow = d->dirIndex.value(dir, -1);
+    if (dirRow == -1) {
+        dirRow = d->dirNames.length();
+        d->dirNames << dir;
+        d->dirIndex.insert(dir, dirRow);
+    }
+
+    const int row = rowOf(info.name);
+    if (row == -1) {
+        d->nameIndex.insert(info.name, d->ids.length());
+        d->ids << info.id;
+        d->dirs << dirRow;
+        d->names << info.name;
+        d->times << (info.time.isValid()
+                     ? info.time.toMSecsSinceEpoch() / 1000 : 0);
+        d->widths << qMax(0, info.size.width());
+        d->heights << qMax(0, info.size.height());
+        d->orientations << info.orientation;
+    }
+    else {
+        if (info.id != 0) {
+            d->ids[row] = info.id;
+        }
+        d->dirs[row] = dirRow;
+        d->times[row] = info.time.isValid()
+                ? info.time.toMSecsSinceEpoch() / 1000 : 0;
+        d->widths[row] = qMax(0, info.size.width());
+        d->heights[row] = qMax(0, info.size.height());
+        d->orientations[row] = info.orientation;
+    }
+}
+
+void LibrarySnapshot::removeImage(const QString &name)
+{
+    const int row = rowOf(name);
+    if (row == -1) {
+        return;
+    }
+
+    const qint64 id = d->ids[row];
+    for (auto it = d->albums.begin(); it != d->albums.end(); ++it) {
+        it.value().remove(id);
+    }
+
+    // Move the last row to the removed one to keep the rows dense
+    const int last = d->ids.length() - 1;
+    if (row != last) {
+        d->ids[row] = d->ids[last];
+        d->dirs[row] = d->dirs[last];
+        d->names[row] = d->names[last];
+        d->times[row] = d->times[last];
+        d->widths[row] = d->widths[last];
+        d->heights[row] = d->heights[last];
+        d->orientations[row] = d->orientations[last];
+        d->nameIndex[d->names[row]] = row;
+    }
+    d->ids.removeLast();
+    d->dirs.removeLast();
+    d->names.removeLast();
+    d->times.removeLast();
+    d->widths.removeLast();
+    d->heights.removeLast();
+    d->orientations.removeLast();
+    d->nameIndex.remove(name);
+}
+
+void LibrarySnapshot::insertIntoAlbum(const QString &album, qint64 id)
+{
+    if (! d->albums.contains(album)) {
+        d->albumNames << album;
+    }
+    QSet<qint64> &ids = d->albums[album];
+    if (id != 0) {
+        ids.insert(id);
+    }
+}
+
+void LibrarySnapshot::removeFromAlbum(const QString &album, const QString &name)
+{
+    const int row = rowOf(name);
+    if (row != -1 && d->albums.contains(album)) {
+        d->albums[album].remove(d->ids[row]);
+    }
+}
+
+void LibrarySnapshot::removeAlbum(const QString &album)
+{
+    if (d->albums.remove(album) > 0) {
+        d->albumNames.removeOne(album);
+    }
+}
+
+void LibrarySnapshot::renameAlbum(const QString &oldName, const QString &newName)
+{
+    if (oldName == newName || ! d->albums.contains(oldName)) {
+        return;
+    }
+
+    const QSet<qint64> ids = d->albums.take(oldName);
+    if (d->albums.contains(newName)) {
+        d->albums[newName].unite(ids);
+        d->albumNames.removeOne(oldName);
+    }
+    else {
+        d->albums.insert(newName, ids);
+        d->albumNames[d->albumNames.indexOf(oldName)] = newName;
+    }
+}
+
+int LibrarySnapshot::rowOf(const QString &name) const
+{
+    return d->nameIndex.value(name, -1);
+}
+
+DatabaseManager::ImageInfo LibrarySnapshot::imageAt(int row) const
+{
+    DatabaseManager::ImageInfo info;
+    info.id = d->ids[row];
+    info.name = d->names[row];
+    info.path = d->dirNames[d->dirs[row]] + "/" + info.name;
+    info.time = QDateTime::fromMSecsSinceEpoch(d->times[row] * 1000);
+    info.size = QSize(d->widths[row], d->heights[row]);
+    info.orientation = d->orientations[row];
+
+    return info;
+}
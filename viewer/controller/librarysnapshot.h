@@ -0,0 +1,76 @@
+#ifndef LIBRARYSNAPSHOT_H
+#define LIBRARYSNAPSHOT_H
+
+#include "databasemanager.h"
+#include <QHash>
+#include <QSet>
+#include <QSharedData>
+#include <QSharedDataPointer>
+#include <QStringList>
+#include <QVector>
+
+class LibrarySnapshotData;
+
+/*!
+ * \brief The LibrarySnapshot class
+ * An in-memory copy of the library for the lookups of the UI.
+ * Images are stored by column, the directory of path is interned and the
+ * name(it is the file name) is shared with the name column. Copying is
+ * cheap, the data is only detached while it is modified.
+ */
+class LibrarySnapshot
+{
+public:
+    LibrarySnapshot();
+    LibrarySnapshot(const LibrarySnapshot &other);
+    LibrarySnapshot &operator=(const LibrarySnapshot &other);
+    ~LibrarySnapshot();
+
+    int imageCount() const;
+    bool contains(const QString &name) const;
+    bool containsPath(const QString &path) const;
+    DatabaseManager::ImageInfo imageByName(const QString &name) const;
+    DatabaseManager::ImageInfo imageByPath(const QString &path) const;
+
+    QStringList albumNames() const;
+    int albumImageCount(const QString &album) const;
+    bool imageInAlbum(const QString &name, const QString &album) const;
+
+    // Insert or update the image by name, id 0 keeps the current id
+    void insertImage(const DatabaseManager::ImageInfo &info);
+    void removeImage(const QString &name);
+    // Id 0 only makes sure the album exist
+    void insertIntoAlbum(const QString &album, qint64 id);
+    void removeFromAlbum(const QString &album, const QString &name);
+    void removeAlbum(const QString &album);
+    void renameAlbum(const QString &oldName, const QString &newName);
+
+private:
+    int rowOf(const QString &name) const;
+    DatabaseManager::ImageInfo imageAt(int row) const;
+
+private:
+    QSharedDataPointer<LibrarySnapshotData> d;
+};
+
+class LibrarySnapshotData : public QSharedData
+{
+public:
+    // Columns, one row for every image
+    QVector<qint64> ids;
+    QVector<int> dirs;  // Index of dirNames
+    QVector<QString> names;
+    QVector<qint64> times;  // Seconds since epoch
+    QVector<int> widths;
+    QVector<int> heights;
+    QVector<quint8> orientations;
+
+    QStringList dirNames;
+    QHash<QString, int> dirIndex;
+    QHash<QString, int> nameIndex;  // <name, row>
+
+    QStringList albumNames;  // Creation order
+    QHash<QString, QSet<qint64>> albums;  // <album, image ids>
+};
+
+#endif // LIBRARYSNAPSHOT_H
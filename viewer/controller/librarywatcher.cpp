@@ -0,0 +1,460 @@
+#include "librarywatcher.h"
+#include "application.h"
+#include "controller/configsetter.h"
+#include "controller/databasemanager.h"
+#include "controller/importer.h"
+#include "utils/baseutils.h"
+#include "utils/imageutils.h"
+#include "utils/thumbnailcache.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <QtConcurrent>
+#include <errno.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace {
+
+const int STARTUP_DELAY = 5000;  // ms, don't compete with the first paint
+const int FLUSH_DELAY = 1000;  // ms of quiet before the changes are applied
+const int MAX_FLUSH_DELAY = 10000;  // ms, even if the events keep coming
+const int POLL_INTERVAL = 10 * 60 * 1000;  // ms
+const int EVENT_BUFFER_SIZE = 64 * 1024;
+const QString SETTINGS_GROUP = "LIBRARYWATCHER";
+const QString SETTINGS_CATCH_UP_HOURS_KEY = "CatchUpHours";
+const QString SETTINGS_LAST_CATCH_UP_KEY = "LastCatchUp";
+const int DEFAULT_CATCH_UP_HOURS = 24;
+const uint32_t WATCH_EVENTS = IN_CREATE | IN_CLOSE_WRITE | IN_DELETE
+        | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+
+}  // namespace
+
+LibraryWatcher *LibraryWatcher::m_watcher = NULL;
+LibraryWatcher *LibraryWatcher::instance()
+{
+    if (!m_watcher) {
+        m_watcher = new LibraryWatcher();
+    }
+
+    return m_watcher;
+}
+
+LibraryWatcher::LibraryWatcher(QObject *parent)
+    : QObject(parent),
+      m_notifier(nullptr),
+      m_flushTimer(new QTimer(this)),
+      m_pollTimer(new QTimer(this)),
+      m_overflowed(false),
+      m_catchUp(false)
+{
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd < 0) {
+        qWarning() << "Init inotify failed:" << strerror(errno);
+    }
+    else {
+        m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+        connect(m_notifier, &QSocketNotifier::activated,
+                this, &LibraryWatcher::onEventsReady);
+    }
+
+    m_flushTimer->setSingleShot(true);
+    connect(m_flushTimer, &QTimer::timeout, this, &LibraryWatcher::flush);
+    m_pollTimer->setInterval(POLL_INTERVAL);
+    connect(m_pollTimer, &QTimer::timeout,
+            this, &LibraryWatcher::rescanPolledRoots);
+
+    TIMER_SINGLESHOT(STARTUP_DELAY, {start();}, this);
+}
+
+LibraryWatcher::~LibraryWatcher()
+{
+    if (m_fd >= 0) {
+        close(m_fd);
+    }
+}
+
+void LibraryWatcher::start()
+{
+    // Walking every root at every start is too much for the large ones
+    const int hours = dApp->setter->value(SETTINGS_GROUP,
+                                          SETTINGS_CATCH_UP_HOURS_KEY,
+                                          DEFAULT_CATCH_UP_HOURS).toInt();
+    const QDateTime last = dApp->setter->value(
+                SETTINGS_GROUP, SETTINGS_LAST_CATCH_UP_KEY).toDateTime();
+    const QDateTime now = QDateTime::currentDateTime();
+    m_catchUp = hours >= 0
+            && (! last.isValid() || last.addSecs(hours * 3600) <= now);
+    if (m_catchUp) {
+        dApp->setter->setValue(SETTINGS_GROUP, SETTINGS_LAST_CATCH_UP_KEY, now);
+    }
+
+    const QMap<QString, QString> roots = dApp->databaseM->getImportRoots();
+    for (auto it = roots.cbegin(); it != roots.cend(); ++it) {
+        m_roots.insert(it.key(), it.value());
+    }
+    for (const QString &root : m_roots.keys()) {
+        addRoot(root);
+    }
+}
+
+/*!
+ * \brief LibraryWatcher::addRoot
+ * Add the watches of root in a worker thread, it may take a while on a large
+ * tree. At a catch-up start the root is rescanned once they are added, for
+ * the changes made while it wasn't watched.
+ * \param root
+ */
+void LibraryWatcher::addRoot(const QString &root)
+{
+    const QString dir = QDir::cleanPath(QFileInfo(root).absoluteFilePath());
+    if (! m_roots.contains(dir)) {
+        m_roots.insert(dir, dApp->databaseM->getImportRoots().value(dir));
+    }
+    // The sub directories are watched with their parent
+    for (const QString &r : m_roots.keys()) {
+        if (dir.startsWith(r + "/")) {
+            return;
+        }
+    }
+
+    if (m_fd < 0) {
+        if (! m_polledRoots.contains(dir)) {
+            m_polledRoots << dir;
+        }
+        m_pollTimer->start();
+        return;
+    }
+
+    const int fd = m_fd;
+    QFuture<RootWatches> future = QtConcurrent::run([=] {
+        return addWatches(fd, dir);
+    });
+    DatabaseManager::watch(future, this, [=] (const RootWatches &watches) {
+        onRootWatched(watches);
+    });
+}
+
+void LibraryWatcher::onEventsReady()
+{
+    alignas(inotify_event) char buffer[EVENT_BUFFER_SIZE];
+    forever {
+        const ssize_t length = read(m_fd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;
+        }
+
+        const inotify_event *event = nullptr;
+        for (char *p = buffer; p < buffer + length;
+             p += sizeof(inotify_event) + event->len) {
+            event = reinterpret_cast<const inotify_event *>(p);
+            if (event->mask & IN_Q_OVERFLOW) {
+                qWarning() << "Inotify queue overflowed, rescan the library";
+                m_overflowed = true;
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                m_dirs.remove(event->wd);
+                continue;
+            }
+
+            const QString dir = m_dirs.value(event->wd);
+            if (dir.isEmpty() || event->len == 0) {
+                continue;
+            }
+
+            const QString path = dir + "/" + QFile::decodeName(event->name);
+            if (event->mask & IN_ISDIR) {
+                if (event->mask & IN_MOVED_TO
+                        && m_movedFrom.contains(event->cookie)) {
+                    const QString from = m_movedFrom.take(event->cookie);
+                    m_removedDirs.remove(from);
+                    // Follow the move of a directory moved already
+                    bool chained = false;
+                    for (auto it = m_movedDirs.begin();
+                         it != m_movedDirs.end(); ++it) {
+                        if (it.value() == from) {
+                            it.value() = path;
+                            chained = true;
+                        }
+                    }
+                    if (! chained) {
+                        m_movedDirs.insert(from, path);
+                    }
+                }
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    // Files may be written before the watch is added,
+                    // the directory is rescanned as well
+                    watchDirectory(path);
+                    m_removedDirs.remove(path);
+                    m_changedPaths.insert(path);
+                }
+                else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                    removeWatches(path);
+                    m_changedPaths.remove(path);
+                    m_removedDirs.insert(path);
+                    if (event->mask & IN_MOVED_FROM) {
+                        m_movedFrom.insert(event->cookie, path);
+                    }
+                }
+            }
+            else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                m_removedPaths.remove(path);
+                m_changedPaths.insert(path);
+            }
+            else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                m_changedPaths.remove(path);
+                m_removedPaths.insert(path);
+            }
+            // A created file is changed by IN_CLOSE_WRITE later
+        }
+
+        scheduleFlush();
+    }
+}
+
+/*!
+ * \brief LibraryWatcher::flush
+ * Apply the pending changes: the removed images in one transaction, and the
+ * changed files by unjournaled imports grouped by album.
+ */
+void LibraryWatcher::flush()
+{
+    m_flushTimer->stop();
+    m_pendingTimer.invalidate();
+
+    // The ones moved out of the library are removed below
+    m_movedFrom.clear();
+
+    if (m_overflowed) {
+        m_overflowed = false;
+        m_changedPaths.clear();
+        m_removedPaths.clear();
+        m_removedDirs.clear();
+        m_movedDirs.clear();
+        for (const QString &root : m_roots.keys()) {
+            if (isWatched(root)) {
+                dApp->importer->rescan(root);
+            }
+        }
+        return;
+    }
+
+    // Before the rescan of the new directories, which skips the moved images
+    // as unchanged
+    for (auto it = m_movedDirs.cbegin(); it != m_movedDirs.cend(); ++it) {
+        dApp->databaseM->moveDirectory(it.key(), it.value());
+    }
+
+    // A moved file is updated to its new path by the import, the name is
+    // the key of the library
+    QSet<QString> changedNames;
+    for (const QString &path : m_changedPaths) {
+        changedNames.insert(QFileInfo(path).fileName());
+    }
+    QStringList removedNames;
+    for (const QString &path : m_removedPaths) {
+        const QString name = dApp->databaseM->getImageInfoByPath(path).name;
+        if (! name.isEmpty() && ! changedNames.contains(name)) {
+            removedNames << name;
+        }
+    }
+    for (const QString &dir : m_removedDirs) {
+        for (auto info : dApp->databaseM->getImageInfosByDirectory(dir)) {
+            if (! changedNames.contains(info.name)) {
+                removedNames << info.name;
+            }
+        }
+    }
+    if (! removedNames.isEmpty()) {
+        dApp->databaseM->removeImages(removedNames);
+    }
+
+    QMap<QString, QStringList> files;  // <album, paths>
+    QStringList stalePaths = m_removedPaths.toList();
+    for (const QString &path : m_changedPaths) {
+        if (QFileInfo(path).isDir()) {
+            dApp->importer->rescan(path);
+        }
+        else {
+            files[albumOf(path)] << path;
+            stalePaths << path;
+        }
+    }
+    // The cached thumbnails aren't validated by the paint path, the ones in
+    // memory are dropped at once and the files on disk by a worker
+    for (const QString &path : stalePaths) {
+        utils::image::ThumbnailCache::instance()->remove(path);
+    }
+    if (! stalePaths.isEmpty()) {
+        QtConcurrent::run([stalePaths] {
+            for (const QString &path : stalePaths) {
+                utils::image::removeThumbnail(path);
+            }
+        });
+    }
+    for (auto it = files.cbegin(); it != files.cend(); ++it) {
+        dApp->importer->updateFiles(it.value(), it.key());
+    }
+
+    m_changedPaths.clear();
+    m_removedPaths.clear();
+    m_removedDirs.clear();
+    m_movedDirs.clear();
+}
+
+void LibraryWatcher::rescanPolledRoots()
+{
+    for (const QString &root : m_polledRoots) {
+        dApp->importer->rescan(root);
+    }
+}
+
+/*!
+ * \brief LibraryWatcher::addWatches
+ * Watch dir and all its sub directories, it stops at the first failure of
+ * running out of watches. It is called in worker threads.
+ * \param fd
+ * \param dir
+ * \return
+ */
+LibraryWatcher::RootWatches LibraryWatcher::addWatches(int fd,
+                                                       const QString &dir)
+{
+    RootWatches watches;
+    watches.root = dir;
+
+    QStringList dirs(dir);
+    QDirIterator it(dir, QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        dirs << it.next();
+    }
+
+    for (const QString &d : dirs) {
+        const int wd = inotify_add_watch(fd, QFile::encodeName(d).constData(),
+                                         WATCH_EVENTS);
+        if (wd >= 0) {
+            watches.dirs.insert(wd, d);
+        }
+        else if (errno == ENOSPC) {
+            watches.exhausted = true;
+            break;
+        }
+    }
+
+    return watches;
+}
+
+void LibraryWatcher::onRootWatched(const RootWatches &watches)
+{
+    if (! watches.exhausted) {
+        for (auto it = watches.dirs.cbegin(); it != watches.dirs.cend(); ++it) {
+            m_dirs.insert(it.key(), it.value());
+        }
+        // Catch up the changes made while it wasn't watched, unless it's
+        // being imported(eg: a root just imported)
+        if (m_catchUp && m_roots.contains(watches.root)
+                && ! dApp->importer->isImporting(watches.root)) {
+            dApp->importer->rescan(watches.root);
+        }
+        return;
+    }
+
+    // Give the watches back for the other roots, and poll this one
+    for (int wd : watches.dirs.keys()) {
+        inotify_rm_watch(m_fd, wd);
+    }
+    QString root = watches.root;
+    for (const QString &r : m_roots.keys()) {
+        if (root.startsWith(r + "/")) {
+            root = r;
+            removeWatches(r);
+            break;
+        }
+    }
+    qWarning() << "Run out of inotify watches, rescan" << root
+               << "every" << POLL_INTERVAL / 1000 << "seconds instead";
+    if (! m_polledRoots.contains(root)) {
+        m_polledRoots << root;
+    }
+    m_pollTimer->start();
+    if (m_catchUp) {
+        dApp->importer->rescan(root);
+    }
+}
+
+/*!
+ * \brief LibraryWatcher::watchDirectory
+ * Watch a directory created or moved into the library, in a worker thread
+ * like addRoot(). The files written before its watches are added are caught
+ * up by another rescan of it.
+ * \param dir
+ */
+void LibraryWatcher::watchDirectory(const QString &dir)
+{
+    const int fd = m_fd;
+    QFuture<RootWatches> future = QtConcurrent::run([=] {
+        return addWatches(fd, dir);
+    });
+    DatabaseManager::watch(future, this, [=] (const RootWatches &watches) {
+        onRootWatched(watches);
+        if (! watches.exhausted) {
+            m_changedPaths.insert(dir);
+            scheduleFlush();
+        }
+    });
+}
+
+// Remove the watches of dir and its sub directories
+void LibraryWatcher::removeWatches(const QString &dir)
+{
+    for (auto it = m_dirs.begin(); it != m_dirs.end();) {
+        if (it.value() == dir || it.value().startsWith(dir + "/")) {
+            inotify_rm_watch(m_fd, it.key());
+            it = m_dirs.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+bool LibraryWatcher::isWatched(const QString &path) const
+{
+    for (const QString &root : m_polledRoots) {
+        if (path == root || path.startsWith(root + "/")) {
+            return false;
+        }
+    }
+    return true;
+}
+
+QString LibraryWatcher::albumOf(const QString &path) const
+{
+    QString root;
+    for (const QString &r : m_roots.keys()) {
+        if (path.startsWith(r + "/") && r.length() > root.length()) {
+            root = r;
+        }
+    }
+
+    return m_roots.value(root);
+}
+
+void LibraryWatcher::scheduleFlush()
+{
+    if (! m_pendingTimer.isValid()) {
+        m_pendingTimer.start();
+    }
+
+    // Wait for the events to calm down, but not forever
+    const qint64 left = MAX_FLUSH_DELAY - m_pendingTimer.elapsed();
+    m_flushTimer->start(int(qBound(qint64(0), left, qint64(FLUSH_DELAY))));
+}
@@ -0,0 +1,82 @@
+#ifndef LIBRARYWATCHER_H
+#define LIBRARYWATCHER_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMap>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+
+class QSocketNotifier;
+class QTimer;
+
+/*!
+ * \brief The LibraryWatcher class
+ * Watch the imported directories recursively by inotify, and apply the file
+ * changes to the library. Events are coalesced by path and applied by
+ * batches once they calm down, so a camera dump of thousands of files is a
+ * few imports instead of thousands of them.
+ * A root which can't get all its watches(see fs.inotify.max_user_watches)
+ * is rescanned periodically instead.
+ * The changes made while the viewer wasn't running are caught up by a
+ * rescan of the roots at start up, at most once in CatchUpHours(24 by
+ * default, negative for never) of the config.
+ */
+class LibraryWatcher : public QObject
+{
+    Q_OBJECT
+public:
+    static LibraryWatcher *instance();
+    ~LibraryWatcher();
+
+    // Watch all the import roots
+    void start();
+    void addRoot(const QString &root);
+
+private slots:
+    void onEventsReady();
+    void flush();
+    void rescanPolledRoots();
+
+private:
+    // Watches of a root, added by a worker thread
+    struct RootWatches {
+        QString root;
+        QHash<int, QString> dirs;  // <watch descriptor, directory>
+        bool exhausted = false;  // Run out of watches
+    };
+
+    explicit LibraryWatcher(QObject *parent = 0);
+    static RootWatches addWatches(int fd, const QString &root);
+    void onRootWatched(const RootWatches &watches);
+    void watchDirectory(const QString &dir);
+    void removeWatches(const QString &dir);
+    bool isWatched(const QString &path) const;
+    QString albumOf(const QString &path) const;
+    void scheduleFlush();
+
+private:
+    static LibraryWatcher *m_watcher;
+    int m_fd;
+    QSocketNotifier *m_notifier;
+    QHash<int, QString> m_dirs;  // <watch descriptor, directory>
+    QMap<QString, QString> m_roots;  // <root, album>
+    QStringList m_polledRoots;
+    QTimer *m_flushTimer;
+    QTimer *m_pollTimer;
+    QElapsedTimer m_pendingTimer;  // Since the first pending event
+
+    // Pending changes, the last event of a path wins
+    QSet<QString> m_changedPaths;  // Files and new directories
+    QSet<QString> m_removedPaths;
+    QSet<QString> m_removedDirs;
+    // A directory moved inside the library keeps its images, the moves are
+    // paired by the cookie of inotify
+    QHash<quint32, QString> m_movedFrom;  // <cookie, directory>
+    QMap<QString, QString> m_movedDirs;  // <from, to>
+    bool m_overflowed;  // Events are lost, rescan all the roots
+    bool m_catchUp;  // Rescan the roots once they are watched
+};
+
+#endif // LIBRARYWATCHER_H
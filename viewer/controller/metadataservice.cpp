@@ -0,0 +1,65 @@
+#include "metadataservice.h"
+#include "application.h"
+#include "controller/databasemanager.h"
+#include "controller/workscheduler.h"
+#include "utils/imageutils.h"
+#include <QFile>
+#include <QtConcurrent>
+#include <sys/stat.h>
+
+namespace {
+
+// Few panels are open at once, the reading is bound by I/O
+const int READ_THREADS = 2;
+
+}  // namespace
+
+MetadataService *MetadataService::m_service = NULL;
+MetadataService *MetadataService::instance()
+{
+    if (!m_service) {
+        m_service = new MetadataService();
+    }
+
+    return m_service;
+}
+
+MetadataService::MetadataService(QObject *parent)
+    : QObject(parent)
+{
+    m_pool.setMaxThreadCount(READ_THREADS);
+}
+
+QFuture<QMap<QString, QString>> MetadataService::metadata(const QString &path)
+{
+    return QtConcurrent::run(&m_pool, [=] { return readMetadata(path); });
+}
+
+QMap<QString, QString> MetadataService::readMetadata(const QString &path)
+{
+    struct stat st;
+    if (stat(QFile::encodeName(path).constData(), &st) != 0) {
+        return QMap<QString, QString>();
+    }
+    const qint64 modified = qint64(st.st_mtim.tv_sec) * 1000000000
+            + st.st_mtim.tv_nsec;
+
+    QMap<QString, QString> metadata;
+    if (dApp->databaseM->getMetadata(path, st.st_size, modified, metadata)) {
+        return metadata;
+    }
+
+    // The user is waiting for it, it goes ahead of the background work
+    WorkScheduler *scheduler = WorkScheduler::instance();
+    scheduler->acquireSlot(-1, WorkScheduler::Visible);
+    metadata = utils::image::getAllMetaData(path);
+    scheduler->releaseSlot();
+    dApp->databaseM->insertMetadata(path, st.st_size, modified, metadata);
+    return metadata;
+}
+
+void MetadataService::shutdown()
+{
+    m_pool.clear();
+    m_pool.waitForDone();
+}
@@ -0,0 +1,38 @@
+#ifndef METADATASERVICE_H
+#define METADATASERVICE_H
+
+#include <QFuture>
+#include <QMap>
+#include <QObject>
+#include <QThreadPool>
+
+/*!
+ * \brief The MetadataService class
+ * Read the metadata(EXIF, IPTC and the basic file infos) shown by the info
+ * panels in the background. The tags are read from the header only, and
+ * kept in the database by path until the file is modified. Reading a file
+ * takes a slot of WorkScheduler with the Visible priority, so an open panel
+ * doesn't wait behind the import.
+ */
+class MetadataService : public QObject
+{
+    Q_OBJECT
+public:
+    static MetadataService *instance();
+
+    // Watch it by DatabaseManager::watch()
+    QFuture<QMap<QString, QString>> metadata(const QString &path);
+    // Drop the queued jobs and wait for the running ones, before the
+    // database is deleted at exit
+    void shutdown();
+
+private:
+    explicit MetadataService(QObject *parent = 0);
+    QMap<QString, QString> readMetadata(const QString &path);
+
+private:
+    static MetadataService *m_service;
+    QThreadPool m_pool;
+};
+
+#endif // METADATASERVICE_H
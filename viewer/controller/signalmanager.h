@@ -55,7 +55,8 @@ signals:
     void gotoAlbumPanel(const QString &album = "");
     void createAlbum();
     void importDir(const QString &dir);
-    void insertIntoAlbum(const DatabaseManager::ImageInfo info);
+    void insertedIntoAlbum(const QString &album,
+                           const QList<DatabaseManager::ImageInfo> &infos);
     void removedFromAlbum(const QString &album, const QStringList &names);
 
 //    void windowStatesChanged(const Qt::WindowStates state);
@@ -0,0 +1,72 @@
+#include "thumbnailservice.h"
+#include "controller/workscheduler.h"
+#include "utils/imageutils.h"
+#include <QMutexLocker>
+#include <QThread>
+#include <QtConcurrent>
+
+ThumbnailService *ThumbnailService::m_service = NULL;
+ThumbnailService *ThumbnailService::instance()
+{
+    if (!m_service) {
+        m_service = new ThumbnailService();
+    }
+
+    return m_service;
+}
+
+ThumbnailService::ThumbnailService(QObject *parent)
+    : QObject(parent)
+{
+    m_pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+}
+
+QFuture<QPixmap> ThumbnailService::thumbnail(const QString &path)
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_jobs.find(path);
+    if (it != m_jobs.end()) {
+        return it.value().future();
+    }
+
+    QFutureInterface<QPixmap> job;
+    job.reportStarted();
+    m_jobs.insert(path, job);
+    locker.unlock();
+
+    QtConcurrent::run(&m_pool, [=] { generate(path, job); });
+    return job.future();
+}
+
+void ThumbnailService::generate(const QString &path,
+                                QFutureInterface<QPixmap> job)
+{
+    // Share the slots with the import, so scrolling stays smooth, the
+    // thumbnails shown are served first
+    WorkScheduler *scheduler = WorkScheduler::instance();
+    scheduler->acquireSlot(-1, WorkScheduler::Visible);
+    const QPixmap thumbnail = utils::image::getThumbnail(path);
+    scheduler->releaseSlot();
+    job.reportResult(thumbnail);
+    job.reportFinished();
+
+    // The requests from now on load it from the cache
+    QMutexLocker locker(&m_mutex);
+    m_jobs.remove(path);
+}
+
+void ThumbnailService::shutdown()
+{
+    m_pool.clear();
+    {
+        // The dropped jobs never finish on their own, and the results of
+        // the running ones are of no use anymore
+        QMutexLocker locker(&m_mutex);
+        for (QFutureInterface<QPixmap> &job : m_jobs) {
+            job.reportCanceled();
+            job.reportFinished();
+        }
+        m_jobs.clear();
+    }
+    m_pool.waitForDone();
+}
@@ -0,0 +1,45 @@
+#ifndef THUMBNAILSERVICE_H
+#define THUMBNAILSERVICE_H
+
+#include <QFuture>
+#include <QFutureInterface>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QPixmap>
+#include <QThreadPool>
+
+/*!
+ * \brief The ThumbnailService class
+ * The one generator of thumbnails for all the views. Thumbnails are loaded
+ * from the cache or generated on a pool of a thread per core, without a
+ * global lock, as many at once as WorkScheduler gives slots. They are asked
+ * for by the views painting them, so they go ahead of the import. The
+ * requests of a path already in flight share its job, so every thumbnail is
+ * generated once however many views ask for it.
+ */
+class ThumbnailService : public QObject
+{
+    Q_OBJECT
+public:
+    static ThumbnailService *instance();
+
+    // Watch it by DatabaseManager::watch(), the pixmap is null if the image
+    // can't be read
+    QFuture<QPixmap> thumbnail(const QString &path);
+    // Cancel the queued jobs and wait for the running ones, before the
+    // database is deleted at exit
+    void shutdown();
+
+private:
+    explicit ThumbnailService(QObject *parent = 0);
+    void generate(const QString &path, QFutureInterface<QPixmap> job);
+
+private:
+    static ThumbnailService *m_service;
+    QThreadPool m_pool;
+    QMutex m_mutex;  // Guards the jobs only, never held while generating
+    QHash<QString, QFutureInterface<QPixmap>> m_jobs;  // In flight
+};
+
+#endif // THUMBNAILSERVICE_H
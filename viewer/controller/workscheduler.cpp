@@ -0,0 +1,209 @@
+#include "workscheduler.h"
+#include <QApplication>
+#include <QDebug>
+#include <QEvent>
+#include <QMutexLocker>
+#include <QThread>
+#include <QTimer>
+#include <climits>
+
+namespace {
+
+const int PROBE_INTERVAL = 50;  // ms
+const int WINDOW_INTERVAL = 500;  // ms, the concurrency is adjusted by it
+const int FRAME_BUDGET = 16;  // ms of latency while interacting
+const int IDLE_TIMEOUT = 2000;  // ms since the last input
+
+bool isInputEvent(QEvent::Type type)
+{
+    switch (type) {
+    case QEvent::MouseButtonPress:
+    case QEvent::MouseButtonRelease:
+    case QEvent::MouseButtonDblClick:
+    case QEvent::MouseMove:
+    case QEvent::Wheel:
+    case QEvent::KeyPress:
+    case QEvent::KeyRelease:
+    case QEvent::TouchBegin:
+    case QEvent::TouchUpdate:
+    case QEvent::Resize:
+        return true;
+    default:
+        return false;
+    }
+}
+
+}  // namespace
+
+WorkScheduler *WorkScheduler::m_scheduler = NULL;
+WorkScheduler *WorkScheduler::instance()
+{
+    if (!m_scheduler) {
+        m_scheduler = new WorkScheduler();
+    }
+
+    return m_scheduler;
+}
+
+WorkScheduler::WorkScheduler(QObject *parent)
+    : QObject(parent),
+      m_probeTimer(new QTimer(this)),
+      m_maxLatency(0),
+      m_maxConcurrency(qMax(2, QThread::idealThreadCount())),
+      m_concurrency(m_maxConcurrency),
+      m_running(0),
+      m_waiting(0),
+      m_visibleWaiting(0),
+      m_probing(false)
+{
+    qApp->installEventFilter(this);
+
+    m_probeTimer->setTimerType(Qt::PreciseTimer);
+    m_probeTimer->setInterval(PROBE_INTERVAL);
+    connect(m_probeTimer, &QTimer::timeout, this, &WorkScheduler::onProbe);
+}
+
+int WorkScheduler::concurrency() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_concurrency;
+}
+
+int WorkScheduler::maxConcurrency() const
+{
+    return m_maxConcurrency;
+}
+
+bool WorkScheduler::acquireSlot(int timeout, Priority priority)
+{
+    QMutexLocker locker(&m_mutex);
+    if (! m_probing) {
+        // The timer lives in the GUI thread
+        m_probing = true;
+        QMetaObject::invokeMethod(this, "startProbe", Qt::QueuedConnection);
+    }
+
+    const bool visible = priority == Visible;
+    // The background work doesn't take a slot the visible work waits for
+    auto isFull = [&] {
+        return m_running >= m_concurrency
+                || (! visible && m_visibleWaiting > 0);
+    };
+    QWaitCondition &slotFreed = visible ? m_visibleSlotFreed : m_slotFreed;
+    QElapsedTimer waited;
+    waited.start();
+    m_waiting ++;
+    if (visible) {
+        m_visibleWaiting ++;
+    }
+    while (isFull()) {
+        const qint64 left = timeout - waited.elapsed();
+        if (timeout >= 0 && left <= 0) {
+            break;
+        }
+        slotFreed.wait(&m_mutex, timeout < 0 ? ULONG_MAX : ulong(left));
+    }
+    m_waiting --;
+    if (visible && -- m_visibleWaiting == 0 && m_running + 1 < m_concurrency) {
+        // The background work held back by it may go on
+        m_slotFreed.wakeAll();
+    }
+
+    if (isFull()) {
+        return false;
+    }
+    m_running ++;
+    return true;
+}
+
+void WorkScheduler::releaseSlot()
+{
+    QMutexLocker locker(&m_mutex);
+    m_running --;
+    if (m_visibleWaiting > 0) {
+        m_visibleSlotFreed.wakeOne();
+    }
+    else {
+        m_slotFreed.wakeOne();
+    }
+}
+
+void WorkScheduler::recordFrame(int duration)
+{
+    // The window starts over when the probe starts
+    if (m_probeTimer->isActive()) {
+        m_maxLatency = qMax(m_maxLatency, duration);
+    }
+}
+
+bool WorkScheduler::eventFilter(QObject *obj, QEvent *e)
+{
+    Q_UNUSED(obj)
+    if (isInputEvent(e->type())) {
+        m_inputElapsed.start();
+    }
+
+    return false;
+}
+
+void WorkScheduler::startProbe()
+{
+    if (m_probeTimer->isActive()) {
+        return;
+    }
+
+    m_maxLatency = 0;
+    m_probeElapsed.start();
+    m_windowElapsed.start();
+    m_probeTimer->start();
+}
+
+void WorkScheduler::onProbe()
+{
+    // How late the timer is served
+    const int latency = qMax(qint64(0), m_probeElapsed.restart() - PROBE_INTERVAL);
+    m_maxLatency = qMax(m_maxLatency, latency);
+    if (m_windowElapsed.elapsed() < WINDOW_INTERVAL) {
+        return;
+    }
+
+    const int current = concurrency();
+    const bool interacting = m_inputElapsed.isValid()
+            && m_inputElapsed.elapsed() < IDLE_TIMEOUT;
+    if (! interacting) {
+        setConcurrency(m_maxConcurrency);
+    }
+    else if (m_maxLatency > FRAME_BUDGET) {
+        setConcurrency(qMax(1, current / 2));
+    }
+    else if (m_maxLatency < FRAME_BUDGET / 2) {
+        setConcurrency(qMin(m_maxConcurrency, current + 1));
+    }
+
+    m_maxLatency = 0;
+    m_windowElapsed.restart();
+
+    // Don't wake the CPU for nothing, the next slot taken starts it again
+    QMutexLocker locker(&m_mutex);
+    if (m_running == 0 && m_waiting == 0) {
+        m_probing = false;
+        m_probeTimer->stop();
+    }
+}
+
+void WorkScheduler::setConcurrency(int concurrency)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (concurrency == m_concurrency) {
+            return;
+        }
+        m_concurrency = concurrency;
+        m_visibleSlotFreed.wakeAll();
+        m_slotFreed.wakeAll();
+    }
+
+    // The running work goes on, the slots taken beyond it aren't given out
+    // again until enough of them are released
+    emit concurrencyChanged(concurrency);
+}
@@ -0,0 +1,83 @@
+#ifndef WORKSCHEDULER_H
+#define WORKSCHEDULER_H
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QObject>
+#include <QWaitCondition>
+
+class QTimer;
+
+/*!
+ * \brief The WorkScheduler class
+ * Decide how many threads the background work(import, thumbnails, metadata)
+ * may use, by how responsive the GUI thread is.
+ * The latency of the GUI thread is the longest of two measures: how late
+ * the event loop serves a timer, which covers whatever blocks it(eg: input
+ * handling, the queued results), and how long the windows take to paint,
+ * which Application times by recordFrame(). While the user is interacting,
+ * the concurrency is halved once the latency goes over the frame budget and
+ * grows one by one while it stays well under it. Once the user is idle all
+ * the cores are used.
+ * The background workers take a slot by acquireSlot() for every piece of
+ * work, so the import, thumbnail and metadata workers share the slots
+ * however many threads their pools have. The work the user is waiting for
+ * (eg: the visible thumbnails, the info panel) asks for a slot with the
+ * Visible priority, it is given the next free slot ahead of the background
+ * work. The probe only runs while some work holds or waits for a slot.
+ */
+class WorkScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    enum Priority {
+        Background,
+        Visible  // The user is waiting for it
+    };
+
+    static WorkScheduler *instance();
+
+    int concurrency() const;
+    int maxConcurrency() const;
+    // Block while all the slots are taken, at most timeout ms(forever if it
+    // is negative), return whether a slot is taken. The taken slot is given
+    // back by releaseSlot().
+    bool acquireSlot(int timeout = -1, Priority priority = Background);
+    void releaseSlot();
+    // A window took duration ms to paint, called on the GUI thread
+    void recordFrame(int duration);
+
+signals:
+    void concurrencyChanged(int concurrency);
+
+protected:
+    bool eventFilter(QObject *obj, QEvent *e) Q_DECL_OVERRIDE;
+
+private slots:
+    void startProbe();
+
+private:
+    explicit WorkScheduler(QObject *parent = 0);
+    void onProbe();
+    void setConcurrency(int concurrency);
+
+private:
+    static WorkScheduler *m_scheduler;
+    QTimer *m_probeTimer;
+    QElapsedTimer m_probeElapsed;  // Since the last probe
+    QElapsedTimer m_windowElapsed;  // Since the current window started
+    QElapsedTimer m_inputElapsed;  // Since the last input
+    int m_maxLatency;  // ms, of the timer or a paint in the current window
+    const int m_maxConcurrency;
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_slotFreed;
+    QWaitCondition m_visibleSlotFreed;
+    int m_concurrency;
+    int m_running;  // Slots taken
+    int m_waiting;  // Workers waiting for a slot
+    int m_visibleWaiting;  // Of them, with the Visible priority
+    bool m_probing;
+};
+
+#endif // WORKSCHEDULER_H
@@ -1,4 +1,7 @@
 #include "imageinfodialog.h"
+#include "controller/databasemanager.h"
+#include "controller/metadataservice.h"
+#include "controller/thumbnailservice.h"
 #include "utils/imageutils.h"
 #include <QApplication>
 #include <QFormLayout>
@@ -45,14 +48,18 @@ ImageInfoDialog::ImageInfoDialog(QWidget *parent)
 void ImageInfoDialog::setPath(const QString &path)
 {
     using namespace utils::image;
-    const QPixmap p = cutSquareImage(getThumbnail(path), QSize(240, 160));
-    m_thumbnail->setPixmap(p);
+    DatabaseManager::watch(ThumbnailService::instance()->thumbnail(path), this,
+                           [=] (const QPixmap &thumbnail) {
+        m_thumbnail->setPixmap(cutSquareImage(thumbnail, QSize(240, 160)));
+    });
 
-    auto mds = getAllMetaData(path);
-
-    for (const MetaData* i = MetaDatas; ! i->key.isEmpty(); i ++) {
-        QString v = mds.value(i->key);
-        if (v.isEmpty()) continue;
-        addInfoPair(qApp->translate("MetadataName", i->name) + ":", v);
-    }
+    DatabaseManager::watch(MetadataService::instance()->metadata(path), this,
+                           [=] (const QMap<QString, QString> &mds) {
+        for (const MetaData* i = MetaDatas; ! i->key.isEmpty(); i ++) {
+            QString v = mds.value(i->key);
+            if (v.isEmpty()) continue;
+            addInfoPair(qApp->translate("MetadataName", i->name) + ":", v);
+        }
+        adjustSize();
+    });
 }
@@ -66,8 +66,6 @@ void MainWidget::onGotoPanel(ModulePanel *panel)
         return;
     }
 
-    dApp->importer->nap();
-
     // Record the last panel for restore in the next time launch
     if (p->isMainPanel() && ! p->moduleName().isEmpty()) {
         dApp->setter->setValue(SETTINGS_GROUP, SETTINGS_MAINPANEL_KEY,
@@ -211,7 +211,6 @@ void TopToolbar::initWidgets()
     });
 
     connect(importProgress, &DCircleProgress::clicked, [=]{
-        dApp->importer->nap();
         if (importProgressWidget->isHidden()) {
             progressWidgetTips->show();
             importProgressWidget->show(window()->x()+window()->width() -
@@ -155,10 +155,12 @@ void AlbumPanel::initConnection()
     connect(dApp->signalM, &SignalManager::importDir,
             this, &AlbumPanel::showImportDirDialog);
     connect(dApp->signalM, &SignalManager::imagesInserted, this, [=] {
-        onImageCountChanged(dApp->databaseM->imageCount());
+        DatabaseManager::watch(dApp->databaseM->imageCountAsync(), this,
+                               [=] (int count) { onImageCountChanged(count); });
     });
     connect(dApp->signalM, &SignalManager::imagesRemoved, this, [=] {
-        onImageCountChanged(dApp->databaseM->imageCount());
+        DatabaseManager::watch(dApp->databaseM->imageCountAsync(), this,
+                               [=] (int count) { onImageCountChanged(count); });
     });
     connect(dApp->signalM, &SignalManager::gotoAlbumPanel,
             this, [=] (const QString &album) {
@@ -346,8 +348,10 @@ void AlbumPanel::initImagesView()
         vinfo.paths = paths;
         emit dApp->signalM->viewImage(vinfo);
     });
-    connect(dApp->signalM, &SignalManager::insertIntoAlbum,
-            this, &AlbumPanel::onInsertIntoAlbum, Qt::QueuedConnection);
+    qRegisterMetaType<QList<DatabaseManager::ImageInfo>>(
+                "QList<DatabaseManager::ImageInfo>");
+    connect(dApp->signalM, &SignalManager::insertedIntoAlbum,
+            this, &AlbumPanel::onInsertedIntoAlbum, Qt::QueuedConnection);
     connect(dApp->signalM, &SignalManager::removedFromAlbum,
             this, [=] (const QString &album, const QStringList &names) {
         if (album == m_imagesView->getCurrentAlbum())
@@ -356,16 +360,12 @@ void AlbumPanel::initImagesView()
     });
     connect(dApp->importer, &Importer::importProgressChanged, this, [=] (double v) {
         if (v == 1) {
-            auto infos = dApp->databaseM->getAllImageInfos();
-            QStringList names = dApp->databaseM->getImageNamesByAlbum(m_currentAlbum);
-            for (auto info : infos) {
-                // The albums read from ImageTable is old
-                // Read DB one to improve the speed
-                if (names.contains(info.name)) {
-                    info.albums = QStringList(m_currentAlbum);
-                    onInsertIntoAlbum(info);
-                }
-            }
+            const QString album = m_currentAlbum;
+            DatabaseManager::watch(
+                        dApp->databaseM->getImageInfosByAlbumAsync(album), this,
+                        [=] (const QList<DatabaseManager::ImageInfo> &infos) {
+                onInsertedIntoAlbum(album, infos);
+            });
         }
     });
 }
@@ -391,21 +391,30 @@ void AlbumPanel::updateImagesCount(bool fromDB)
     if (m_stackWidget->currentWidget() == m_albumsView)
         return;
 
-    int count;
-    if (fromDB)
-        count = dApp->databaseM->getImagesCountByAlbum(m_currentAlbum);
-    else
-        count = m_imagesView->count();
-    QString text = QString::number(count) + " " +
-            (count <= 1 ? tr("image") : tr("images"));
-    m_countLabel->setText(text);
+    auto showCount = [=] (int count) {
+        if (m_countLabel.isNull())
+            return;
 
-    if (m_stackWidget->currentWidget() == m_imagesView) {
-        m_slider->setValue(dApp->setter->value(SETTINGS_GROUP,
-            SETTINGS_IMAGE_ICON_SCALE_KEY, QVariant(0)).toInt());
-    }
+        QString text = QString::number(count) + " " +
+                (count <= 1 ? tr("image") : tr("images"));
+        m_countLabel->setText(text);
+
+        if (m_stackWidget->currentWidget() == m_imagesView) {
+            m_slider->setValue(dApp->setter->value(SETTINGS_GROUP,
+                SETTINGS_IMAGE_ICON_SCALE_KEY, QVariant(0)).toInt());
+        }
+
+        m_slider->setFixedWidth(count > 0 ? SLIDER_WIDTH : 0);
+    };
 
-    m_slider->setFixedWidth(count > 0 ? SLIDER_WIDTH : 0);
+    if (fromDB) {
+        DatabaseManager::watch(
+                    dApp->databaseM->getImagesCountByAlbumAsync(m_currentAlbum),
+                    this, showCount);
+    }
+    else {
+        showCount(m_imagesView->count());
+    }
 }
 
 void AlbumPanel::updateAlbumCount()
@@ -417,17 +426,22 @@ void AlbumPanel::updateAlbumCount()
     if (m_stackWidget->currentWidget() == m_imagesView)
         return;
 
-    const int count = dApp->databaseM->albumsCount();
-    QString text = QString::number(count) + " " +
-            (count <= 1 ? tr("album") : tr("albums"));
-    m_countLabel->setText(text);
-    if (m_stackWidget->currentWidget() == m_albumsView) {
-        m_slider->setValue(dApp->setter->value(SETTINGS_GROUP,
-            SETTINGS_ALBUM_ICON_SCALE_KEY, QVariant(0)).toInt());
-    }
+    DatabaseManager::watch(dApp->databaseM->albumsCountAsync(), this,
+                           [=] (int count) {
+        if (m_countLabel.isNull())
+            return;
+
+        QString text = QString::number(count) + " " +
+                (count <= 1 ? tr("album") : tr("albums"));
+        m_countLabel->setText(text);
+        if (m_stackWidget->currentWidget() == m_albumsView) {
+            m_slider->setValue(dApp->setter->value(SETTINGS_GROUP,
+                SETTINGS_ALBUM_ICON_SCALE_KEY, QVariant(0)).toInt());
+        }
 
-    //set width to 1px for layout center
-    m_slider->setFixedWidth(count > 0 ? SLIDER_WIDTH : 0);
+        //set width to 1px for layout center
+        m_slider->setFixedWidth(count > 0 ? SLIDER_WIDTH : 0);
+    });
 }
 
 void AlbumPanel::showCreateDialog()
@@ -489,12 +503,16 @@ void AlbumPanel::onImageCountChanged(int count)
     updateImagesCount();
 }
 
-void AlbumPanel::onInsertIntoAlbum(const DatabaseManager::ImageInfo info)
+void AlbumPanel::onInsertedIntoAlbum(const QString &album,
+                                     const QList<DatabaseManager::ImageInfo> &infos)
 {
     // No need to update view if importing in others panel, improve performance
     if (m_imagesView->isVisible()
-            && info.albums.contains(m_imagesView->getCurrentAlbum())) {
-        m_imagesView->insertItem(info);
+            && album == m_imagesView->getCurrentAlbum()) {
+        for (int i = 0; i < infos.length(); i ++) {
+            // Update the view once after the last one
+            m_imagesView->insertItem(infos[i], i == infos.length() - 1);
+        }
         updateImagesCount();
     }
 }
@@ -525,6 +543,7 @@ void AlbumPanel::showEvent(QShowEvent *e)
 {
     // Make sure BottomContent have been init
     emit dApp->signalM->updateBottomToolbarContent(toolbarBottomContent());
-    onImageCountChanged(dApp->databaseM->imageCount());
+    DatabaseManager::watch(dApp->databaseM->imageCountAsync(), this,
+                           [=] (int count) { onImageCountChanged(count); });
     ModulePanel::showEvent(e);
 }
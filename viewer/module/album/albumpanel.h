@@ -44,7 +44,8 @@ private:
     void showCreateDialog();
     void showImportDirDialog(const QString &dir);
     void onImageCountChanged(int count);
-    void onInsertIntoAlbum(const DatabaseManager::ImageInfo info);
+    void onInsertedIntoAlbum(const QString &album,
+                             const QList<DatabaseManager::ImageInfo> &infos);
 
 private:
     QString m_currentAlbum;
@@ -4,6 +4,7 @@
 #include "controller/popupmenumanager.h"
 #include "controller/exporter.h"
 #include "controller/importer.h"
+#include "controller/thumbnailservice.h"
 #include "utils/baseutils.h"
 #include "utils/imageutils.h"
 #include "frame/deletedialog.h"
@@ -74,38 +75,17 @@ AlbumsView::AlbumsView(QWidget *parent)
 QModelIndex AlbumsView::addAlbum(const DatabaseManager::AlbumInfo &info)
 {
     // AlbumName ImageCount BeginTime EndTime Thumbnail
-    QStringList imgNames = dApp->databaseM->getImageNamesByAlbum(info.name);
-    if (imgNames.isEmpty()) {
+    if (info.name.isEmpty()) {
         return QModelIndex();
     }
 
-    QByteArray thumbnailByteArray;
-    QBuffer inBuffer( &thumbnailByteArray );
-    inBuffer.open( QIODevice::WriteOnly );
-    // write inPixmap into inByteArray
-    QString imageName = imgNames.first();
-    if (imageName.isEmpty()) {
-        for (QString name : imgNames) {
-            if (! name.isEmpty()) {
-                imageName = name;
-                break;
-            }
-        }
-    }
-    auto imgInfo = dApp->databaseM->getImageInfoByName(imageName);
-    if (! imageName.isEmpty() &&  ! imgInfo.thumbnail.save( &inBuffer, "JPG" )){
-        QPixmap p = utils::image::getThumbnail(imgInfo.path);
-        if (! p.save(&inBuffer, "JPG")) {
-            qWarning() << "Can't get thumbnail for album: " << info.name;
-        }
-    }
-
     QVariantList datas;
     datas.append(QVariant(info.name));
     datas.append(QVariant(info.count));
     datas.append(QVariant(info.beginTime));
     datas.append(QVariant(info.endTime));
-    datas.append(QVariant(thumbnailByteArray));
+    // The cover is filled once its thumbnail is ready
+    datas.append(QVariant(QByteArray()));
 
     removeCreateIcon();
 
@@ -114,6 +94,11 @@ QModelIndex AlbumsView::addAlbum(const DatabaseManager::AlbumInfo &info)
     // Already exist, update the data
     if (ti != -1) {
         index = m_model->index(ti, 0);
+        // Keep the old cover until the new one is ready
+        const QVariantList old = index.data(Qt::DisplayRole).toList();
+        if (old.length() == datas.length()) {
+            datas.last() = old.last();
+        }
     }
     // Not exist, create new item
     else {
@@ -128,6 +113,27 @@ QModelIndex AlbumsView::addAlbum(const DatabaseManager::AlbumInfo &info)
     m_model->setData(index, QVariant(datas), Qt::DisplayRole);
     m_model->setData(index, QVariant(m_itemSize), Qt::SizeHintRole);
     appendCreateIcon();
+
+    if (! info.cover.isEmpty()) {
+        const QPersistentModelIndex cover(index);
+        DatabaseManager::watch(ThumbnailService::instance()->thumbnail(info.cover),
+                               this, [=] (const QPixmap &p) {
+            QByteArray thumbnailByteArray;
+            QBuffer inBuffer( &thumbnailByteArray );
+            inBuffer.open( QIODevice::WriteOnly );
+            // write inPixmap into inByteArray
+            if (! p.save(&inBuffer, "JPG")) {
+                qWarning() << "Can't get thumbnail for album: " << info.name;
+                return;
+            }
+            QVariantList datas = cover.data(Qt::DisplayRole).toList();
+            if (cover.isValid() && datas.length() == 5) {
+                datas.last() = QVariant(thumbnailByteArray);
+                m_model->setData(cover, QVariant(datas), Qt::DisplayRole);
+            }
+        });
+    }
+
     return index;
 }
 
@@ -158,7 +164,7 @@ bool AlbumsView::eventFilter(QObject *obj, QEvent *e)
     }
     else if (e->type() == QEvent::Show) {
         // Aways has Favorites and RecentImport album
-        dApp->databaseM->insertImageIntoAlbum(MY_FAVORITES_ALBUM, "", "");
+        dApp->databaseM->insertImageIntoAlbum(MY_FAVORITES_ALBUM, "");
         updateView();
     }
 
@@ -399,7 +405,7 @@ void AlbumsView::appendCreateIcon()
 void AlbumsView::createAlbum()
 {
     const QString name = getNewAlbumName();
-    dApp->databaseM->insertImageIntoAlbum(name, "", "");
+    dApp->databaseM->insertImageIntoAlbum(name, "");
     QModelIndex index = addAlbum(dApp->databaseM->getAlbumInfo(name));
     openPersistentEditor(index);
     scrollTo(index);
@@ -412,13 +418,17 @@ void AlbumsView::updateView()
         return;
 
     // Make those special album always show at front
-//    addAlbum(dApp->databaseM->getAlbumInfo(RECENT_IMPORTED_ALBUM));
-    addAlbum(dApp->databaseM->getAlbumInfo(MY_FAVORITES_ALBUM));
-    QStringList albums = dApp->databaseM->getAlbumNameList();
-    albums.removeAll(MY_FAVORITES_ALBUM);
-    albums.removeAll(RECENT_IMPORTED_ALBUM);
-    for (const QString name : albums) {
-        addAlbum(dApp->databaseM->getAlbumInfo(name));
+    const auto infos = dApp->databaseM->getAllAlbumInfos();
+    for (auto info : infos) {
+        if (info.name == MY_FAVORITES_ALBUM) {
+            addAlbum(info);
+        }
+    }
+    for (auto info : infos) {
+        if (info.name != MY_FAVORITES_ALBUM
+                && info.name != RECENT_IMPORTED_ALBUM) {
+            addAlbum(info);
+        }
     }
 }
 
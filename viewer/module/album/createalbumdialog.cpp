@@ -111,9 +111,9 @@ const QString CreateAlbumDialog::getNewAlbumName() const
 void CreateAlbumDialog::createAlbum(const QString &newName)
 {
     if (dApp->databaseM->getAlbumNameList().indexOf(newName) == -1) {
-        dApp->databaseM->insertImageIntoAlbum(newName, "", "");
+        dApp->databaseM->insertImageIntoAlbum(newName, "");
     }
     else {
-        dApp->databaseM->insertImageIntoAlbum(getNewAlbumName(), "", "");
+        dApp->databaseM->insertImageIntoAlbum(getNewAlbumName(), "");
     }
 }
@@ -19,6 +19,7 @@
 #include <QStackedWidget>
 #include <QJsonArray>
 #include <QJsonDocument>
+#include <QtConcurrent>
 #include <math.h>
 
 namespace {
@@ -27,8 +28,10 @@ const int TOP_TOOLBAR_HEIGHT = 40;
 const QString SHORTCUT_SPLIT_FLAG = "@-_-@";
 const QString MY_FAVORITES_ALBUM = "My favorites";
 const QString RECENT_IMPORTED_ALBUM = "Recent imported";
+const int PRELOAD_COUNT = 100;
+const int PAGE_COUNT = 500;
 
-DatabaseManager::ImageInfo genThumbnail(DatabaseManager::ImageInfo &info)
+DatabaseManager::ImageInfo genThumbnail(const DatabaseManager::ImageInfo &info)
 {
     using namespace utils::image;
     auto ni = info;
@@ -40,7 +43,8 @@ DatabaseManager::ImageInfo genThumbnail(DatabaseManager::ImageInfo &info)
 
 ImagesView::ImagesView(QWidget *parent)
     : QScrollArea(parent),
-      m_popupMenu(new PopupMenuManager(this))
+      m_popupMenu(new PopupMenuManager(this)),
+      m_pageWatcher(nullptr)
 {
     setFrameStyle(QFrame::NoFrame);
     setWidgetResizable(true);
@@ -59,33 +63,24 @@ void ImagesView::setAlbum(const QString &album)
     m_album = album;
 
     m_view->clearData();
-    auto infos = dApp->databaseM->getImageInfosByAlbum(album);
-    const int preloadCount = 100;
-    // Load up to 100 images at initialization to accelerate rendering
-    for (int i = 0; i < qMin(infos.length(), preloadCount); i ++) {
-        insertItem(infos[i], false);
+    // Stop loading the pages of the previous album
+    if (m_pageWatcher) {
+        m_pageWatcher->disconnect(this);
+        m_pageWatcher->cancel();
+        m_pageWatcher->deleteLater();
+        m_pageWatcher = nullptr;
     }
 
-    // The thumbnail is generated in the new thread
-    QList<QFuture<DatabaseManager::ImageInfo>> fl;
-    if (infos.length() >= preloadCount) {
-        for (int i = preloadCount; i < infos.length(); i ++) {
-            fl << QtConcurrent::run(QThreadPool::globalInstance(), genThumbnail, infos[i]);
-        }
-    }
-    if (fl.length() > 0) {
-        QTimer *t = new QTimer(this);
-        connect(t, &QTimer::timeout, this, [=] {
-            if (fl.last().isFinished()) {
-                for (auto f : fl) {
-                    insertItem(f.result(), false);
-                }
-                t->deleteLater();
-            }
-        });
-        t->start(500);
+    // Load up to 100 images at initialization to accelerate rendering
+    m_cursor = DatabaseManager::ImageCursor();
+    const auto infos =
+            dApp->databaseM->getImageInfosByPage(m_cursor, PRELOAD_COUNT, album);
+    for (auto info : infos) {
+        insertItem(info, false);
     }
 
+    insertNextPage();
+
     m_topTips->setAlbum(album);
 
     // Empty album, import first
@@ -93,6 +88,31 @@ void ImagesView::setAlbum(const QString &album)
 
 }
 
+/*!
+ * \brief ImagesView::insertNextPage
+ * Read the next page of current album and generate its thumbnails in the
+ * new thread, go on with the following page after they are inserted.
+ */
+void ImagesView::insertNextPage()
+{
+    if (m_cursor.atEnd) {
+        return;
+    }
+
+    const auto infos =
+            dApp->databaseM->getImageInfosByPage(m_cursor, PAGE_COUNT, m_album);
+    m_pageWatcher = new QFutureWatcher<DatabaseManager::ImageInfo>(this);
+    connect(m_pageWatcher, &QFutureWatcherBase::finished, this, [=] {
+        for (auto info : m_pageWatcher->future().results()) {
+            insertItem(info, false);
+        }
+        m_pageWatcher->deleteLater();
+        m_pageWatcher = nullptr;
+        insertNextPage();
+    });
+    m_pageWatcher->setFuture(QtConcurrent::mapped(infos, genThumbnail));
+}
+
 bool ImagesView::removeItem(const QString &name)
 {
     const bool state = m_view->removeItem(name);
@@ -266,7 +286,8 @@ void ImagesView::insertItem(const DatabaseManager::ImageInfo &info, bool update)
     vi.name = info.name;
     vi.path = info.path;
     if (info.thumbnail.isNull())
-        vi.thumb = cutSquareImage(getThumbnail(info.path, true));
+        vi.thumb = getSquareThumbnail(info.id, info.path, info.modified,
+                                      true);
     else
         vi.thumb = info.thumbnail;
 
@@ -309,11 +330,7 @@ void ImagesView::onMenuItemClicked(int menuId, const QString &text)
     case IdAddToAlbum:
     {
         const QString album = text.split(SHORTCUT_SPLIT_FLAG).first();
-        for (QString name : nList) {
-            const auto info = dApp->databaseM->getImageInfoByName(name);
-            dApp->databaseM->insertImageIntoAlbum(
-                        album, name, utils::base::timeToString(info.time));
-        }
+        dApp->databaseM->insertImagesIntoAlbum(album, nList);
         break;
     }
     case IdExport:
@@ -327,11 +344,7 @@ void ImagesView::onMenuItemClicked(int menuId, const QString &text)
         break;
     }
     case IdAddToFavorites: {
-        foreach (QString cname, nList) {
-            const auto info = dApp->databaseM->getImageInfoByName(cname);
-            dApp->databaseM->insertImageIntoAlbum(
-                MY_FAVORITES_ALBUM, cname, utils::base::timeToString(info.time));
-        }
+        dApp->databaseM->insertImagesIntoAlbum(MY_FAVORITES_ALBUM, nList);
         updateMenuContents();
         break;
     }
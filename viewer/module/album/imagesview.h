@@ -10,6 +10,7 @@
 #include <QVBoxLayout>
 #include <QKeyEvent>
 #include <QObject>
+#include <QFutureWatcher>
 
 class ImportFrame;
 class PopupMenuManager;
@@ -72,6 +73,7 @@ private:
     void initListView();
     void initContent();
     void initTopTips();
+    void insertNextPage();
 
     void onMenuItemClicked(int menuId, const QString &text);
     void rotateImage(const QString &path, int degree);
@@ -99,6 +101,8 @@ private:
     PopupMenuManager *m_popupMenu;
     QWidget *m_contentWidget;
     ImportFrame *m_importFrame;
+    QFutureWatcher<DatabaseManager::ImageInfo> *m_pageWatcher;
+    DatabaseManager::ImageCursor m_cursor;
 };
 
 #endif // IMAGESVIEW_H
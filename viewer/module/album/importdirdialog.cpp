@@ -64,7 +64,7 @@ ImportDirDialog::ImportDirDialog(QWidget *parent)
             const QString album = m_edit->text().trimmed();
             dApp->importer->importDir(m_dir, album);
             // For UI update
-            dApp->databaseM->insertImageIntoAlbum(album, "", "");
+            dApp->databaseM->insertImageIntoAlbum(album, "");
             emit albumCreated();
         }
     });
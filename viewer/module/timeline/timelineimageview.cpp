@@ -13,16 +13,19 @@
 #include <QScrollBar>
 #include <QMouseEvent>
 #include <QDebug>
+#include <QtConcurrent>
 
 namespace {
 
 const int TOP_TOOLBAR_HEIGHT = 40;
 
 const int MIN_ICON_SIZE = 96;
+const int PRELOAD_COUNT = 100;
+const int PAGE_COUNT = 500;
 const QString SETTINGS_GROUP = "TIMEPANEL";
 const QString SETTINGS_ICON_SCALE_KEY = "IconScale";
 
-DatabaseManager::ImageInfo genThumbnail(DatabaseManager::ImageInfo &info)
+DatabaseManager::ImageInfo genThumbnail(const DatabaseManager::ImageInfo &info)
 {
     using namespace utils::image;
     auto ni = info;
@@ -225,33 +228,15 @@ void TimelineImageView::insertReadyFrames()
         return;
     }
 
-    const auto infos = dApp->databaseM->getAllImageInfos();
-    const int preloadCount = 100;
     // Load up to 100 images at initialization to accelerate rendering
-    for (int i = 0; i < qMin(infos.length(), preloadCount); i ++) {
-        onImageInserted(infos[i]);
+    m_cursor = DatabaseManager::ImageCursor();
+    const auto infos =
+            dApp->databaseM->getImageInfosByPage(m_cursor, PRELOAD_COUNT);
+    for (auto info : infos) {
+        onImageInserted(info);
     }
 
-    // The thumbnail is generated in the new thread
-    QList<QFuture<DatabaseManager::ImageInfo>> fl;
-    if (infos.length() >= preloadCount) {
-        for (int i = preloadCount; i < infos.length(); i ++) {
-            fl << QtConcurrent::run(QThreadPool::globalInstance(),
-                                    genThumbnail, infos[i]);
-        }
-    }
-    if (fl.length() > 0) {
-        QTimer *t = new QTimer(this);
-        connect(t, &QTimer::timeout, this, [=] {
-            if (fl.last().isFinished()) {
-                for (auto f : fl) {
-                    onImageInserted(f.result());
-                }
-                t->deleteLater();
-            }
-        });
-        t->start(500);
-    }
+    insertNextPage();
 
     const int iconSize = dApp->setter->value(
                 SETTINGS_GROUP,
@@ -260,6 +245,30 @@ void TimelineImageView::insertReadyFrames()
     setIconSize(QSize(iconSize, iconSize));
 }
 
+/*!
+ * \brief TimelineImageView::insertNextPage
+ * Read the next page and generate its thumbnails in the new thread, go on
+ * with the following page after they are inserted.
+ */
+void TimelineImageView::insertNextPage()
+{
+    if (m_cursor.atEnd) {
+        return;
+    }
+
+    const auto infos =
+            dApp->databaseM->getImageInfosByPage(m_cursor, PAGE_COUNT);
+    auto watcher = new QFutureWatcher<DatabaseManager::ImageInfo>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [=] {
+        for (auto info : watcher->future().results()) {
+            onImageInserted(info);
+        }
+        watcher->deleteLater();
+        insertNextPage();
+    });
+    watcher->setFuture(QtConcurrent::mapped(infos, genThumbnail));
+}
+
 bool TimelineImageView::eventFilter(QObject *obj, QEvent *e)
 {
     Q_UNUSED(obj)
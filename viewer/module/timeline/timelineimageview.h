@@ -43,6 +43,7 @@ private:
     void initTopTips();
     void initContents();
 
+    void insertNextPage();
     void inserFrame(const QString &timeline);
     void removeFrame(const QString &timeline);
     void removeImages(const QStringList &names);
@@ -65,6 +66,7 @@ private:
     bool m_ascending;
     bool m_multiSelection;
     QSize m_iconSize;
+    DatabaseManager::ImageCursor m_cursor;
 };
 
 #endif // TIMELINEIMAGEVIEW_H
@@ -18,6 +18,7 @@
 #include <QLabel>
 #include <QDebug>
 #include <QUrl>
+#include <QtConcurrent>
 
 namespace {
 
@@ -222,21 +223,21 @@ void TimelinePanel::showPanelEvent(ModulePanel *p)
 
 void TimelinePanel::initConnection()
 {
-    connect(dApp->importer, &Importer::importProgressChanged,
-            this, [=] (double v) {
-        if (v == 1) {
-            auto infos = dApp->databaseM->getAllImageInfos();
+    connect(dApp->signalM, &SignalManager::imagesInserted,
+            this, [=] (const QList<DatabaseManager::ImageInfo> &infos) {
+        // Show the batches of a running import at once, the view never
+        // shown is filled by pages once it is shown
+        if (m_view->isVisible() || ! m_view->isEmpty()) {
             for (auto info : infos) {
                 m_view->onImageInserted(info);
             }
-            onImageCountChanged(dApp->databaseM->imageCount());
         }
-    });
-    connect(dApp->signalM, &SignalManager::imagesInserted, this, [=] {
-        onImageCountChanged(dApp->databaseM->imageCount());
+        DatabaseManager::watch(dApp->databaseM->imageCountAsync(), this,
+                               [=] (int count) { onImageCountChanged(count); });
     });
     connect(dApp->signalM, &SignalManager::imagesRemoved, this, [=] {
-        onImageCountChanged(dApp->databaseM->imageCount());
+        DatabaseManager::watch(dApp->databaseM->imageCountAsync(), this,
+                               [=] (int count) { onImageCountChanged(count); });
     });
     connect(dApp->signalM, &SignalManager::gotoTimelinePanel, this, [=] {
         m_view->clearSelection();
@@ -375,10 +376,7 @@ void TimelinePanel::onMenuItemClicked(int menuId, const QString &text)
         break;
     case IdAddToAlbum: {
         const QString album = text.split(SHORTCUT_SPLIT_FLAG).first();
-        for (QString name : nList) {
-            dApp->databaseM->insertImageIntoAlbum(
-                album, name, utils::base::timeToString(imageInfo(name).time));
-        }
+        dApp->databaseM->insertImagesIntoAlbum(album, nList);
         break;
     }
     case IdExport:
@@ -392,10 +390,7 @@ void TimelinePanel::onMenuItemClicked(int menuId, const QString &text)
         break;
     }
     case IdAddToFavorites:
-        for(QString name : nList) {
-        dApp->databaseM->insertImageIntoAlbum(FAVORITES_ALBUM_NAME, name,
-            utils::base::timeToString(imageInfo(cname).time));
-        }
+        dApp->databaseM->insertImagesIntoAlbum(FAVORITES_ALBUM_NAME, nList);
         updateMenuContents();
         break;
     case IdRemoveFromFavorites:
@@ -127,7 +127,8 @@ void TimelineViewFrame::insertItem(const DatabaseManager::ImageInfo &info)
     vi.name = info.name;
     vi.path = info.path;
     if (info.thumbnail.isNull())
-        vi.thumb = cutSquareImage(getThumbnail(info.path, true));
+        vi.thumb = getSquareThumbnail(info.id, info.path, info.modified,
+                                      true);
     else
         vi.thumb = info.thumbnail;
 
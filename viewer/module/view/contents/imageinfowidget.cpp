@@ -1,5 +1,7 @@
 #include "imageinfowidget.h"
 #include "application.h"
+#include "controller/databasemanager.h"
+#include "controller/metadataservice.h"
 #include "controller/signalmanager.h"
 #include "utils/imageutils.h"
 #include <QApplication>
@@ -200,14 +202,19 @@ const QString ImageInfoWidget::trLabel(const char *str)
 
 void ImageInfoWidget::updateInfo()
 {
-    using namespace utils::image;
-    using namespace utils::base;
-    auto mds = getAllMetaData(m_path);
-    // Minus layout margins
-    m_maxFieldWidth = width() - m_maxTitleWidth - (10 + 8) * 2;
+    const QString path = m_path;
+    DatabaseManager::watch(MetadataService::instance()->metadata(path), this,
+                           [=] (const QMap<QString, QString> &mds) {
+        // Another image is shown already
+        if (path != m_path) {
+            return;
+        }
+        // Minus layout margins
+        m_maxFieldWidth = width() - m_maxTitleWidth - (10 + 8) * 2;
 
-    updateBaseInfo(mds);
-    updateDetailsInfo(mds);
+        updateBaseInfo(mds);
+        updateDetailsInfo(mds);
+    });
 }
 
 void ImageInfoWidget::updateBaseInfo(const QMap<QString, QString> &infos)
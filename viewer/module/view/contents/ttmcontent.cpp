@@ -56,9 +56,8 @@ TTMContent::TTMContent(bool fromFileManager, QWidget *parent)
                 dApp->databaseM->removeImageFromAlbum(FAVORITES_ALBUM,m_imageName);
             }
             else {
-                auto info = dApp->databaseM->getImageInfoByName(m_imageName);
                 dApp->databaseM->insertImageIntoAlbum(FAVORITES_ALBUM,
-                    m_imageName, utils::base::timeToString(info.time));
+                                                      m_imageName);
             }
             updateCollectButton();
         });
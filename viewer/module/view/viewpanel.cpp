@@ -22,6 +22,7 @@
 #include <QProcess>
 #include <QResizeEvent>
 #include <QStackedWidget>
+#include <QTimer>
 #include <QtConcurrent>
 
 using namespace Dtk::Widget;
@@ -30,6 +31,8 @@ namespace {
 
 const int TOP_TOOLBAR_HEIGHT = 40;
 const int OPEN_IMAGE_DELAY_INTERVAL = 500;
+const int RELOAD_DELAY = 500;  // ms of quiet before reloading
+const int MAX_RELOAD_DELAY = 3000;  // ms, even if the changes keep coming
 
 }  // namespace
 
@@ -104,7 +107,19 @@ void ViewPanel::initFileSystemWatcher()
             sw->addPath(QFileInfo(info.path).dir().absolutePath());
         }
     });
+    // Reload once a burst of changes(eg: copying files) calms down, but not
+    // forever during a long one
+    QTimer *reloadTimer = new QTimer(this);
+    reloadTimer->setSingleShot(true);
     connect(sw, &QFileSystemWatcher::directoryChanged, this, [=] {
+        if (! m_reloadPending.isValid()) {
+            m_reloadPending.start();
+        }
+        const qint64 left = MAX_RELOAD_DELAY - m_reloadPending.elapsed();
+        reloadTimer->start(int(qBound(qint64(0), left, qint64(RELOAD_DELAY))));
+    });
+    connect(reloadTimer, &QTimer::timeout, this, [=] {
+        m_reloadPending.invalidate();
         if (m_current == m_infos.cend() || m_infos.isEmpty())
             return;
         const QString cp = m_current->path;
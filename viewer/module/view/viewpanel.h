@@ -5,6 +5,7 @@
 #include "controller/databasemanager.h"
 #include "anchors.h"
 
+#include <QElapsedTimer>
 #include <QFileInfo>
 #include <QJsonObject>
 
@@ -104,5 +105,6 @@ private:
     SignalManager::ViewInfo m_vinfo;
     QList<DatabaseManager::ImageInfo> m_infos;
     QList<DatabaseManager::ImageInfo>::ConstIterator m_current;
+    QElapsedTimer m_reloadPending;  // Since the first change not reloaded
 };
 #endif // VIEWPANEL_H
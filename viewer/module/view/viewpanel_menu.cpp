@@ -193,7 +193,6 @@ void ViewPanel::onMenuItemClicked(int menuId, const QString &text)
     const QStringList mtl = text.split(SHORTCUT_SPLIT_FLAG);
     const QString name = m_current->name;
     const QString path = m_current->path;
-    const QString time = timeToString(getCreateDateTime(path));
     QString albumName = mtl.isEmpty() ? "" : mtl.first();
 
     switch (MenuItemId(menuId)) {
@@ -204,7 +203,7 @@ void ViewPanel::onMenuItemClicked(int menuId, const QString &text)
         emit dApp->signalM->startSlideShow(this, paths(), path);
         break;
     case IdAddToAlbum:
-        dApp->databaseM->insertImageIntoAlbum(albumName, name, time);
+        dApp->databaseM->insertImageIntoAlbum(albumName, name);
         break;
     case IdExport:
         dApp->exporter->exportImage(QStringList() << path);
@@ -223,7 +222,7 @@ void ViewPanel::onMenuItemClicked(int menuId, const QString &text)
         dApp->signalM->editImage(path);
         break;
     case IdAddToFavorites:
-        dApp->databaseM->insertImageIntoAlbum(FAVORITES_ALBUM_NAME, name, time);
+        dApp->databaseM->insertImageIntoAlbum(FAVORITES_ALBUM_NAME, name);
         emit updateCollectButton();
         break;
     case IdRemoveFromFavorites:
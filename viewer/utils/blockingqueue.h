@@ -0,0 +1,108 @@
+#ifndef BLOCKINGQUEUE_H
+#define BLOCKINGQUEUE_H
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QQueue>
+#include <QWaitCondition>
+
+namespace utils {
+
+/*!
+ * \brief The BlockingQueue class
+ * A bounded queue between the stages of a pipeline. The producer blocks
+ * while it is full and the consumer blocks while it is empty, so a fast
+ * stage can't run away from a slow one.
+ * close() ends the input, consumers drain what is left and then stop.
+ * abort() stops everyone at once and drops what is left.
+ */
+template <typename T>
+class BlockingQueue
+{
+public:
+    explicit BlockingQueue(int capacity)
+        : m_capacity(qMax(1, capacity)),
+          m_closed(false),
+          m_aborted(false)
+    {
+    }
+
+    // Return false if the queue is closed or aborted, item is dropped
+    bool push(const T &item)
+    {
+        QMutexLocker locker(&m_mutex);
+        while (m_queue.length() >= m_capacity && ! m_closed && ! m_aborted) {
+            m_notFull.wait(&m_mutex);
+        }
+        if (m_closed || m_aborted) {
+            return false;
+        }
+
+        m_queue.enqueue(item);
+        m_notEmpty.wakeOne();
+        return true;
+    }
+
+    // Return false if nothing is popped in timeout ms(-1 for forever),
+    // or the queue is drained after closed, or aborted
+    bool pop(T &item, int timeout = -1)
+    {
+        QMutexLocker locker(&m_mutex);
+        QElapsedTimer timer;
+        timer.start();
+        while (m_queue.isEmpty() && ! m_closed && ! m_aborted) {
+            if (timeout < 0) {
+                m_notEmpty.wait(&m_mutex);
+            }
+            else if (timer.elapsed() >= timeout
+                     || ! m_notEmpty.wait(&m_mutex, timeout - timer.elapsed())) {
+                return false;
+            }
+        }
+        if (m_queue.isEmpty() || m_aborted) {
+            return false;
+        }
+
+        item = m_queue.dequeue();
+        m_notFull.wakeOne();
+        return true;
+    }
+
+    void close()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_closed = true;
+        m_notEmpty.wakeAll();
+        m_notFull.wakeAll();
+    }
+
+    void abort()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_aborted = true;
+        m_queue.clear();
+        m_notEmpty.wakeAll();
+        m_notFull.wakeAll();
+    }
+
+    // Nothing more will be popped
+    bool isFinished() const
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_aborted || (m_closed && m_queue.isEmpty());
+    }
+
+private:
+    mutable QMutex m_mutex;
+    QWaitCondition m_notEmpty;
+    QWaitCondition m_notFull;
+    QQueue<T> m_queue;
+    const int m_capacity;
+    bool m_closed;
+    bool m_aborted;
+};
+
+}  // namespace utils
+
+#endif // BLOCKINGQUEUE_H
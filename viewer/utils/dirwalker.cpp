@@ -0,0 +1,177 @@
+#include "dirwalker.h"
+#include <QDir>
+#include <QFile>
+#include <QMutexLocker>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+namespace utils {
+
+DirWalker::DirWalker(int threads)
+    : m_threads(qMax(1, threads)),
+      m_maxDepth(-1),
+      m_followSymlinks(false),
+      m_stopped(0),
+      m_pending(0),
+      m_idle(0)
+{
+}
+
+void DirWalker::setMaxDepth(int depth)
+{
+    m_maxDepth = depth;
+}
+
+void DirWalker::setFollowSymlinks(bool follow)
+{
+    m_followSymlinks = follow;
+}
+
+bool DirWalker::walk(const QString &root, const FileCallback &callback)
+{
+    m_callback = callback;
+    m_stopped.store(0);
+    m_queue.clear();
+    m_queue.enqueue(Dir{QFile::encodeName(QDir::cleanPath(root)), 0});
+    m_pending = 1;
+    m_idle = 0;
+    m_visited.clear();
+    m_failedDirs.clear();
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(m_threads);
+    for (int i = 0; i < m_threads; i ++) {
+        QtConcurrent::run(&pool, [this] { work(); });
+    }
+    pool.waitForDone();
+
+    m_callback = FileCallback();
+    return ! m_stopped.load();
+}
+
+QStringList DirWalker::failedDirs() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_failedDirs;
+}
+
+void DirWalker::work()
+{
+    // Depth first, nobody else takes from it
+    QVector<Dir> stack;
+    forever {
+        if (m_stopped.load()) {
+            return;
+        }
+        if (stack.isEmpty()) {
+            QMutexLocker locker(&m_mutex);
+            m_idle ++;
+            while (m_queue.isEmpty() && m_pending > 0 && ! m_stopped.load()) {
+                m_queued.wait(&m_mutex);
+            }
+            m_idle --;
+            if (m_queue.isEmpty() || m_stopped.load()) {
+                m_queued.wakeAll();
+                return;
+            }
+            stack << m_queue.dequeue();
+        }
+
+        const Dir dir = stack.takeLast();
+        QVector<Dir> subdirs;
+        readDir(dir, subdirs);
+
+        QMutexLocker locker(&m_mutex);
+        m_pending += subdirs.length() - 1;
+        if (m_pending == 0 || m_stopped.load()) {
+            m_queued.wakeAll();
+            continue;
+        }
+        // The shallow ones are likely the large subtrees, share them
+        int shared = 0;
+        while (shared < m_idle && ! subdirs.isEmpty()) {
+            m_queue.enqueue(subdirs.takeFirst());
+            shared ++;
+        }
+        while (shared < m_idle && ! stack.isEmpty()) {
+            m_queue.enqueue(stack.takeFirst());
+            shared ++;
+        }
+        if (shared > 0) {
+            m_queued.wakeAll();
+        }
+        for (int i = subdirs.length() - 1; i >= 0; i --) {
+            stack << subdirs.at(i);
+        }
+    }
+}
+
+void DirWalker::readDir(const Dir &dir, QVector<Dir> &subdirs)
+{
+    DIR *d = opendir(dir.path.constData());
+    if (! d) {
+        QMutexLocker locker(&m_mutex);
+        m_failedDirs << QFile::decodeName(dir.path);
+        return;
+    }
+
+    struct stat st;
+    if (m_followSymlinks
+            && (fstat(dirfd(d), &st) != 0 || ! visit(st.st_dev, st.st_ino))) {
+        closedir(d);
+        return;
+    }
+
+    const QByteArray prefix = dir.path.endsWith('/') ? dir.path : dir.path + '/';
+    while (const dirent *entry = readdir(d)) {
+        if (m_stopped.load()) {
+            break;
+        }
+        // ".", ".." and the hidden ones
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+
+        unsigned char type = entry->d_type;
+        if (type == DT_UNKNOWN || (type == DT_LNK && m_followSymlinks)) {
+            const int flags = type == DT_LNK ? 0 : AT_SYMLINK_NOFOLLOW;
+            if (fstatat(dirfd(d), entry->d_name, &st, flags) != 0) {
+                continue;
+            }
+            type = S_ISDIR(st.st_mode) ? DT_DIR
+                                       : (S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN);
+        }
+
+        if (type == DT_DIR) {
+            if (m_maxDepth < 0 || dir.depth < m_maxDepth) {
+                subdirs << Dir{prefix + entry->d_name, dir.depth + 1};
+            }
+        }
+        else if (type == DT_REG) {
+            if (! m_callback(QFile::decodeName(prefix + entry->d_name))) {
+                m_stopped.store(1);
+                break;
+            }
+        }
+    }
+
+    closedir(d);
+}
+
+// Return false if the directory is visited already
+bool DirWalker::visit(dev_t device, ino_t inode)
+{
+    QMutexLocker locker(&m_mutex);
+    const QPair<quint64, quint64> key(device, inode);
+    if (m_visited.contains(key)) {
+        return false;
+    }
+
+    m_visited.insert(key);
+    return true;
+}
+
+}  // namespace utils
@@ -0,0 +1,77 @@
+#ifndef DIRWALKER_H
+#define DIRWALKER_H
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QMutex>
+#include <QPair>
+#include <QQueue>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QWaitCondition>
+#include <functional>
+#include <sys/types.h>
+
+namespace utils {
+
+/*!
+ * \brief The DirWalker class
+ * Walk a directory tree by several threads, for the huge trees and the
+ * network mounts where every call waits for a round trip.
+ * The type of entries comes from readdir(d_type), so a file isn't stat'ed
+ * unless the file system doesn't fill it. Every thread walks depth first on
+ * its own, and shares the shallowest directories it found with the idle
+ * threads. Hidden entries are skipped.
+ * The directories which can't be read(eg: permission denied, a network
+ * mount hiccups) are skipped too, and reported by failedDirs().
+ * A walker runs one walk at a time.
+ */
+class DirWalker
+{
+public:
+    // Called in the walker threads, return false to stop the walk
+    typedef std::function<bool(const QString &path)> FileCallback;
+
+    explicit DirWalker(int threads = 8);
+
+    // -1 for unlimited, 0 walks the files of root only
+    void setMaxDepth(int depth);
+    // The visited directories are remembered to break the loops
+    void setFollowSymlinks(bool follow);
+
+    // Return false if it is stopped by the callback
+    bool walk(const QString &root, const FileCallback &callback);
+    // The directories the last walk failed to open, their subtrees are unknown
+    QStringList failedDirs() const;
+
+private:
+    struct Dir {
+        QByteArray path;
+        int depth;
+    };
+
+    void work();
+    void readDir(const Dir &dir, QVector<Dir> &subdirs);
+    bool visit(dev_t device, ino_t inode);
+
+private:
+    const int m_threads;
+    int m_maxDepth;
+    bool m_followSymlinks;
+
+    FileCallback m_callback;
+    QAtomicInt m_stopped;
+    mutable QMutex m_mutex;
+    QWaitCondition m_queued;
+    QQueue<Dir> m_queue;  // Shared with the idle threads
+    int m_pending;  // Directories found and not walked yet
+    int m_idle;
+    QSet<QPair<quint64, quint64>> m_visited;  // <device, inode>
+    QStringList m_failedDirs;
+};
+
+}  // namespace utils
+
+#endif // DIRWALKER_H
@@ -0,0 +1,579 @@
+#include "exifparser.h"
+#include "baseutils.h"
+#include <QByteArray>
+#include <QCache>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QVector>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace utils {
+
+namespace image {
+
+namespace {
+
+const int MAX_IFD_ENTRIES = 1000;
+const int MAX_STRING_LENGTH = 256;
+const int CACHE_SIZE = 2000;  // Paths
+
+enum Tag {
+    TagSubfileType = 0x00FE,
+    TagImageWidth = 0x0100,
+    TagImageLength = 0x0101,
+    TagMake = 0x010F,
+    TagModel = 0x0110,
+    TagOrientation = 0x0112,
+    TagDateTime = 0x0132,
+    TagThumbnailOffset = 0x0201,
+    TagThumbnailLength = 0x0202,
+    TagExifIfd = 0x8769,
+    TagGpsIfd = 0x8825,
+    TagDateTimeOriginal = 0x9003,
+    TagDateTimeDigitized = 0x9004,
+    TagPixelXDimension = 0xA002,
+    TagPixelYDimension = 0xA003,
+    TagLensModel = 0xA434
+};
+
+enum GpsTag {
+    TagLatitudeRef = 1,
+    TagLatitude = 2,
+    TagLongitudeRef = 3,
+    TagLongitude = 4,
+    TagAltitudeRef = 5,
+    TagAltitude = 6
+};
+
+enum Type {
+    TypeByte = 1,
+    TypeAscii = 2,
+    TypeShort = 3,
+    TypeLong = 4,
+    TypeRational = 5,
+    TypeUndefined = 7,
+    TypeSLong = 9,
+    TypeSRational = 10
+};
+
+int typeSize(int type)
+{
+    switch (type) {
+    case TypeByte:
+    case TypeAscii:
+    case TypeUndefined:
+        return 1;
+    case TypeShort:
+        return 2;
+    case TypeLong:
+    case TypeSLong:
+        return 4;
+    case TypeRational:
+    case TypeSRational:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+struct Entry {
+    quint16 tag;
+    quint16 type;
+    quint32 count;
+    char value[4];  // The value itself if it fits, or the offset of it
+};
+
+/*!
+ * \brief The TiffParser class
+ * Walk the IFDs of a TIFF structure, which is the whole file of TIFF, or the
+ * APP1 segment of JPEG. Offsets in it are relative to its header.
+ */
+class TiffParser
+{
+public:
+    // The structure in file, at base
+    TiffParser(int fd, qint64 base, qint64 size);
+    // The structure read already, which was at base of file
+    TiffParser(const QByteArray &data, qint64 base);
+
+    bool parse(ExifInfo &info);
+
+private:
+    bool read(qint64 offset, qint64 length, char *out) const;
+    quint16 u16(const char *p) const;
+    quint32 u32(const char *p) const;
+    // Return the offset of the next IFD, 0 if there isn't
+    quint32 readIfd(quint32 offset, QVector<Entry> &entries) const;
+    QByteArray valueData(const Entry &entry, int maxLength) const;
+    quint32 uintValue(const Entry &entry) const;
+    double rationalValue(const Entry &entry, int index) const;
+    QString stringValue(const Entry &entry) const;
+
+private:
+    const int m_fd;
+    const qint64 m_base;
+    const qint64 m_size;
+    const QByteArray m_data;
+    bool m_bigEndian;
+};
+
+TiffParser::TiffParser(int fd, qint64 base, qint64 size)
+    : m_fd(fd),
+      m_base(base),
+      m_size(size),
+      m_bigEndian(false)
+{
+}
+
+TiffParser::TiffParser(const QByteArray &data, qint64 base)
+    : m_fd(-1),
+      m_base(base),
+      m_size(data.length()),
+      m_data(data),
+      m_bigEndian(false)
+{
+}
+
+bool TiffParser::parse(ExifInfo &info)
+{
+    char header[8];
+    if (! read(0, 8, header)) {
+        return false;
+    }
+    if (header[0] == 'I' && header[1] == 'I') {
+        m_bigEndian = false;
+    }
+    else if (header[0] == 'M' && header[1] == 'M') {
+        m_bigEndian = true;
+    }
+    else {
+        return false;
+    }
+    // 42 of TIFF, Olympus ORF and Panasonic RW2 have their own
+    const quint16 magic = u16(header + 2);
+    if (magic != 42 && magic != 0x4F52 && magic != 0x5352 && magic != 0x55) {
+        return false;
+    }
+
+    QVector<Entry> entries;
+    const quint32 ifd1 = readIfd(u32(header + 4), entries);
+    QString make, model, dateTime;
+    bool reduced = false;
+    quint32 exifIfd = 0;
+    quint32 gpsIfd = 0;
+    for (const Entry &entry : entries) {
+        switch (entry.tag) {
+        case TagSubfileType:
+            reduced = uintValue(entry) & 1;
+            break;
+        case TagImageWidth:
+            info.size.setWidth(uintValue(entry));
+            break;
+        case TagImageLength:
+            info.size.setHeight(uintValue(entry));
+            break;
+        case TagMake:
+            make = stringValue(entry);
+            break;
+        case TagModel:
+            model = stringValue(entry);
+            break;
+        case TagOrientation: {
+            const quint32 orientation = uintValue(entry);
+            info.orientation = orientation >= 1 && orientation <= 8 ? orientation : 1;
+            break;
+        }
+        case TagDateTime:
+            dateTime = stringValue(entry);
+            break;
+        case TagExifIfd:
+            exifIfd = uintValue(entry);
+            break;
+        case TagGpsIfd:
+            gpsIfd = uintValue(entry);
+            break;
+        default:
+            break;
+        }
+    }
+    // Most models start with the make, eg: Canon EOS 5D
+    info.camera = model.startsWith(make, Qt::CaseInsensitive)
+            ? model : QString(make + " " + model).trimmed();
+
+    QString original, digitized;
+    QSize pixelSize;
+    if (exifIfd != 0) {
+        entries.clear();
+        readIfd(exifIfd, entries);
+        for (const Entry &entry : entries) {
+            switch (entry.tag) {
+            case TagDateTimeOriginal:
+                original = stringValue(entry);
+                break;
+            case TagDateTimeDigitized:
+                digitized = stringValue(entry);
+                break;
+            case TagPixelXDimension:
+                pixelSize.setWidth(uintValue(entry));
+                break;
+            case TagPixelYDimension:
+                pixelSize.setHeight(uintValue(entry));
+                break;
+            case TagLensModel:
+                info.lens = stringValue(entry);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+    // The IFD0 of a TIFF describes the image itself, but it is a preview in
+    // most of camera raws
+    if (reduced || ! info.size.isValid() || info.size.isEmpty()) {
+        info.size = pixelSize;
+    }
+    for (const QString &time : {original, digitized, dateTime}) {
+        info.dateTimeOriginal = utils::base::stringToDateTime(time);
+        if (info.dateTimeOriginal.isValid()) {
+            break;
+        }
+    }
+
+    if (gpsIfd != 0) {
+        entries.clear();
+        readIfd(gpsIfd, entries);
+        QString latitudeRef, longitudeRef;
+        bool hasLatitude = false, hasLongitude = false, belowSeaLevel = false;
+        for (const Entry &entry : entries) {
+            switch (entry.tag) {
+            case TagLatitudeRef:
+                latitudeRef = stringValue(entry);
+                break;
+            case TagLatitude:
+                info.latitude = rationalValue(entry, 0)
+                        + rationalValue(entry, 1) / 60
+                        + rationalValue(entry, 2) / 3600;
+                hasLatitude = true;
+                break;
+            case TagLongitudeRef:
+                longitudeRef = stringValue(entry);
+                break;
+            case TagLongitude:
+                info.longitude = rationalValue(entry, 0)
+                        + rationalValue(entry, 1) / 60
+                        + rationalValue(entry, 2) / 3600;
+                hasLongitude = true;
+                break;
+            case TagAltitudeRef:
+                belowSeaLevel = uintValue(entry) == 1;
+                break;
+            case TagAltitude:
+                info.altitude = rationalValue(entry, 0);
+                break;
+            default:
+                break;
+            }
+        }
+        info.hasGps = hasLatitude && hasLongitude;
+        if (latitudeRef == "S") {
+            info.latitude = - info.latitude;
+        }
+        if (longitudeRef == "W") {
+            info.longitude = - info.longitude;
+        }
+        if (belowSeaLevel) {
+            info.altitude = - info.altitude;
+        }
+    }
+
+    // IFD1 is the thumbnail
+    if (ifd1 != 0) {
+        entries.clear();
+        readIfd(ifd1, entries);
+        quint32 offset = 0, length = 0;
+        for (const Entry &entry : entries) {
+            if (entry.tag == TagThumbnailOffset) {
+                offset = uintValue(entry);
+            }
+            else if (entry.tag == TagThumbnailLength) {
+                length = uintValue(entry);
+            }
+        }
+        if (offset != 0 && length != 0 && qint64(offset) + length <= m_size) {
+            info.thumbnailOffset = m_base + offset;
+            info.thumbnailLength = length;
+        }
+    }
+
+    info.valid = true;
+    return true;
+}
+
+bool TiffParser::read(qint64 offset, qint64 length, char *out) const
+{
+    if (offset < 0 || length < 0 || offset + length > m_size) {
+        return false;
+    }
+
+    if (m_fd == -1) {
+        memcpy(out, m_data.constData() + offset, length);
+        return true;
+    }
+    else {
+        return pread(m_fd, out, length, m_base + offset) == length;
+    }
+}
+
+quint16 TiffParser::u16(const char *p) const
+{
+    const uchar *b = reinterpret_cast<const uchar *>(p);
+    return m_bigEndian ? (b[0] << 8) | b[1] : (b[1] << 8) | b[0];
+}
+
+quint32 TiffParser::u32(const char *p) const
+{
+    const uchar *b = reinterpret_cast<const uchar *>(p);
+    return m_bigEndian
+            ? (quint32(b[0]) << 24) | (b[1] << 16) | (b[2] << 8) | b[3]
+            : (quint32(b[3]) << 24) | (b[2] << 16) | (b[1] << 8) | b[0];
+}
+
+quint32 TiffParser::readIfd(quint32 offset, QVector<Entry> &entries) const
+{
+    char countData[2];
+    if (offset == 0 || ! read(offset, 2, countData)) {
+        return 0;
+    }
+    const int count = u16(countData);
+    if (count > MAX_IFD_ENTRIES) {
+        return 0;
+    }
+
+    // The entries and the offset of next IFD are read at once
+    QByteArray data(count * 12 + 4, 0);
+    const bool hasNext = read(offset + 2, data.length(), data.data());
+    if (! hasNext && ! read(offset + 2, count * 12, data.data())) {
+        return 0;
+    }
+    for (int i = 0; i < count; i ++) {
+        const char *p = data.constData() + i * 12;
+        Entry entry;
+        entry.tag = u16(p);
+        entry.type = u16(p + 2);
+        entry.count = u32(p + 4);
+        memcpy(entry.value, p + 8, 4);
+        if (typeSize(entry.type) != 0) {
+            entries << entry;
+        }
+    }
+
+    const quint32 next = hasNext ? u32(data.constData() + count * 12) : 0;
+    // A broken file may point back to itself
+    return next == offset ? 0 : next;
+}
+
+QByteArray TiffParser::valueData(const Entry &entry, int maxLength) const
+{
+    const qint64 length = qMin(qint64(typeSize(entry.type)) * entry.count,
+                               qint64(maxLength));
+    if (qint64(typeSize(entry.type)) * entry.count <= 4) {
+        return QByteArray(entry.value, length);
+    }
+
+    QByteArray data(length, 0);
+    if (! read(u32(entry.value), length, data.data())) {
+        return QByteArray();
+    }
+    return data;
+}
+
+quint32 TiffParser::uintValue(const Entry &entry) const
+{
+    if (entry.count < 1) {
+        return 0;
+    }
+
+    switch (entry.type) {
+    case TypeByte:
+    case TypeUndefined:
+        return uchar(entry.value[0]);
+    case TypeShort:
+        return u16(entry.value);
+    case TypeLong:
+    case TypeSLong:
+        return u32(entry.value);
+    default:
+        return 0;
+    }
+}
+
+double TiffParser::rationalValue(const Entry &entry, int index) const
+{
+    if (entry.type != TypeRational && entry.type != TypeSRational) {
+        return 0;
+    }
+    if (quint32(index) >= entry.count) {
+        return 0;
+    }
+
+    const QByteArray data = valueData(entry, (index + 1) * 8);
+    if (data.length() < (index + 1) * 8) {
+        return 0;
+    }
+    const char *p = data.constData() + index * 8;
+    const quint32 denominator = u32(p + 4);
+    if (denominator == 0) {
+        return 0;
+    }
+    return entry.type == TypeRational
+            ? double(u32(p)) / denominator
+            : double(qint32(u32(p))) / qint32(denominator);
+}
+
+QString TiffParser::stringValue(const Entry &entry) const
+{
+    if (entry.type != TypeAscii && entry.type != TypeUndefined) {
+        return QString();
+    }
+
+    QByteArray data = valueData(entry, MAX_STRING_LENGTH);
+    const int end = data.indexOf('\0');
+    if (end != -1) {
+        data.truncate(end);
+    }
+    return QString::fromUtf8(data).trimmed();
+}
+
+// SOF0 to SOF15, except DHT, JPG and DAC
+bool isStartOfFrame(uchar marker)
+{
+    return marker >= 0xC0 && marker <= 0xCF
+            && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+}
+
+bool parseJpeg(int fd, ExifInfo &info)
+{
+    QSize frameSize;
+    bool exifFound = false;
+    qint64 pos = 2;  // After SOI
+    forever {
+        uchar marker[4];
+        if (pread(fd, marker, 4, pos) != 4 || marker[0] != 0xFF) {
+            break;
+        }
+        // Fill bytes
+        if (marker[1] == 0xFF) {
+            pos ++;
+            continue;
+        }
+        // SOS or EOI, the headers are over
+        if (marker[1] == 0xDA || marker[1] == 0xD9) {
+            break;
+        }
+        // TEM and RSTn have no length
+        if (marker[1] == 0x01 || (marker[1] >= 0xD0 && marker[1] <= 0xD7)) {
+            pos += 2;
+            continue;
+        }
+
+        const int length = (marker[2] << 8) | marker[3];
+        if (length < 2) {
+            break;
+        }
+        if (marker[1] == 0xE1 && ! exifFound && length > 8) {
+            QByteArray segment(length - 2, 0);
+            if (pread(fd, segment.data(), segment.length(), pos + 4) == segment.length()
+                    && segment.startsWith(QByteArray("Exif\0\0", 6))) {
+                exifFound = TiffParser(segment.mid(6), pos + 10).parse(info);
+            }
+        }
+        else if (isStartOfFrame(marker[1])) {
+            uchar frame[5];
+            if (pread(fd, frame, 5, pos + 4) == 5) {
+                frameSize = QSize((frame[3] << 8) | frame[4], (frame[1] << 8) | frame[2]);
+            }
+        }
+        pos += 2 + length;
+    }
+
+    // The frame header tells the real size, some editors don't update EXIF
+    if (frameSize.isValid() && ! frameSize.isEmpty()) {
+        info.size = frameSize;
+    }
+    return exifFound;
+}
+
+struct ExifResult {
+    ExifInfo info;
+    qint64 size;
+    qint64 modified;  // Nanoseconds since epoch
+};
+
+QMutex cacheMutex;
+QCache<QString, ExifResult> exifCache(CACHE_SIZE);
+
+ExifInfo parseFile(int fd, qint64 size)
+{
+    ExifInfo info;
+    uchar magic[2];
+    if (pread(fd, magic, 2, 0) != 2) {
+        return info;
+    }
+
+    if (magic[0] == 0xFF && magic[1] == 0xD8) {
+        parseJpeg(fd, info);
+    }
+    else {
+        TiffParser(fd, 0, size).parse(info);
+    }
+    return info;
+}
+
+}  // namespace
+
+ExifInfo readExif(const QString &path)
+{
+    const int fd = open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return ExifInfo();
+    }
+
+    struct stat st;
+    const ExifInfo info = fstat(fd, &st) == 0 ? parseFile(fd, st.st_size) : ExifInfo();
+    close(fd);
+    return info;
+}
+
+ExifInfo cachedExif(const QString &path)
+{
+    const QByteArray file = QFile::encodeName(path);
+    struct stat st;
+    if (stat(file.constData(), &st) != 0 || ! S_ISREG(st.st_mode)) {
+        return ExifInfo();
+    }
+    const qint64 modified = qint64(st.st_mtim.tv_sec) * 1000000000
+            + st.st_mtim.tv_nsec;
+
+    {
+        QMutexLocker locker(&cacheMutex);
+        const ExifResult *cached = exifCache.object(path);
+        if (cached && cached->size == st.st_size
+                && cached->modified == modified) {
+            return cached->info;
+        }
+    }
+
+    const ExifInfo info = readExif(path);
+    QMutexLocker locker(&cacheMutex);
+    exifCache.insert(path, new ExifResult{info, st.st_size, modified});
+
+    return info;
+}
+
+}  // namespace image
+
+}  // namespace utils
@@ -0,0 +1,51 @@
+#ifndef EXIFPARSER_H
+#define EXIFPARSER_H
+
+#include <QDateTime>
+#include <QSize>
+#include <QString>
+
+namespace utils {
+
+namespace image {
+
+struct ExifInfo {
+    bool valid = false;  // EXIF is found
+    QDateTime dateTimeOriginal;
+    int orientation = 1;  // 1 to 8, 1 is the normal one
+    QSize size;  // As stored, before the orientation applies
+    QString camera;  // Make and model
+    QString lens;
+    bool hasGps = false;
+    double latitude = 0;  // Degree, negative in the south
+    double longitude = 0;  // Degree, negative in the west
+    double altitude = 0;  // Meter, negative below the sea level
+    // The embedded JPEG thumbnail, in bytes from the start of file
+    qint64 thumbnailOffset = 0;
+    qint64 thumbnailLength = 0;
+};
+
+/*!
+ * \brief readExif
+ * Read the EXIF of JPEG and TIFF based(including most of camera raws)
+ * images in a single pass. Only the marker headers of JPEG, the APP1
+ * segment and the IFDs are read, nothing is decoded.
+ * \param path
+ * \return
+ */
+ExifInfo readExif(const QString &path);
+
+/*!
+ * \brief cachedExif
+ * Same as readExif, for the callers asking about the same file again and
+ * again(eg: viewing). The result is cached by path until the file is modified.
+ * \param path
+ * \return
+ */
+ExifInfo cachedExif(const QString &path);
+
+}  // namespace image
+
+}  // namespace utils
+
+#endif // EXIFPARSER_H
@@ -0,0 +1,304 @@
+#include "imagesniffer.h"
+#include <QByteArray>
+#include <QCache>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace utils {
+
+namespace image {
+
+namespace {
+
+const int HEADER_SIZE = 64;
+// A XML file is read further to find the root element
+const int XML_HEADER_SIZE = 4096;
+const int CACHE_SIZE = 200000;  // Paths
+
+struct Signature {
+    ImageFormat format;
+    int offset;
+    QByteArray magic;
+    // The magic is too weak to decide alone, the suffix must be one of them
+    QStringList suffixes;
+};
+
+const QVector<Signature> &signatures()
+{
+    static const QVector<Signature> table = {
+        {FormatJPEG, 0, QByteArray("\xFF\xD8\xFF", 3), {}},
+        {FormatPNG, 0, QByteArray("\x89PNG\r\n\x1A\n", 8), {}},
+        {FormatGIF, 0, QByteArray("GIF87a"), {}},
+        {FormatGIF, 0, QByteArray("GIF89a"), {}},
+        {FormatWebP, 8, QByteArray("WEBPVP8"), {}},
+        // Camera raws which aren't TIFF based, or with their own TIFF magic
+        {FormatRAW, 0, QByteArray("II\x1A\0\0\0HEAPCCDR", 14), {}},  // Canon CRW
+        {FormatRAW, 0, QByteArray("FUJIFILMCCD-RAW"), {}},  // Fuji RAF
+        {FormatRAW, 0, QByteArray("\0MRM", 4), {}},  // Minolta MRW
+        {FormatRAW, 0, QByteArray("FOVb"), {}},  // Sigma X3F
+        {FormatRAW, 0, QByteArray("IIRO\x08\0", 6), {}},  // Olympus ORF
+        {FormatRAW, 0, QByteArray("IIRS\x08\0", 6), {}},
+        {FormatRAW, 0, QByteArray("MMOR\0\0", 6), {}},
+        {FormatRAW, 0, QByteArray("IIU\0", 4), {}},  // Panasonic RW2
+        {FormatTIFF, 0, QByteArray("II*\0", 4), {}},
+        {FormatTIFF, 0, QByteArray("MM\0*", 4), {}},
+        {FormatBMP, 0, QByteArray("BM"), {"bmp", "dib"}},
+        {FormatSVG, 0, QByteArray("\x1F\x8B", 2), {"svgz"}},
+        {FormatOther, 0, QByteArray("8BPS"), {}},  // PSD
+        {FormatOther, 0, QByteArray("DDS "), {}},
+        {FormatOther, 0, QByteArray("\0\0\0\x0CjP  \r\n\x87\n", 12), {}},  // JP2
+        {FormatOther, 0, QByteArray("\xFF\x4F\xFF\x51", 4), {}},  // J2K
+        {FormatOther, 0, QByteArray("v/1\x01", 4), {}},  // EXR
+        {FormatOther, 0, QByteArray("#?RADIANCE"), {}},  // HDR
+        {FormatOther, 0, QByteArray("#?RGBE"), {}},
+        {FormatOther, 0, QByteArray("\x8AMNG\r\n\x1A\n", 8), {}},
+        {FormatOther, 0, QByteArray("\x8BJNG\r\n\x1A\n", 8), {}},
+        {FormatOther, 0, QByteArray("\x59\xA6\x6A\x95", 4), {}},  // Sun raster
+        {FormatOther, 0, QByteArray("/* XPM */"), {}},
+        {FormatOther, 0, QByteArray("II\xBC", 3), {"jxr", "wdp", "hdp"}},
+        {FormatOther, 8, QByteArray("ILBM"), {"iff", "lbm"}},
+        {FormatOther, 8, QByteArray("PBM "), {"iff", "lbm"}},
+        {FormatOther, 0, QByteArray("\0\0\x01\0", 4), {"ico"}},
+        {FormatOther, 0, QByteArray("\x0A", 1), {"pcx"}},
+        {FormatOther, 0, QByteArray("\x01\xDA", 2), {"sgi", "rgb", "rgba", "bw"}},
+        {FormatOther, 0, QByteArray("#define"), {"xbm"}},
+        {FormatOther, 0, QByteArray("PF\n"), {"pfm"}},
+        {FormatOther, 0, QByteArray("Pf\n"), {"pfm"}},
+        {FormatOther, 0, QByteArray("P1"), {"pbm", "pnm"}},
+        {FormatOther, 0, QByteArray("P4"), {"pbm", "pnm"}},
+        {FormatOther, 0, QByteArray("P2"), {"pgm", "pnm"}},
+        {FormatOther, 0, QByteArray("P5"), {"pgm", "pnm"}},
+        {FormatOther, 0, QByteArray("P3"), {"ppm", "pnm"}},
+        {FormatOther, 0, QByteArray("P6"), {"ppm", "pnm"}},
+    };
+    return table;
+}
+
+// The format a suffix is expected to be, its signatures are matched first
+const QHash<QString, ImageFormat> &suffixFormats()
+{
+    static const QHash<QString, ImageFormat> formats = {
+        {"jpg", FormatJPEG}, {"jpeg", FormatJPEG}, {"jpe", FormatJPEG},
+        {"png", FormatPNG}, {"gif", FormatGIF}, {"bmp", FormatBMP},
+        {"tif", FormatTIFF}, {"tiff", FormatTIFF}, {"webp", FormatWebP},
+        {"svg", FormatSVG}, {"svgz", FormatSVG},
+    };
+    return formats;
+}
+
+// The suffixes which always name the format, they are trusted without reading
+// the file. FreeImage tells the real format by the content when it decodes.
+const QHash<QString, ImageFormat> &trustedSuffixFormats()
+{
+    static const QHash<QString, ImageFormat> formats = {
+        {"jpg", FormatJPEG}, {"jpeg", FormatJPEG}, {"jpe", FormatJPEG},
+        {"png", FormatPNG}, {"gif", FormatGIF}, {"webp", FormatWebP},
+        {"tif", FormatTIFF}, {"tiff", FormatTIFF},
+        {"3fr", FormatRAW}, {"arw", FormatRAW}, {"cr2", FormatRAW},
+        {"crw", FormatRAW}, {"dcr", FormatRAW}, {"dng", FormatRAW},
+        {"erf", FormatRAW}, {"iiq", FormatRAW}, {"kdc", FormatRAW},
+        {"mef", FormatRAW}, {"mos", FormatRAW}, {"mrw", FormatRAW},
+        {"nef", FormatRAW}, {"nrw", FormatRAW}, {"orf", FormatRAW},
+        {"pef", FormatRAW}, {"raf", FormatRAW}, {"rw2", FormatRAW},
+        {"rwl", FormatRAW}, {"sr2", FormatRAW}, {"srf", FormatRAW},
+        {"srw", FormatRAW}, {"x3f", FormatRAW},
+    };
+    return formats;
+}
+
+// The suffixes of files which are never images, they are rejected before any
+// I/O since photo directories are full of videos and sidecars
+const QSet<QString> &nonImageSuffixes()
+{
+    static const QSet<QString> suffixes = {
+        // Videos
+        "3gp", "avi", "flv", "m2ts", "m4v", "mkv", "mov", "mp4", "mpeg",
+        "mpg", "mts", "ogv", "rm", "rmvb", "ts", "webm", "wmv",
+        // Audios
+        "aac", "amr", "flac", "m4a", "mp3", "ogg", "opus", "wav", "wma",
+        // Sidecars and documents
+        "aae", "csv", "doc", "docx", "htm", "html", "ini", "json", "log",
+        "md", "nfo", "odt", "pdf", "pp3", "thm", "txt", "xls", "xlsx",
+        "xml", "xmp",
+        // Archives and others
+        "7z", "bak", "db", "desktop", "exe", "gz", "part", "rar", "so",
+        "sqlite", "tar", "tmp", "xz", "zip",
+    };
+    return suffixes;
+}
+
+// Formats without a signature, FreeImage tells them by the suffix as well
+const QSet<QString> &suffixOnlyFormats()
+{
+    static const QSet<QString> suffixes = {
+        "tga", "targa", "wbmp", "cut", "g3", "koa", "pct", "pict", "pic",
+    };
+    return suffixes;
+}
+
+// Camera raws of the TIFF magic
+const QSet<QString> &tiffRawSuffixes()
+{
+    static const QSet<QString> suffixes = {
+        "3fr", "arw", "cr2", "dcr", "dng", "erf", "iiq", "kdc", "mef", "mos",
+        "nef", "nrw", "pef", "raw", "rwl", "sr2", "srf", "srw",
+    };
+    return suffixes;
+}
+
+bool matchSignature(const QByteArray &header, const Signature &signature,
+                    const QString &suffix)
+{
+    return header.length() >= signature.offset + signature.magic.length()
+            && memcmp(header.constData() + signature.offset,
+                      signature.magic.constData(),
+                      signature.magic.length()) == 0
+            && (signature.suffixes.isEmpty()
+                || signature.suffixes.contains(suffix));
+}
+
+// Whether the root element is <svg>, data starts with a '<'
+bool isSvgDocument(const QByteArray &data)
+{
+    int pos = 0;
+    while ((pos = data.indexOf('<', pos)) >= 0 && pos + 1 < data.length()) {
+        if (data.mid(pos, 4) == "<!--") {
+            pos = data.indexOf("-->", pos);
+            if (pos < 0) {
+                break;
+            }
+            continue;
+        }
+        // Skip the declaration and doctype
+        if (data.at(pos + 1) == '?' || data.at(pos + 1) == '!') {
+            pos ++;
+            continue;
+        }
+
+        return data.mid(pos + 1, 3) == "svg" || data.mid(pos + 1, 7) == "svg:svg";
+    }
+
+    return false;
+}
+
+ImageFormat sniffHeader(int fd, const QString &suffix)
+{
+    QByteArray header(HEADER_SIZE, 0);
+    const ssize_t length = read(fd, header.data(), HEADER_SIZE);
+    if (length <= 0) {
+        return suffixOnlyFormats().contains(suffix) ? FormatOther
+                                                    : FormatUnknown;
+    }
+    header.truncate(length);
+
+    const ImageFormat expected = suffixFormats().value(suffix, FormatUnknown);
+    ImageFormat format = FormatUnknown;
+    for (const Signature &signature : signatures()) {
+        if (signature.format == expected
+                && matchSignature(header, signature, suffix)) {
+            format = expected;
+            break;
+        }
+    }
+    if (format == FormatUnknown) {
+        for (const Signature &signature : signatures()) {
+            if (matchSignature(header, signature, suffix)) {
+                format = signature.format;
+                break;
+            }
+        }
+    }
+    if (format == FormatTIFF && tiffRawSuffixes().contains(suffix)) {
+        return FormatRAW;
+    }
+    if (format != FormatUnknown) {
+        return format;
+    }
+
+    // SVG is XML, which may start with a BOM and white spaces
+    const QByteArray text = header.startsWith("\xEF\xBB\xBF")
+            ? header.mid(3).trimmed() : header.trimmed();
+    if (text.startsWith('<')) {
+        QByteArray data = header;
+        if (length == HEADER_SIZE) {
+            data.resize(XML_HEADER_SIZE);
+            const ssize_t more = read(fd, data.data() + length,
+                                      XML_HEADER_SIZE - length);
+            data.truncate(length + qMax(ssize_t(0), more));
+        }
+        if (isSvgDocument(data)) {
+            return FormatSVG;
+        }
+    }
+
+    return suffixOnlyFormats().contains(suffix) ? FormatOther : FormatUnknown;
+}
+
+struct SniffResult {
+    ImageFormat format;
+    qint64 size;
+    qint64 modified;  // Nanoseconds since epoch
+};
+
+QMutex cacheMutex;
+QCache<QString, SniffResult> sniffCache(CACHE_SIZE);
+
+}  // namespace
+
+ImageFormat sniffImageFormat(const QString &path)
+{
+    const int dot = path.lastIndexOf('.');
+    const QString suffix = dot > path.lastIndexOf('/')
+            ? path.mid(dot + 1).toLower() : QString();
+    if (nonImageSuffixes().contains(suffix)) {
+        return FormatUnknown;
+    }
+    const ImageFormat trusted = trustedSuffixFormats().value(suffix,
+                                                              FormatUnknown);
+    if (trusted != FormatUnknown) {
+        return trusted;
+    }
+
+    // Unknown and ambiguous suffixes are sniffed
+    const QByteArray file = QFile::encodeName(path);
+    struct stat st;
+    if (stat(file.constData(), &st) != 0 || ! S_ISREG(st.st_mode)) {
+        return FormatUnknown;
+    }
+    const qint64 modified = qint64(st.st_mtim.tv_sec) * 1000000000
+            + st.st_mtim.tv_nsec;
+
+    {
+        QMutexLocker locker(&cacheMutex);
+        const SniffResult *cached = sniffCache.object(path);
+        if (cached && cached->size == st.st_size
+                && cached->modified == modified) {
+            return cached->format;
+        }
+    }
+
+    const int fd = open(file.constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return FormatUnknown;
+    }
+    const ImageFormat format = sniffHeader(fd, suffix);
+    close(fd);
+
+    QMutexLocker locker(&cacheMutex);
+    sniffCache.insert(path, new SniffResult{format, st.st_size, modified});
+
+    return format;
+}
+
+}  // namespace image
+
+}  // namespace utils
@@ -0,0 +1,40 @@
+#ifndef IMAGESNIFFER_H
+#define IMAGESNIFFER_H
+
+#include <QString>
+
+namespace utils {
+
+namespace image {
+
+enum ImageFormat {
+    FormatUnknown,  // Not an image
+    FormatJPEG,
+    FormatPNG,
+    FormatGIF,
+    FormatBMP,
+    FormatTIFF,
+    FormatWebP,
+    FormatRAW,  // Camera raw, most of them are TIFF based
+    FormatSVG,
+    FormatOther  // Other formats read by FreeImage
+};
+
+/*!
+ * \brief sniffImageFormat
+ * Tell the format without probing the file with the decoders. Known
+ * non-image suffixes(eg: mp4, xmp) are rejected and the common photo
+ * suffixes are trusted, both without any I/O. Other files are told by the
+ * signature in their first bytes, which are read at once, formats without a
+ * signature(eg: TGA) by the suffix.
+ * The sniffed result is cached by path until the file is modified.
+ * \param path
+ * \return
+ */
+ImageFormat sniffImageFormat(const QString &path);
+
+}  // namespace image
+
+}  // namespace utils
+
+#endif // IMAGESNIFFER_H
@@ -1,12 +1,16 @@
 #include "utils/baseutils.h"
 #include "utils/imageutils.h"
-#include "utils/imageutils_libexif.h"
 #include "utils/imageutils_freeimage.h"
+#include "utils/exifparser.h"
+#include "utils/imagesniffer.h"
+#include "utils/dirwalker.h"
+#include "utils/thumbnailcache.h"
+#include "utils/thumbnailpack.h"
+#include <QAtomicInt>
 #include <QBuffer>
 #include <QCryptographicHash>
 #include <QDebug>
 #include <QDir>
-#include <QDirIterator>
 #include <QFileInfo>
 #include <QImage>
 #include <QImageReader>
@@ -15,49 +19,309 @@
 #include <QPixmapCache>
 #include <QProcess>
 #include <QReadWriteLock>
-#include <QSvgRenderer>
+#include <QSaveFile>
 #include <QUrl>
+#include <sys/stat.h>
 
 namespace utils {
 
 namespace image {
 
+namespace {
+
+// The square cuts are cached apart from the large thumbnails by this size
+const int SQUARE_CACHE_SIZE = 0;
+
+// Nanoseconds since epoch, 0 if it can't be stat
+qint64 modifiedTime(const QString &path)
+{
+    struct stat st;
+    if (stat(QFile::encodeName(path).constData(), &st) != 0) {
+        return 0;
+    }
+    return qint64(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+// Orientations 5 to 8 swap the width and height
+bool isTransposed(int orientation)
+{
+    return orientation >= 5 && orientation <= 8;
+}
+
+}  // namespace
+
+/*!
+ * \brief applyOrientation
+ * Turn the decoded image to show by the EXIF orientation. The pixels are
+ * moved exactly(mirrored, or rotated by a multiple of 90 degrees), nothing
+ * is resampled.
+ * \param image
+ * \param orientation
+ * \return
+ */
+const QImage applyOrientation(const QImage &image, int orientation)
+{
+    switch (orientation) {
+    case 2:  // Top-right
+        return image.mirrored(true, false);
+    case 3:  // Bottom-right
+        return image.mirrored(true, true);
+    case 4:  // Bottom-left
+        return image.mirrored(false, true);
+    case 5:  // Left-top, transposed
+        return image.transformed(QTransform().rotate(90)).mirrored(true, false);
+    case 6:  // Right-top
+        return image.transformed(QTransform().rotate(90));
+    case 7:  // Right-bottom, transversed
+        return image.transformed(QTransform().rotate(90)).mirrored(false, true);
+    case 8:  // Left-bottom
+        return image.transformed(QTransform().rotate(270));
+    default:
+        return image;
+    }
+}
+
+namespace {
+
+/*!
+ * \brief readOrientedImage
+ * Decode the image with the orientation applied. The decoders which know the
+ * orientation(eg: JPEG) apply it while decoding, the others' result is turned
+ * by applyOrientation().
+ * \param path
+ * \param scaledSize decode at the size(as stored) if it is valid
+ * \return
+ */
+QImage readOrientedImage(const QString &path, const QSize &scaledSize)
+{
+    QImageReader reader(path);
+    reader.setAutoTransform(true);
+    const bool autoTransformed =
+            reader.supportsOption(QImageIOHandler::ImageTransformation);
+    if (scaledSize.isValid()) {
+        reader.setScaledSize(scaledSize);
+    }
+
+    const QImage img = reader.read();
+    if (img.isNull() || autoTransformed) {
+        return img;
+    }
+    return applyOrientation(img, getOrientation(path));
+}
+
+// Fit the shown size into size
+QSize fitSize(const QSize &imageSize, const QSize &size)
+{
+    if (imageSize.width() > imageSize.height()) {
+        return QSize(size.width(),
+                     (double)size.width() / imageSize.width() *
+                     imageSize.height());
+    }
+    else {
+        return QSize((double)size.height() / imageSize.height() *
+                     imageSize.width(), size.height());
+    }
+}
+
+// Thumbnails served by every tier
+QAtomicInt tierCounts[TierCount];
+
+// The preview is used if it is as large as the large thumbnail, and has the
+// aspect of the image(some cameras letterbox it)
+bool coversThumbnail(const QSize &preview, const QSize &imageSize)
+{
+    if (preview.isEmpty()) {
+        return false;
+    }
+    const int longEdge = imageSize.isEmpty()
+            ? THUMBNAIL_MAX_SIZE
+            : qMin(THUMBNAIL_MAX_SIZE,
+                   qMax(imageSize.width(), imageSize.height()));
+    if (qMax(preview.width(), preview.height()) < longEdge) {
+        return false;
+    }
+    if (! imageSize.isEmpty()) {
+        const double ratio = double(imageSize.width()) / imageSize.height();
+        if (qAbs(double(preview.width()) / preview.height() - ratio)
+                > ratio * 0.02) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+QImage readEmbeddedThumbnail(const QString &path, const ExifInfo &exif)
+{
+    if (exif.thumbnailLength <= 0) {
+        return QImage();
+    }
+    QFile file(path);
+    if (! file.open(QIODevice::ReadOnly) || ! file.seek(exif.thumbnailOffset)) {
+        return QImage();
+    }
+
+    QBuffer buffer;
+    buffer.setData(file.read(exif.thumbnailLength));
+    buffer.open(QIODevice::ReadOnly);
+    QImageReader reader(&buffer, "jpeg");
+    // The size is read from the header, it's decoded only if it's used
+    if (! coversThumbnail(reader.size(), exif.size)) {
+        return QImage();
+    }
+    return applyOrientation(reader.read(), exif.orientation);
+}
+
+/*!
+ * \brief readRawPreview
+ * Read the preview embedded in camera raws. FreeImage demosaics the sensor
+ * data instead if a raw has no preview, which is told by the decoded size
+ * being the sensor size. A full sized embedded preview is told as such too.
+ * \param path
+ * \param exif
+ * \param demosaiced set if the sensor data was decoded fully
+ * \return
+ */
+QImage readRawPreview(const QString &path, const ExifInfo &exif,
+                      bool &demosaiced)
+{
+    demosaiced = false;
+    // The cached verdict of the sniffer, only raws are opened by FreeImage
+    if (sniffImageFormat(path) != FormatRAW) {
+        return QImage();
+    }
+    const QByteArray file = QFile::encodeName(path);
+    QSize sensorSize;
+    FIBITMAP *header = FreeImage_Load(FIF_RAW, file.constData(),
+                                      RAW_PREVIEW | FIF_LOAD_NOPIXELS);
+    if (header) {
+        sensorSize = QSize(FreeImage_GetWidth(header),
+                           FreeImage_GetHeight(header));
+        FreeImage_Unload(header);
+    }
+    FIBITMAP *dib = FreeImage_Load(FIF_RAW, file.constData(), RAW_PREVIEW);
+    if (! dib) {
+        return QImage();
+    }
+
+    QImage img;
+    const QSize size(FreeImage_GetWidth(dib), FreeImage_GetHeight(dib));
+    demosaiced = ! sensorSize.isEmpty()
+            && (size == sensorSize || size == sensorSize.transposed());
+    if (coversThumbnail(size, QSize())) {
+        img = applyOrientation(freeimage::FIBitmapToQImage(dib),
+                               exif.orientation);
+    }
+    FreeImage_Unload(dib);
+    return img;
+}
+
+/*!
+ * \brief readThumbnailImage
+ * Decode the large thumbnail by the cheapest tier that serves it: the EXIF
+ * thumbnail, the preview of camera raws, the scaling of the decoder, and the
+ * full decoding last.
+ * \param path
+ * \param img
+ * \param tier the one served it
+ * \return false if no decoder can read the image
+ */
+bool readThumbnailImage(const QString &path, QImage &img, ThumbnailTier &tier)
+{
+    const ExifInfo exif = cachedExif(path);
+    img = readEmbeddedThumbnail(path, exif);
+    tier = TierEmbedded;
+    if (img.isNull()) {
+        bool demosaiced = false;
+        img = readRawPreview(path, exif, demosaiced);
+        tier = demosaiced ? TierFull : TierRawPreview;
+    }
+    if (! img.isNull()) {
+        if (img.width() > THUMBNAIL_MAX_SIZE
+                || img.height() > THUMBNAIL_MAX_SIZE) {
+            img = img.scaled(THUMBNAIL_MAX_SIZE, THUMBNAIL_MAX_SIZE,
+                             Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        }
+        return true;
+    }
+
+    QImageReader reader(path);
+    reader.setAutoTransform(true);
+    if (! reader.canRead()) {
+        return false;
+    }
+
+    QSize lSize = reader.size();
+    lSize.scale(QSize(qMin(THUMBNAIL_MAX_SIZE, lSize.width()),
+                      qMin(THUMBNAIL_MAX_SIZE, lSize.height())),
+                Qt::KeepAspectRatio);
+    // The decoders not supporting it decode fully and scale the result
+    tier = reader.supportsOption(QImageIOHandler::ScaledSize)
+            ? TierScaled : TierFull;
+    reader.setScaledSize(lSize);
+    img = reader.read();
+    return true;
+}
+
+}  // namespace
+
 const QPixmap scaleImage(const QString &path, const QSize &size)
 {
-    QImage img = getRotatedImage(path);
-    if (img.isNull())
-        return QPixmap();
+    const int orientation = getOrientation(path);
+    QSize storedSize = QImageReader(path).size();
     QSize targetSize;
-    if (img.width() > img.height()) {
-        targetSize = QSize(size.width(),
-                           (double)size.width() / img.width() *
-                           img.height());
+    QSize decodeSize;
+    if (storedSize.isValid() && ! storedSize.isEmpty()) {
+        QSize imageSize = storedSize;
+        if (isTransposed(orientation)) {
+            imageSize.transpose();
+        }
+        targetSize = fitSize(imageSize, size);
+        // Decoded at twice of the target and scaled smoothly later, the JPEG
+        // decoder skips the rest while decoding
+        decodeSize = targetSize * 2;
+        if (isTransposed(orientation)) {
+            decodeSize.transpose();
+        }
+        if (decodeSize.width() >= storedSize.width()
+                || decodeSize.height() >= storedSize.height()) {
+            decodeSize = QSize();
+        }
     }
-    else {
-        targetSize = QSize((double)size.height() / img.height() *
-                           img.width(), size.height());
+
+    QImage img = readOrientedImage(path, decodeSize);
+    if (img.isNull())
+        return QPixmap();
+    if (! targetSize.isValid()) {
+        targetSize = fitSize(img.size(), size);
+        // pre-scale improve performance
+        img = img.scaled(targetSize * 2,
+                         Qt::IgnoreAspectRatio,
+                         Qt::SmoothTransformation);
     }
 
-    // pre-scale improve performance
-    const QImage tmpImg = img.scaled(targetSize * 2,
-                                     Qt::IgnoreAspectRatio,
-                                     Qt::SmoothTransformation);
-    return QPixmap::fromImage(tmpImg.scaled(targetSize,
-                                            Qt::IgnoreAspectRatio,
-                                            Qt::SmoothTransformation));
+    return QPixmap::fromImage(img.scaled(targetSize,
+                                         Qt::IgnoreAspectRatio,
+                                         Qt::SmoothTransformation));
 }
 
 const QDateTime getCreateDateTime(const QString &path)
 {
-    return libexif::getCreateDateTime(path);
+    const QDateTime time = cachedExif(path).dateTimeOriginal;
+    return time.isValid() ? time : QFileInfo(path).created();
 }
 
+void getCameraInfo(const QString &path, QString &camera, QString &lens)
+{
+    const ExifInfo info = cachedExif(path);
+    camera = info.camera;
+    lens = info.lens;
+}
+
+// Sniffed by the signature, the decoders are not involved
 bool imageSupportRead(const QString &path)
 {
-    if (freeimage::isSupportsReading(path))
-        return true;
-    else
-        return QSvgRenderer().load(path);
+    return sniffImageFormat(path) != FormatUnknown;
 }
 
 bool imageSupportSave(const QString &path)
@@ -95,7 +359,8 @@ bool rotate(const QString &path, int degree)
     // Try QImage::transformed first, if it faile, use FreeImage_Rotate later
     const QTransform t = QTransform().rotate(degree);
     bool v = false;
-    v = QImage(path).transformed(t).save(path);
+    // The saved one has no EXIF, rotate the image as it is shown
+    v = getRotatedImage(path).transformed(t).save(path);
     if (! v) {
         FIBITMAP *dib = freeimage::readFileToFIBITMAP(path);
         FIBITMAP *rotated = FreeImage_Rotate(dib, -degree);
@@ -186,52 +451,34 @@ const QFileInfoList getImagesInfo(const QString &dir, bool recursive)
         return infos;
     }
 
-    QDirIterator dirIterator(dir,
-                             QDir::Files | QDir::NoSymLinks,
-                             QDirIterator::Subdirectories);
-    while(dirIterator.hasNext())
-    {
-        dirIterator.next();
-        if (imageSupportRead(dirIterator.fileInfo().absoluteFilePath())) {
-            infos << dirIterator.fileInfo();
+    // Files are sniffed by the walker threads
+    QMutex mutex;
+    DirWalker walker;
+    walker.walk(QFileInfo(dir).absoluteFilePath(), [&] (const QString &path) {
+        if (imageSupportRead(path)) {
+            QMutexLocker locker(&mutex);
+            infos << QFileInfo(path);
         }
-    }
+        return true;
+    });
 
     return infos;
 }
 
-const QString getOrientation(const QString &path)
+int getOrientation(const QString &path)
 {
-    return libexif::orientation(path);
+    return cachedExif(path).orientation;
 }
 
 /*!
  * \brief getRotatedImage
- * Rotate image base on the exif orientation
+ * Rotate image base on the exif orientation, all the 8 of them
  * \param path
  * \return
  */
 const QImage getRotatedImage(const QString &path)
 {
-    // FIXME it should read the orientation enum value
-    QImage img(path);
-
-    const QString o = getOrientation(path);
-    if (o.isEmpty() || o == "Top-left")
-        return img;
-    QTransform t;
-    if (o == "Bottom-right") {
-        t.rotate(-180);
-    }
-    else if (o == "Left-bottom") {
-        t.rotate(-90);
-    }
-    else if (o == "Right-top") {
-        t.rotate(90);
-    }
-    img = img.transformed(t, Qt::SmoothTransformation);
-
-    return img;
+    return readOrientedImage(path, QSize());
 }
 
 const QMap<QString, QString> getAllMetaData(const QString &path)
@@ -291,7 +538,7 @@ QMap<QString,QString> thumbnailAttribute(const QUrl&  url)
     return set;
 }
 
-const QString thumbnailCachePath()
+QString findThumbnailCachePath()
 {
     QString cacheP;
 
@@ -314,31 +561,57 @@ const QString thumbnailCachePath()
     return thumbCacheP;
 }
 
-QMutex mutex;
+const QString thumbnailCachePath()
+{
+    // Found once, it is asked for every thumbnail
+    static const QString path = findThumbnailCachePath();
+    return path;
+}
+
+/*!
+ * \brief saveThumbnail
+ * The thumbnail is written to a temporary file and renamed, the readers
+ * never see a half written one. So the thumbnails of different images are
+ * generated without a lock.
+ */
+bool saveThumbnail(const QImage &img, const QString &path, int quality = -1)
+{
+    QSaveFile file(path);
+    return file.open(QIODevice::WriteOnly) && img.save(&file, "png", quality)
+            && file.commit();
+}
+
 const QPixmap getThumbnail(const QString &path, bool cacheOnly)
 {
-    QMutexLocker locker(&mutex);
+    // The decoded ones are kept in memory until removeThumbnail(), which the
+    // editors and LibraryWatcher call once the image is modified, so the
+    // paint path looks them up without a stat
+    ThumbnailCache *memCache = ThumbnailCache::instance();
+    QPixmap thumbnail;
+    if (memCache->find(path, THUMBNAIL_MAX_SIZE, thumbnail)) {
+        return thumbnail;
+    }
+    const qint64 modified = modifiedTime(path);
+
     const QString cacheP = thumbnailCachePath();
     const QUrl url("file://" + path);
     const QString md5s = toMd5(url.toString());
     const QString encodePath = cacheP + "/large/" + md5s + ".png";
     const QString failEncodePath = cacheP + "/fail/" + md5s + ".png";
     if (QFileInfo(encodePath).exists()) {
-        return QPixmap(encodePath);
+        thumbnail = QPixmap(encodePath);
     }
     else if (QFileInfo(failEncodePath).exists()) {
         qDebug() << "Fail-thumbnail exist, won't regenerate: " << path;
         return QPixmap();
     }
-    else {
-        // Try to generate thumbnail and load it later
-        if (! cacheOnly && generateThumbnail(path)) {
-            return QPixmap(encodePath);
-        }
-        else {
-            return QPixmap();
-        }
+    // Try to generate thumbnail and load it later
+    else if (! cacheOnly && generateThumbnail(path)) {
+        thumbnail = QPixmap(encodePath);
     }
+
+    memCache->insert(path, THUMBNAIL_MAX_SIZE, modified, thumbnail);
+    return thumbnail;
 //    if (getOrientation(path).isEmpty() && ! highQuality) {
 //        auto bitmap = freeimage::makeThumbnail(path, THUMBNAIL_MAX_SIZE);
 //        if (bitmap != NULL) {
@@ -356,26 +629,22 @@ const QPixmap getThumbnail(const QString &path, bool cacheOnly)
  */
 bool generateThumbnail(const QString &path)
 {
-    QImageReader reader(path);
-    reader.setAutoTransform(true);
-    if (! reader.canRead()) {
+    // Large thumbnail
+    QImage lImg;
+    ThumbnailTier tier;
+    if (! readThumbnailImage(path, lImg, tier)) {
         qDebug() << "Can't read image: " << path;
         return false;
     }
+    if (! lImg.isNull()) {
+        tierCounts[tier].ref();
+    }
 
     const QUrl url("file://" + path);
     const QString md5 = toMd5(url.toString());
     const auto attributes = thumbnailAttribute(url);
     const QString cacheP = thumbnailCachePath();
 
-    // Large thumbnail
-    QSize lSize = reader.size();
-    lSize.scale(QSize(qMin(THUMBNAIL_MAX_SIZE, lSize.width()),
-                      qMin(THUMBNAIL_MAX_SIZE, lSize.height())),
-                Qt::KeepAspectRatio);
-    reader.setScaledSize(lSize);
-    QImage lImg = reader.read();
-
     // Normal thumbnail
     QImage nImg = lImg.scaled(
                 QSize(THUMBNAIL_NORMAL_SIZE, THUMBNAIL_NORMAL_SIZE)
@@ -391,7 +660,7 @@ bool generateThumbnail(const QString &path)
             img.setText(key, attributes[key]);
         }
 
-        qDebug()<<"Save failed thumbnail:" << img.save(failedP,  "png")
+        qDebug()<<"Save failed thumbnail:" << saveThumbnail(img, failedP)
                << failedP << url;
         return false;
     }
@@ -402,7 +671,8 @@ bool generateThumbnail(const QString &path)
         }
         const QString largeP = cacheP + "/large/" + md5 + ".png";
         const QString normalP = cacheP + "/normal/" + md5 + ".png";
-        if (lImg.save(largeP, "png", 50) && nImg.save(normalP, "png", 50)) {
+        // The large one is checked by getThumbnail(), it is saved last
+        if (saveThumbnail(nImg, normalP, 50) && saveThumbnail(lImg, largeP, 50)) {
             return true;
         }
         else {
@@ -411,6 +681,11 @@ bool generateThumbnail(const QString &path)
     }
 }
 
+int thumbnailTierCount(ThumbnailTier tier)
+{
+    return tier >= 0 && tier < TierCount ? tierCounts[tier].load() : 0;
+}
+
 const QString thumbnailPath(const QString &path, ThumbnailType type)
 {
     const QString cacheP = thumbnailCachePath();
@@ -433,8 +708,43 @@ const QString thumbnailPath(const QString &path, ThumbnailType type)
     return tp;
 }
 
+const QPixmap getSquareThumbnail(qint64 id, const QString &path,
+                                 qint64 modified, bool cacheOnly)
+{
+    // The mtime is the one recorded in the library, the file isn't stat
+    ThumbnailPack *pack = ThumbnailPack::instance();
+    if (id <= 0 || modified <= 0 || ! pack->isOpen()) {
+        return cutSquareImage(getThumbnail(path, cacheOnly));
+    }
+
+    const QImage packed = pack->find(id, modified);
+    if (! packed.isNull()) {
+        return QPixmap::fromImage(packed);
+    }
+
+    // Pack it from the freedesktop one for the next start
+    const QPixmap thumbnail = cutSquareImage(getThumbnail(path, cacheOnly));
+    if (! thumbnail.isNull()) {
+        pack->insert(id, modified, thumbnail.toImage());
+    }
+    return thumbnail;
+}
+
+const QPixmap cachedSquareThumbnail(const QString &path)
+{
+    QPixmap square;
+    ThumbnailCache::instance()->find(path, SQUARE_CACHE_SIZE, square);
+    return square;
+}
+
+void cacheSquareThumbnail(const QString &path, const QPixmap &square)
+{
+    ThumbnailCache::instance()->insert(path, SQUARE_CACHE_SIZE, 0, square);
+}
+
 void removeThumbnail(const QString &path)
 {
+    ThumbnailCache::instance()->remove(path);
     QFile(thumbnailPath(path, ThumbLarge)).remove();
     QFile(thumbnailPath(path, ThumbNormal)).remove();
     QFile(thumbnailPath(path, ThumbFail)).remove();
@@ -442,6 +752,10 @@ void removeThumbnail(const QString &path)
 
 bool thumbnailExist(const QString &path)
 {
+    // It's asked for on every paint, the memory is checked first
+    if (ThumbnailCache::instance()->contains(path, THUMBNAIL_MAX_SIZE)) {
+        return true;
+    }
     if (QFileInfo(thumbnailPath(path, ThumbLarge)).exists() ||
 //            QFileInfo(thumbnailPath(path, ThumbNormal)).exists() ||
             QFileInfo(thumbnailPath(path, ThumbFail)).exists()) {
@@ -19,15 +19,31 @@ enum ThumbnailType {
     ThumbFail
 };
 
+// The ways a thumbnail is decoded, from the cheapest one
+enum ThumbnailTier {
+    TierEmbedded,    // The EXIF thumbnail
+    TierRawPreview,  // The preview embedded in camera raws
+    TierScaled,      // Scaled by the decoder, eg: DCT scaling of JPEG
+    TierFull,        // Decoded fully, then scaled
+    TierCount
+};
+
 const QPixmap                       cachePixmap(const QString &path);
 const QPixmap                       cutSquareImage(const QPixmap &pixmap);
 const QPixmap                       cutSquareImage(const QPixmap &pixmap,
                                                    const QSize &size);
 const QMap<QString, QString>        getAllMetaData(const QString &path);
 const QDateTime                     getCreateDateTime(const QString &path);
+void                                getCameraInfo(const QString &path,
+                                                  QString &camera,
+                                                  QString &lens);
 const QFileInfoList                 getImagesInfo(const QString &dir,
                                                   bool recursive = true);
-const QString                       getOrientation(const QString &path);
+// Turn the decoded image to show by the EXIF orientation(1 to 8)
+const QImage                        applyOrientation(const QImage &image,
+                                                     int orientation);
+// EXIF orientation, 1 to 8
+int                                 getOrientation(const QString &path);
 const QImage                        getRotatedImage(const QString &path);
 bool                                imageSupportRead(const QString &path);
 bool                                imageSupportSave(const QString &path);
@@ -39,10 +55,23 @@ const QPixmap                       scaleImage(const QString &path,
 bool                                generateThumbnail(const QString &path);
 const QPixmap                       getThumbnail(const QString &path,
                                                  bool cacheOnly = false);
+// Cut square for the grids, read from the thumbnail pack if it's open and
+// the modified time(nanoseconds since epoch) of the image is known
+const QPixmap                       getSquareThumbnail(qint64 id,
+                                                       const QString &path,
+                                                       qint64 modified,
+                                                       bool cacheOnly = false);
+// The square cuts shown by the grids live in ThumbnailCache only, they are
+// dropped by removeThumbnail() or evicted like the other thumbnails
+const QPixmap                       cachedSquareThumbnail(const QString &path);
+void                                cacheSquareThumbnail(const QString &path,
+                                                         const QPixmap &square);
 void                                removeThumbnail(const QString &path);
 const QString                       thumbnailCachePath();
 const QString                       thumbnailPath(const QString &path,
                                                   ThumbnailType type = ThumbLarge);
+// Thumbnails generated by the tier since start
+int                                 thumbnailTierCount(ThumbnailTier tier);
 bool                                thumbnailExist(const QString &path);
 
 }  // namespace image
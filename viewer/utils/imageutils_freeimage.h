@@ -29,7 +29,7 @@ const QString getFileFormat(const QString &path)
     }
 }
 
-FIBITMAP * readFileToFIBITMAP(const QString &path)
+FIBITMAP * readFileToFIBITMAP(const QString &path, int flags = 0)
 {
     FREE_IMAGE_FORMAT fif = FIF_UNKNOWN;
     fif = FreeImage_GetFileType(path.toUtf8().data(), 0);
@@ -38,7 +38,7 @@ FIBITMAP * readFileToFIBITMAP(const QString &path)
     }
 
     if ((fif != FIF_UNKNOWN) && FreeImage_FIFSupportsReading(fif)) {
-        FIBITMAP *dib = FreeImage_Load(fif, path.toUtf8().data(), 0);
+        FIBITMAP *dib = FreeImage_Load(fif, path.toUtf8().data(), flags);
         return dib;
     }
 
@@ -66,13 +66,14 @@ QMap<QString, QString> getMetaData(FREE_IMAGE_MDMODEL model, FIBITMAP *dib)
 
 /*!
  * \brief getAllMetaData
- * This function is very slow
+ * Only the header is loaded, the pixels are skipped by the plugins which
+ * support it(JPEG, TIFF, PNG, RAW and more)
  * \param path
  * \return
  */
 QMap<QString, QString> getAllMetaData(const QString &path)
 {
-    FIBITMAP *dib = readFileToFIBITMAP(path);
+    FIBITMAP *dib = readFileToFIBITMAP(path, FIF_LOAD_NOPIXELS);
     QMap<QString, QString> admMap;
     admMap.unite(getMetaData(FIMD_EXIF_MAIN, dib));
     admMap.unite(getMetaData(FIMD_EXIF_EXIF, dib));
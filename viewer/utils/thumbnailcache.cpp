@@ -0,0 +1,147 @@
+#include "thumbnailcache.h"
+#include <QMutexLocker>
+#include <limits>
+
+namespace utils {
+
+namespace image {
+
+namespace {
+
+const qint64 DEFAULT_BUDGET = 256 * 1024 * 1024;
+
+QString keyOf(const QString &path, int size)
+{
+    return QString::number(size) + ":" + path;
+}
+
+int costOf(const QPixmap &pixmap)
+{
+    return qMax(1, pixmap.width() * pixmap.height() * pixmap.depth() / 8);
+}
+
+}  // namespace
+
+ThumbnailCache *ThumbnailCache::m_cache = NULL;
+ThumbnailCache *ThumbnailCache::instance()
+{
+    // Before the thumbnail workers start, it isn't guarded
+    if (!m_cache) {
+        m_cache = new ThumbnailCache();
+    }
+
+    return m_cache;
+}
+
+ThumbnailCache::ThumbnailCache()
+    : m_budget(0)
+{
+    setBudget(DEFAULT_BUDGET);
+}
+
+void ThumbnailCache::setBudget(qint64 bytes)
+{
+    m_budget = qMax(qint64(0), bytes);
+    const int shardBudget = qMin(m_budget / SHARD_COUNT,
+                                 qint64(std::numeric_limits<int>::max()));
+    for (Shard &shard : m_shards) {
+        QMutexLocker locker(&shard.mutex);
+        shard.cache.setMaxCost(shardBudget);
+    }
+}
+
+bool ThumbnailCache::find(const QString &path, int size, qint64 modified,
+                          QPixmap &pixmap)
+{
+    Shard &shard = shardOf(path);
+    QMutexLocker locker(&shard.mutex);
+    const QString key = keyOf(path, size);
+    const Entry *entry = shard.cache.object(key);
+    if (! entry) {
+        shard.misses ++;
+        return false;
+    }
+    // The image is modified, so is its thumbnail
+    if (entry->modified != modified) {
+        shard.cache.remove(key);
+        shard.misses ++;
+        return false;
+    }
+
+    shard.hits ++;
+    pixmap = entry->pixmap;
+    return true;
+}
+
+bool ThumbnailCache::find(const QString &path, int size, QPixmap &pixmap)
+{
+    Shard &shard = shardOf(path);
+    QMutexLocker locker(&shard.mutex);
+    const Entry *entry = shard.cache.object(keyOf(path, size));
+    if (! entry) {
+        shard.misses ++;
+        return false;
+    }
+
+    shard.hits ++;
+    pixmap = entry->pixmap;
+    return true;
+}
+
+bool ThumbnailCache::contains(const QString &path, int size)
+{
+    Shard &shard = shardOf(path);
+    QMutexLocker locker(&shard.mutex);
+    return shard.cache.contains(keyOf(path, size));
+}
+
+void ThumbnailCache::insert(const QString &path, int size, qint64 modified,
+                            const QPixmap &pixmap)
+{
+    if (pixmap.isNull()) {
+        return;
+    }
+
+    Shard &shard = shardOf(path);
+    QMutexLocker locker(&shard.mutex);
+    const QString key = keyOf(path, size);
+    // The count drops by the evicted ones, the replaced one isn't evicted
+    const int count = shard.cache.count() - (shard.cache.contains(key) ? 1 : 0);
+    if (shard.cache.insert(key, new Entry{pixmap, modified}, costOf(pixmap))) {
+        shard.evictions += count + 1 - shard.cache.count();
+    }
+    shard.sizes.insert(size);
+}
+
+void ThumbnailCache::remove(const QString &path)
+{
+    Shard &shard = shardOf(path);
+    QMutexLocker locker(&shard.mutex);
+    for (int size : shard.sizes) {
+        shard.cache.remove(keyOf(path, size));
+    }
+}
+
+ThumbnailCache::Stats ThumbnailCache::stats() const
+{
+    Stats stats;
+    stats.budget = m_budget;
+    for (const Shard &shard : m_shards) {
+        QMutexLocker locker(&shard.mutex);
+        stats.hits += shard.hits;
+        stats.misses += shard.misses;
+        stats.evictions += shard.evictions;
+        stats.bytes += shard.cache.totalCost();
+    }
+
+    return stats;
+}
+
+ThumbnailCache::Shard &ThumbnailCache::shardOf(const QString &path)
+{
+    return m_shards[qHash(path) % SHARD_COUNT];
+}
+
+}  // namespace image
+
+}  // namespace utils
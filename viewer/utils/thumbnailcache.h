@@ -0,0 +1,77 @@
+#ifndef THUMBNAILCACHE_H
+#define THUMBNAILCACHE_H
+
+#include <QCache>
+#include <QMutex>
+#include <QPixmap>
+#include <QSet>
+#include <QString>
+
+namespace utils {
+
+namespace image {
+
+/*!
+ * \brief The ThumbnailCache class
+ * The decoded thumbnails kept in memory for the whole process, so switching
+ * between the panels doesn't read them from disk again. The least recently
+ * used ones are evicted once the bytes of pixels exceed the budget.
+ * It is split into shards by the hash of path, each one has its own lock
+ * and a share of the budget, so the thumbnail workers seldom wait for each
+ * other.
+ */
+class ThumbnailCache
+{
+public:
+    struct Stats {
+        qint64 hits = 0;
+        qint64 misses = 0;
+        qint64 evictions = 0;
+        qint64 bytes = 0;  // Of the pixels cached now
+        qint64 budget = 0;
+    };
+
+    static ThumbnailCache *instance();
+
+    void setBudget(qint64 bytes);
+    // The thumbnail of size of the image, which was modified(nanoseconds
+    // since epoch) at modified
+    bool find(const QString &path, int size, qint64 modified, QPixmap &pixmap);
+    // The cached one whatever its modified time, for the callers which drop
+    // the thumbnails of a modified image by remove()
+    bool find(const QString &path, int size, QPixmap &pixmap);
+    bool contains(const QString &path, int size);
+    void insert(const QString &path, int size, qint64 modified,
+                const QPixmap &pixmap);
+    // All the sizes of path
+    void remove(const QString &path);
+    Stats stats() const;
+
+private:
+    ThumbnailCache();
+    struct Entry {
+        QPixmap pixmap;
+        qint64 modified;
+    };
+    struct Shard {
+        mutable QMutex mutex;
+        QCache<QString, Entry> cache;  // The cost is bytes
+        qint64 hits = 0;
+        qint64 misses = 0;
+        qint64 evictions = 0;
+        QSet<int> sizes;  // Ever inserted
+    };
+    Shard &shardOf(const QString &path);
+
+private:
+    static ThumbnailCache *m_cache;
+    static const int SHARD_COUNT = 16;
+    Shard m_shards[SHARD_COUNT];
+    qint64 m_budget;
+};
+
+}  // namespace image
+
+}  // namespace utils
+
+#endif // THUMBNAILCACHE_H
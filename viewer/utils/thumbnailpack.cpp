@@ -0,0 +1,255 @@
+#include "thumbnailpack.h"
+#include <QDebug>
+#include <QMutexLocker>
+#include <string.h>
+#include <sys/file.h>
+
+namespace utils {
+
+namespace image {
+
+namespace {
+
+const char PACK_MAGIC[8] = {'D', 'I', 'V', 'T', 'P', 'A', 'C', 'K'};
+const quint32 PACK_VERSION = 1;
+const quint32 RECORD_MAGIC = 0x52504854;  // "THPR"
+// A page, the records behind it stay aligned
+const qint64 HEADER_SIZE = 4096;
+// The file grows and is mapped by segments of records
+const int SEGMENT_RECORDS = 64;
+
+struct PackHeader {
+    char magic[8];
+    quint32 version;
+    quint32 cellSize;
+    qint64 count;  // Of the records written completely
+};
+
+struct RecordHeader {
+    quint32 magic;
+    quint32 reserved;
+    qint64 id;
+    qint64 modified;
+    qint64 reserved2;
+};
+
+const int CELL_BYTES = ThumbnailPack::CELL_SIZE * ThumbnailPack::CELL_SIZE * 4;
+const qint64 RECORD_SIZE = sizeof(RecordHeader) + CELL_BYTES;
+const qint64 SEGMENT_SIZE = RECORD_SIZE * SEGMENT_RECORDS;
+
+PackHeader *headerOf(uchar *data)
+{
+    return reinterpret_cast<PackHeader *>(data);
+}
+
+// Every viewer process(eg: the ones opening a file) shares the pack, the
+// header and the appending are guarded by an advisory lock of the file
+class PackLocker
+{
+public:
+    explicit PackLocker(int fd) : m_fd(fd) { flock(m_fd, LOCK_EX); }
+    ~PackLocker() { flock(m_fd, LOCK_UN); }
+
+private:
+    int m_fd;
+};
+
+}  // namespace
+
+ThumbnailPack *ThumbnailPack::m_pack = NULL;
+ThumbnailPack *ThumbnailPack::instance()
+{
+    if (!m_pack) {
+        m_pack = new ThumbnailPack();
+    }
+
+    return m_pack;
+}
+
+ThumbnailPack::ThumbnailPack()
+    : m_header(NULL)
+{
+
+}
+
+bool ThumbnailPack::open(const QString &file)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_header) {
+        return true;
+    }
+
+    m_file.setFileName(file);
+    if (! m_file.open(QIODevice::ReadWrite)) {
+        qWarning() << "Open thumbnail pack failed: " << m_file.errorString();
+        return false;
+    }
+    PackLocker packLocker(m_file.handle());
+
+    PackHeader header;
+    if (m_file.read(reinterpret_cast<char *>(&header), sizeof(header))
+            != qint64(sizeof(header))
+            || memcmp(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0
+            || header.version != PACK_VERSION
+            || header.cellSize != quint32(CELL_SIZE)
+            || header.count < 0) {
+        // New, or written by another version
+        if (! reset()) {
+            m_file.close();
+            return false;
+        }
+    }
+
+    m_header = m_file.map(0, HEADER_SIZE);
+    if (! m_header) {
+        qWarning() << "Map thumbnail pack failed: " << m_file.errorString();
+        m_file.close();
+        return false;
+    }
+
+    // Don't trust a count beyond the records the file holds
+    const qint64 count = qMin(headerOf(m_header)->count,
+                              (m_file.size() - HEADER_SIZE) / RECORD_SIZE);
+    headerOf(m_header)->count = count;
+    while (qint64(m_segments.length()) * SEGMENT_RECORDS < count) {
+        if (! grow()) {
+            headerOf(m_header)->count =
+                    qint64(m_segments.length()) * SEGMENT_RECORDS;
+            break;
+        }
+    }
+
+    // The records never written completely(see insert()) read as zeros, or
+    // as garbage after a crash, the magic skips most of them
+    for (int i = 0; i < headerOf(m_header)->count; i ++) {
+        const RecordHeader *record =
+                reinterpret_cast<const RecordHeader *>(recordAt(i));
+        if (record->magic == RECORD_MAGIC) {
+            m_records.insert(record->id, i);
+        }
+    }
+
+    return true;
+}
+
+bool ThumbnailPack::isOpen() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_header != NULL;
+}
+
+const QImage ThumbnailPack::find(qint64 id, qint64 modified) const
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_records.constFind(id);
+    if (it == m_records.constEnd()) {
+        return QImage();
+    }
+
+    const uchar *record = recordAt(it.value());
+    if (reinterpret_cast<const RecordHeader *>(record)->modified != modified) {
+        return QImage();
+    }
+
+    return QImage(record + sizeof(RecordHeader), CELL_SIZE, CELL_SIZE,
+                  CELL_SIZE * 4, QImage::Format_RGB32);
+}
+
+void ThumbnailPack::insert(qint64 id, qint64 modified, const QImage &image)
+{
+    if (image.isNull()) {
+        return;
+    }
+
+    // Crop it to the cell before taking the lock
+    QImage cell = image.scaled(CELL_SIZE, CELL_SIZE,
+                               Qt::KeepAspectRatioByExpanding,
+                               Qt::SmoothTransformation);
+    cell = cell.copy((cell.width() - CELL_SIZE) / 2,
+                     (cell.height() - CELL_SIZE) / 2,
+                     CELL_SIZE, CELL_SIZE)
+            .convertToFormat(QImage::Format_RGB32);
+
+    QMutexLocker locker(&m_mutex);
+    if (! m_header) {
+        return;
+    }
+    PackLocker packLocker(m_file.handle());
+
+    // Other processes may have appended to it, and grown the file
+    const qint64 count = headerOf(m_header)->count;
+    while (count >= qint64(m_segments.length()) * SEGMENT_RECORDS) {
+        if (! grow()) {
+            return;
+        }
+    }
+
+    // The count is raised after the record is written, so the other
+    // processes never read a partial one. The order isn't kept on disk
+    // through a crash, which may leave a torn record behind.
+    uchar *record = recordAt(count);
+    uchar *pixels = record + sizeof(RecordHeader);
+    for (int y = 0; y < CELL_SIZE; y ++) {
+        memcpy(pixels + y * CELL_SIZE * 4, cell.constScanLine(y),
+               CELL_SIZE * 4);
+    }
+    RecordHeader header;
+    header.magic = RECORD_MAGIC;
+    header.reserved = 0;
+    header.id = id;
+    header.modified = modified;
+    header.reserved2 = 0;
+    memcpy(record, &header, sizeof(header));
+
+    headerOf(m_header)->count = count + 1;
+    m_records.insert(id, count);
+}
+
+bool ThumbnailPack::reset()
+{
+    PackHeader header;
+    memcpy(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC));
+    header.version = PACK_VERSION;
+    header.cellSize = CELL_SIZE;
+    header.count = 0;
+
+    if (! m_file.resize(0) || ! m_file.resize(HEADER_SIZE)
+            || ! m_file.seek(0)
+            || m_file.write(reinterpret_cast<const char *>(&header),
+                            sizeof(header)) != qint64(sizeof(header))
+            || ! m_file.flush()) {
+        qWarning() << "Reset thumbnail pack failed: " << m_file.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+bool ThumbnailPack::grow()
+{
+    const qint64 offset = HEADER_SIZE + m_segments.length() * SEGMENT_SIZE;
+    if (m_file.size() < offset + SEGMENT_SIZE
+            && ! m_file.resize(offset + SEGMENT_SIZE)) {
+        qWarning() << "Grow thumbnail pack failed: " << m_file.errorString();
+        return false;
+    }
+
+    uchar *segment = m_file.map(offset, SEGMENT_SIZE);
+    if (! segment) {
+        qWarning() << "Map thumbnail pack failed: " << m_file.errorString();
+        return false;
+    }
+
+    m_segments << segment;
+    return true;
+}
+
+uchar *ThumbnailPack::recordAt(int index) const
+{
+    return m_segments[index / SEGMENT_RECORDS]
+            + (index % SEGMENT_RECORDS) * RECORD_SIZE;
+}
+
+}  // namespace image
+
+}  // namespace utils
@@ -0,0 +1,56 @@
+#ifndef THUMBNAILPACK_H
+#define THUMBNAILPACK_H
+
+#include <QFile>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QVector>
+
+namespace utils {
+
+namespace image {
+
+/*!
+ * \brief The ThumbnailPack class
+ * The square thumbnails of the grids in one memory-mapped file, so they are
+ * read at start up without opening and inflating a PNG for every image.
+ * Every record is a cell of raw pixels of the same size, keyed by the image
+ * id and stamped with the image's mtime. Records are only appended, a newer
+ * one of an id shadows the older ones.
+ * The freedesktop thumbnails stay the source the pack is filled from.
+ */
+class ThumbnailPack
+{
+public:
+    static const int CELL_SIZE = 192;  // The largest icon of the grids
+
+    static ThumbnailPack *instance();
+
+    bool open(const QString &file);
+    bool isOpen() const;
+    // The image points into the mapping, null if it isn't packed or the
+    // image was modified(nanoseconds since epoch) since then
+    const QImage find(qint64 id, qint64 modified) const;
+    void insert(qint64 id, qint64 modified, const QImage &image);
+
+private:
+    ThumbnailPack();
+    bool reset();
+    bool grow();
+    uchar *recordAt(int index) const;
+
+private:
+    static ThumbnailPack *m_pack;
+    mutable QMutex m_mutex;
+    QFile m_file;
+    uchar *m_header;
+    QVector<uchar *> m_segments;  // Mapped, never unmapped until exit
+    QHash<qint64, int> m_records;  // Image id to the latest record
+};
+
+}  // namespace image
+
+}  // namespace utils
+
+#endif // THUMBNAILPACK_H
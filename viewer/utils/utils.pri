@@ -1,11 +1,21 @@
 HEADERS += \
     $$PWD/baseutils.h \
+    $$PWD/blockingqueue.h \
+    $$PWD/dirwalker.h \
+    $$PWD/exifparser.h \
     $$PWD/imageutils.h \
+    $$PWD/imagesniffer.h \
     $$PWD/shortcut.h \
-    $$PWD/imageutils_freeimage.h \
-    $$PWD/imageutils_libexif.h
+    $$PWD/thumbnailcache.h \
+    $$PWD/thumbnailpack.h \
+    $$PWD/imageutils_freeimage.h
 
 SOURCES += \
     $$PWD/imageutils.cpp \
+    $$PWD/imagesniffer.cpp \
     $$PWD/baseutils.cpp \
-    $$PWD/shortcut.cpp
+    $$PWD/dirwalker.cpp \
+    $$PWD/exifparser.cpp \
+    $$PWD/shortcut.cpp \
+    $$PWD/thumbnailcache.cpp \
+    $$PWD/thumbnailpack.cpp
@@ -11,7 +11,7 @@ qtHaveModule(opengl): QT += opengl
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 CONFIG -= app_bundle
 CONFIG += c++11 link_pkgconfig
-PKGCONFIG += x11 xext dtkwidget dtkutil dtkbase libexif
+PKGCONFIG += x11 xext dtkwidget dtkutil dtkbase
 LIBS += -L/usr/lib/x86_64-linux-gnu -lfreeimage
 #gtk+-2.0
 TARGET = deepin-image-viewer
@@ -1,4 +1,5 @@
 #include "thumbnaildelegate.h"
+#include "thumbnailmodel.h"
 #include "application.h"
 #include "controller/databasemanager.h"
 #include "utils/imageutils.h"
@@ -102,18 +103,10 @@ QSize ThumbnailDelegate::sizeHint(const QStyleOptionViewItem &option,
 
 ThumbnailDelegate::ItemData ThumbnailDelegate::itemData(const QModelIndex &index) const
 {
-    QVariantList datas = index.model()->data(index, Qt::DisplayRole).toList();
     ItemData data;
-    if (datas.length() >= 1) {
-        data.name = datas[0].toString();
-    }
-    if (datas.length() >= 2) {
-        data.path = datas[1].toString();
-    }
-    if (datas.length() >= 3) {
-        data.thumbnail.loadFromData(datas[2].toByteArray());
-    }
+    data.name = index.data(ThumbnailModel::NameRole).toString();
+    data.path = index.data(ThumbnailModel::PathRole).toString();
+    data.thumbnail = index.data(ThumbnailModel::ThumbnailRole).value<QPixmap>();
 
     return data;
 }
-
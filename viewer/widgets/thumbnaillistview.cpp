@@ -1,17 +1,18 @@
 #include "thumbnaillistview.h"
 #include "thumbnaildelegate.h"
+#include "thumbnailmodel.h"
 #include "application.h"
 #include "controller/databasemanager.h"
 #include "controller/importer.h"
+#include "controller/thumbnailservice.h"
 #include "utils/baseutils.h"
 #include "utils/imageutils.h"
-#include <QBuffer>
 #include <QDebug>
 #include <QEvent>
 #include <QFile>
+#include <QFileInfo>
 #include <QPaintEvent>
 #include <QScrollBar>
-#include <QStandardItemModel>
 #include <QTimer>
 
 namespace {
@@ -23,7 +24,7 @@ const int THUMBNAIL_MIN_SIZE = 96;
 
 ThumbnailListView::ThumbnailListView(QWidget *parent)
     : QListView(parent),
-      m_model(new QStandardItemModel(this)),
+      m_model(new ThumbnailModel(this)),
       m_multiple(false)
 {
     setIconSize(QSize(THUMBNAIL_MIN_SIZE, THUMBNAIL_MIN_SIZE));
@@ -47,8 +48,6 @@ ThumbnailListView::ThumbnailListView(QWidget *parent)
     viewport()->installEventFilter(this);
 
     initThumbnailTimer();
-    // FIXME getThumbnail函数实际使用了QMutexLocker会导致资源被锁，所以实际只有一个线程
-    QThreadPool::globalInstance()->setMaxThreadCount(2);
 }
 
 ThumbnailListView::~ThumbnailListView()
@@ -84,22 +83,20 @@ void ThumbnailListView::updateViewPortSize()
  */
 void ThumbnailListView::updateThumbnail(const QString &name)
 {
-    using namespace utils::image;
-    const QModelIndex mi = m_model->index(indexOf(name), 0);
-    auto info = itemInfo(mi);
-    info.thumb = cutSquareImage(getThumbnail(info.path));
-    m_model->setData(mi, QVariant(getVariantList(info)), Qt::DisplayRole);
+    const QString path = m_model->path(indexOf(name));
+    if (path.isEmpty()) {
+        return;
+    }
+    DatabaseManager::watch(ThumbnailService::instance()->thumbnail(path), this,
+                           [=] (const QPixmap &thumb) {
+        onThumbnailGenerated(path, thumb);
+    });
 }
 
 void ThumbnailListView::updateThumbnails()
 {
     m_delegate->clearPaintingList();
 
-    m_watcher.pause();
-    m_watcher.cancel();
-    // waitForFinished will stuck main UI thread
-//    m_thumbnailWatcher.waitForFinished();
-
     // Update painting list
     viewport()->update();
 
@@ -109,9 +106,7 @@ void ThumbnailListView::updateThumbnails()
 void ThumbnailListView::setIconSize(const QSize &size)
 {
     QListView::setIconSize(size);
-    for (int i = 0; i < m_model->rowCount(); i ++) {
-        m_model->setData(m_model->index(i, 0), QVariant(size), Qt::SizeHintRole);
-    }
+    m_model->setSizeHint(size);
 
     updateViewPortSize();
 }
@@ -119,25 +114,14 @@ void ThumbnailListView::setIconSize(const QSize &size)
 void ThumbnailListView::insertItem(const ItemInfo &info)
 {
     // Diffrent thread connection cause duplicate insert
-    if (indexOf(info.name) != -1)
-        return;
-
-    QStandardItem *item = new QStandardItem();
-    QList<QStandardItem *> items;
-    items.append(item);
-    m_model->appendRow(items);
-
-    QModelIndex index = m_model->index(m_model->rowCount() - 1, 0);
-    m_model->setData(index, QVariant(getVariantList(info)), Qt::DisplayRole);
-    m_model->setData(index, QVariant(iconSize()), Qt::SizeHintRole);
-    updateViewPortSize();
+    if (m_model->append(info.name, info.path, info.thumb)) {
+        updateViewPortSize();
+    }
 }
 
 bool ThumbnailListView::removeItem(const QString &name)
 {
-    const int i = indexOf(name);
-    if (i != -1) {
-        m_model->removeRow(i);
+    if (m_model->remove(name)) {
         updateViewPortSize();
         return true;
     }
@@ -147,12 +131,7 @@ bool ThumbnailListView::removeItem(const QString &name)
 
 void ThumbnailListView::removeItems(const QStringList &names)
 {
-    for (QString name : names) {
-        const int i = indexOf(name);
-        if (i != -1) {
-            m_model->removeRow(i);
-        }
-    }
+    m_model->remove(names);
     updateViewPortSize();
 }
 
@@ -166,16 +145,9 @@ bool ThumbnailListView::isMultiSelection() const
     return m_multiple;
 }
 
-int ThumbnailListView::indexOf(const QString &name)
+int ThumbnailListView::indexOf(const QString &name) const
 {
-    for (int i = 0; i < m_model->rowCount(); i ++) {
-        const QVariantList datas =
-            m_model->data(m_model->index(i, 0), Qt::DisplayRole).toList();
-        if (! datas.isEmpty() && datas[0].toString() == name) {
-            return i;
-        }
-    }
-    return -1;
+    return m_model->indexOf(name);
 }
 
 int ThumbnailListView::count() const
@@ -189,62 +161,30 @@ int ThumbnailListView::hOffset() const
 }
 
 const ThumbnailListView::ItemInfo ThumbnailListView::itemInfo(
-        const QModelIndex &index)
+        const QModelIndex &index) const
 {
-    ItemInfo info;
-    if (! index.isValid())
-        return info;
-    const QVariantList datas =
-            index.model()->data(index, Qt::DisplayRole).toList();
-    info.name = datas[0].toString();
-    info.path = datas[1].toString();
-    if (datas[2].isValid()) {
-        QPixmap thumb;
-        if (thumb.loadFromData(datas[2].toByteArray())) {
-            info.thumb = thumb;
-        }
-    }
+    if (! index.isValid() || index.model() != m_model)
+        return ItemInfo();
 
-    return info;
+    return itemInfo(index.row());
 }
 
-const QList<ThumbnailListView::ItemInfo> ThumbnailListView::ItemInfos()
+const QList<ThumbnailListView::ItemInfo> ThumbnailListView::ItemInfos() const
 {
     QList<ItemInfo> infos;
     for (int i = 0; i < m_model->rowCount(); i ++) {
-        const QVariantList datas =
-            m_model->data(m_model->index(i, 0), Qt::DisplayRole).toList();
-        ItemInfo info;
-        info.name = datas[0].toString();
-        info.path = datas[1].toString();
-        if (datas[2].isValid()) {
-            QPixmap thumb;
-            if (thumb.loadFromData(datas[2].toByteArray())) {
-                info.thumb = thumb;
-            }
-        }
-        infos << info;
+        infos << itemInfo(i);
     }
 
     return infos;
 }
 
-const QList<ThumbnailListView::ItemInfo> ThumbnailListView::selectedItemInfos()
+const QList<ThumbnailListView::ItemInfo>
+ThumbnailListView::selectedItemInfos() const
 {
     QList<ItemInfo> infos;
     for (QModelIndex index : selectionModel()->selectedIndexes()) {
-        const QVariantList datas =
-                index.model()->data(index, Qt::DisplayRole).toList();
-        ItemInfo info;
-        info.name = datas[0].toString();
-        info.path = datas[1].toString();
-        if (datas[2].isValid()) {
-            QPixmap thumb;
-            if (thumb.loadFromData(datas[2].toByteArray())) {
-                info.thumb = thumb;
-            }
-        }
-        infos << info;
+        infos << itemInfo(index);
     }
 
     return infos;
@@ -357,32 +297,6 @@ bool caseRow(const QModelIndex &i1, const QModelIndex &i2)
     return i1.row() < i2.row();
 }
 
-QVariant generateThumbnail(const QString &path)
-{
-    using namespace utils::image;
-    QVariant result;
-    const QString name = QFileInfo(path).fileName();
-    const QPixmap thumb = getThumbnail(path);
-    if (thumb.isNull()) {
-        // Can't generate thumbnail, remove it from database
-        dApp->databaseM->removeImages(QStringList(name));
-    }
-    else {
-        QByteArray inByteArray;
-        QBuffer inBuffer( &inByteArray );
-        inBuffer.open( QIODevice::WriteOnly );
-        // write inPixmap into inByteArray
-        if ( ! cutSquareImage(thumb).save( &inBuffer, "JPG" )) {
-            // qDebug() << "Write pixmap to buffer error!" << info.name;
-        }
-        QVariantList nl;
-        nl << QVariant(name) << QVariant(path) << QVariant(inByteArray);
-        result = QVariant(nl);
-    }
-
-    return result;
-}
-
 /*!
  * \brief ThumbnailListView::initThumbnailTimer
  * Check for update delegate's thumbnail incase thumbnail regenerate
@@ -393,39 +307,40 @@ void ThumbnailListView::initThumbnailTimer()
     m_thumbTimer->setSingleShot(true);
     m_thumbTimer->setInterval(1000);
     connect(m_thumbTimer, &QTimer::timeout, this, [=] {
-        QStringList paths = m_delegate->paintingPaths();
-        if (! paths.isEmpty()) {
-            m_watcher.setPaused(false);
-            QFuture<QVariant> future = QtConcurrent::mapped(paths, generateThumbnail);
-            m_watcher.setFuture(future);
-            m_delegate->clearPaintingList();
+        const QStringList paths = m_delegate->paintingPaths();
+        m_delegate->clearPaintingList();
+        for (const QString &path : paths) {
+            DatabaseManager::watch(ThumbnailService::instance()->thumbnail(path),
+                                   this, [=] (const QPixmap &thumb) {
+                onThumbnailGenerated(path, thumb);
+            });
         }
     });
-
-    connect(&m_watcher, SIGNAL(resultReadyAt(int)),
-            this, SLOT(onThumbnailGenerated(int)));
 }
 
-void ThumbnailListView::onThumbnailGenerated(int index)
+void ThumbnailListView::onThumbnailGenerated(const QString &path,
+                                             const QPixmap &thumb)
 {
-    QVariantList v = m_watcher.resultAt(index).toList();
-    if (v.length() != 3) return;
-    const QString name = v[0].toString();
-    m_model->setData(m_model->index(indexOf(name), 0), v, Qt::DisplayRole);
+    const QString name = QFileInfo(path).fileName();
+    if (thumb.isNull()) {
+        // Can't generate thumbnail, remove it from database
+        dApp->databaseM->removeImages(QStringList(name));
+        return;
+    }
+
+    const int row = indexOf(name);
+    if (row == -1) {
+        return;
+    }
+    m_model->setThumbnail(row, utils::image::cutSquareImage(thumb));
 }
 
-const QVariantList ThumbnailListView::getVariantList(const ItemInfo &info)
+const ThumbnailListView::ItemInfo ThumbnailListView::itemInfo(int row) const
 {
-    QVariantList datas;
-    datas.append(QVariant(info.name));
-    datas.append(QVariant(info.path));
-    QByteArray inByteArray;
-    QBuffer inBuffer( &inByteArray );
-    inBuffer.open( QIODevice::WriteOnly );
-    if ( !info.thumb.save( &inBuffer, "JPG" )) { // write inPixmap into inByteArray
-//        qDebug() << "Write pixmap to buffer error!" << info.name;
-    }
-    datas.append(QVariant(inByteArray));
+    ItemInfo info;
+    info.name = m_model->name(row);
+    info.path = m_model->path(row);
+    info.thumb = m_model->thumbnail(row);
 
-    return datas;
+    return info;
 }
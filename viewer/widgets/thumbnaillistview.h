@@ -2,10 +2,9 @@
 #define THUMBNAILLISTVIEW_H
 
 #include <QListView>
-#include <QFutureWatcher>
 
-class QStandardItemModel;
 class ThumbnailDelegate;
+class ThumbnailModel;
 class QTimer;
 class ThumbnailListView : public QListView
 {
@@ -30,12 +29,12 @@ public:
     void removeItems(const QStringList &names);
     bool contain(const QModelIndex &index) const;
     bool isMultiSelection() const;
-    int indexOf(const QString &name);
+    int indexOf(const QString &name) const;
     int count() const;
     int hOffset() const;
-    const ItemInfo itemInfo(const QModelIndex &index);
-    const QList<ItemInfo> ItemInfos();
-    const QList<ItemInfo> selectedItemInfos();
+    const ItemInfo itemInfo(const QModelIndex &index) const;
+    const QList<ItemInfo> ItemInfos() const;
+    const QList<ItemInfo> selectedItemInfos() const;
 
 signals:
     void singleClicked(QMouseEvent *e);
@@ -50,21 +49,20 @@ protected:
     void wheelEvent(QWheelEvent *e) Q_DECL_OVERRIDE;
 
 private slots:
-    void onThumbnailGenerated(int index);
     void fixedViewPortSize(bool proactive = false);
 
 private:
+    const ItemInfo itemInfo(int row) const;
     int contentsHMargin() const;
     int contentsVMargin() const;
     int maxColumn() const;
-    const QVariantList getVariantList(const ItemInfo &info);
+    void onThumbnailGenerated(const QString &path, const QPixmap &thumb);
 
     void initThumbnailTimer();
 
 private:
     QTimer *m_thumbTimer;
-    QFutureWatcher<QVariant> m_watcher;
-    QStandardItemModel *m_model;
+    ThumbnailModel *m_model;
     ThumbnailDelegate *m_delegate;
     bool m_multiple;
 };
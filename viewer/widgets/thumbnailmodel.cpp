@@ -0,0 +1,175 @@
+#include "thumbnailmodel.h"
+#include "utils/imageutils.h"
+#include <algorithm>
+
+ThumbnailModel::ThumbnailModel(QObject *parent)
+    : QAbstractListModel(parent),
+      m_nextSeq(0)
+{
+
+}
+
+int ThumbnailModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_names.length();
+}
+
+QVariant ThumbnailModel::data(const QModelIndex &index, int role) const
+{
+    if (! index.isValid() || index.row() >= m_names.length()) {
+        return QVariant();
+    }
+
+    const int row = index.row();
+    switch (role) {
+    case Qt::DisplayRole:
+    case NameRole:
+        return m_names[row];
+    case PathRole:
+        return m_paths[row];
+    case Qt::DecorationRole:
+    case ThumbnailRole:
+        return thumbnail(row);
+    case Qt::SizeHintRole:
+        return m_sizeHint;
+    default:
+        return QVariant();
+    }
+}
+
+void ThumbnailModel::clear()
+{
+    beginResetModel();
+    m_names.clear();
+    m_paths.clear();
+    m_seqs.clear();
+    m_rows.clear();
+    endResetModel();
+}
+
+bool ThumbnailModel::append(const QString &name, const QString &path,
+                            const QPixmap &thumb)
+{
+    if (m_rows.contains(name)) {
+        return false;
+    }
+
+    if (! thumb.isNull()) {
+        utils::image::cacheSquareThumbnail(path, thumb);
+    }
+
+    const int row = m_names.length();
+    beginInsertRows(QModelIndex(), row, row);
+    m_names.append(name);
+    m_paths.append(path);
+    m_seqs.append(m_nextSeq);
+    m_rows.insert(name, m_nextSeq);
+    m_nextSeq ++;
+    endInsertRows();
+
+    return true;
+}
+
+bool ThumbnailModel::remove(const QString &name)
+{
+    const int row = indexOf(name);
+    if (row == -1) {
+        return false;
+    }
+
+    removeRange(row, row);
+    return true;
+}
+
+void ThumbnailModel::remove(const QStringList &names)
+{
+    QVector<int> rows;
+    for (const QString &name : names) {
+        const int row = indexOf(name);
+        if (row != -1) {
+            rows << row;
+        }
+    }
+    if (rows.isEmpty()) {
+        return;
+    }
+
+    // Remove the contiguous ranges from the last one, the rows in front of
+    // a range keep their numbers
+    std::sort(rows.begin(), rows.end());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+    int last = rows.last();
+    for (int i = rows.length() - 1; i >= 0; i --) {
+        if (i == 0 || rows[i - 1] != rows[i] - 1) {
+            removeRange(rows[i], last);
+            if (i > 0) {
+                last = rows[i - 1];
+            }
+        }
+    }
+}
+
+int ThumbnailModel::indexOf(const QString &name) const
+{
+    auto it = m_rows.constFind(name);
+    if (it == m_rows.constEnd()) {
+        return -1;
+    }
+
+    auto seq = std::lower_bound(m_seqs.constBegin(), m_seqs.constEnd(),
+                                it.value());
+    return int(seq - m_seqs.constBegin());
+}
+
+const QString ThumbnailModel::name(int row) const
+{
+    return m_names.value(row);
+}
+
+const QString ThumbnailModel::path(int row) const
+{
+    return m_paths.value(row);
+}
+
+const QPixmap ThumbnailModel::thumbnail(int row) const
+{
+    if (row < 0 || row >= m_paths.length()) {
+        return QPixmap();
+    }
+
+    return utils::image::cachedSquareThumbnail(m_paths[row]);
+}
+
+void ThumbnailModel::setThumbnail(int row, const QPixmap &thumb)
+{
+    if (row < 0 || row >= m_paths.length()) {
+        return;
+    }
+
+    utils::image::cacheSquareThumbnail(m_paths[row], thumb);
+    const QModelIndex i = index(row);
+    emit dataChanged(i, i, QVector<int>() << ThumbnailRole
+                     << Qt::DecorationRole);
+}
+
+void ThumbnailModel::setSizeHint(const QSize &size)
+{
+    m_sizeHint = size;
+    if (! m_names.isEmpty()) {
+        emit dataChanged(index(0), index(m_names.length() - 1),
+                         QVector<int>() << Qt::SizeHintRole);
+    }
+}
+
+void ThumbnailModel::removeRange(int first, int last)
+{
+    const int count = last - first + 1;
+    beginRemoveRows(QModelIndex(), first, last);
+    for (int i = first; i <= last; i ++) {
+        m_rows.remove(m_names[i]);
+    }
+    m_names.remove(first, count);
+    m_paths.remove(first, count);
+    m_seqs.remove(first, count);
+    endRemoveRows();
+}
@@ -0,0 +1,62 @@
+#ifndef THUMBNAILMODEL_H
+#define THUMBNAILMODEL_H
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QPixmap>
+#include <QSize>
+#include <QVector>
+
+/*!
+ * \brief The ThumbnailModel class
+ * The rows of ThumbnailListView. Every field is kept in its own array, and
+ * the thumbnails aren't kept at all: a row refers to its square thumbnail in
+ * ThumbnailCache by path, so they share the byte budget of the cache, and
+ * an evicted one is generated again once it is painted.
+ * Every row gets an increasing sequence number when appended, the rows are
+ * found by name through it with a binary search, and a removal doesn't
+ * renumber the rows behind it.
+ */
+class ThumbnailModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    enum Role {
+        NameRole = Qt::UserRole + 1,
+        PathRole,
+        ThumbnailRole
+    };
+
+    explicit ThumbnailModel(QObject *parent = 0);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE;
+    QVariant data(const QModelIndex &index,
+                  int role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
+
+    void clear();
+    // Return false if name is in the model already
+    bool append(const QString &name, const QString &path, const QPixmap &thumb);
+    bool remove(const QString &name);
+    void remove(const QStringList &names);
+    int indexOf(const QString &name) const;
+
+    const QString name(int row) const;
+    const QString path(int row) const;
+    // Null if it's evicted from the cache
+    const QPixmap thumbnail(int row) const;
+    void setThumbnail(int row, const QPixmap &thumb);
+    void setSizeHint(const QSize &size);
+
+private:
+    void removeRange(int first, int last);
+
+private:
+    QVector<QString> m_names;
+    QVector<QString> m_paths;
+    QVector<quint64> m_seqs;  // Increasing with the rows
+    QHash<QString, quint64> m_rows;  // Name to sequence number
+    quint64 m_nextSeq;
+    QSize m_sizeHint;
+};
+
+#endif // THUMBNAILMODEL_H
@@ -14,6 +14,7 @@ HEADERS += \
     $$PWD/blureinfoframe.h \
     $$PWD/separator.h \
     $$PWD/thumbnaildelegate.h \
+    $$PWD/thumbnailmodel.h \
     $$PWD/progresswidgetstips.h
 
 SOURCES += \
@@ -30,6 +31,7 @@ SOURCES += \
     $$PWD/blureinfoframe.cpp \
     $$PWD/separator.cpp \
     $$PWD/thumbnaildelegate.cpp \
+    $$PWD/thumbnailmodel.cpp \
     $$PWD/progresswidgetstips.cpp
 
 RESOURCES += \